@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "archive.h"
+#include "checksum.h"
+
+/*
+ * Little-endian store/load helpers
+ */
+static void put_le(unsigned char *p, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        p[i] = value >> (8 * i);
+}
+
+static uint64_t get_le(const unsigned char *p, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= (uint64_t)p[i] << (8 * i);
+    return value;
+}
+
+/*
+ * A stored name must be a plain file name: extraction writes it inside
+ * the output directory, so separators and "." / ".." are refused
+ */
+static int archive_name_valid(const char *name, size_t len)
+{
+    if (len == 0 || len > ARCHIVE_MAX_NAME || memchr(name, '/', len) != NULL || memchr(name, '\0', len) != NULL)
+        return 0;
+    return !(len == 1 && name[0] == '.') && !(len == 2 && name[0] == '.' && name[1] == '.');
+}
+
+/*
+ * Collect the files to pack: every one must be a regular file with a
+ * name not used by an earlier one. Offsets follow the order given.
+ */
+Status archive_add_files(ArchiveInfo *archive, char *fnames[], int lsb_bits)
+{
+    int count = 0;
+    while (fnames[count] != NULL)
+        count++;
+    if (count == 0)
+    {
+        fprintf(stderr, "Error: --archive needs at least one file to pack.\n");
+        return e_failure;
+    }
+
+    archive->entries = calloc(count, sizeof(ArchiveEntry));
+    if (archive->entries == NULL)
+        return e_failure;
+    archive->entry_count = 0;
+    archive->data_size = 0;
+
+    uint64_t index_size = ARCHIVE_INDEX_HEAD + 4;
+    for (int i = 0; i < count; i++)
+    {
+        ArchiveEntry *entry = &archive->entries[i];
+        struct stat st;
+
+        // Step 1: Only regular files can be packed
+        if (stat(fnames[i], &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            fprintf(stderr, "Error: '%s' is not a readable regular file.\n", fnames[i]);
+            return e_failure;
+        }
+
+        // Step 2: Record the name without its directories
+        const char *name = strrchr(fnames[i], '/');
+        name = name != NULL ? name + 1 : fnames[i];
+        if (!archive_name_valid(name, strlen(name)))
+        {
+            fprintf(stderr, "Error: '%s' has no usable file name (at most %d bytes).\n", fnames[i], ARCHIVE_MAX_NAME);
+            return e_failure;
+        }
+        if (archive_find(archive, name) != NULL)
+        {
+            fprintf(stderr, "Error: Two files named '%s' cannot share an archive.\n", name);
+            return e_failure;
+        }
+
+        entry->fname = fnames[i];
+        strcpy(entry->name, name);
+        entry->offset = archive->data_size;
+        entry->size = st.st_size;
+        archive->data_size += entry->size;
+        archive->entry_count++;
+        index_size += ARCHIVE_ENTRY_FIXED + strlen(name);
+    }
+
+    // Pad to whole groups of lsb_bits bytes so the data starts on a fresh group
+    index_size = (index_size + lsb_bits - 1) / lsb_bits * lsb_bits;
+    if (index_size > UINT32_MAX)
+        return e_failure;
+    archive->index_size = index_size;
+    return e_success;
+}
+
+/*
+ * Serialize the index into its on-image byte layout
+ */
+void archive_index_pack(const ArchiveInfo *archive, unsigned char *out)
+{
+    unsigned char *p = out;
+
+    memset(out, 0, archive->index_size);
+    put_le(p, archive->entry_count, 4);
+    put_le(p + 4, archive->index_size, 4);
+    p += ARCHIVE_INDEX_HEAD;
+    for (uint32_t i = 0; i < archive->entry_count; i++)
+    {
+        const ArchiveEntry *entry = &archive->entries[i];
+        size_t len = strlen(entry->name);
+        put_le(p, entry->offset, 8);
+        put_le(p + 8, entry->size, 8);
+        put_le(p + 16, entry->crc, 4);
+        put_le(p + 20, len, 2);
+        memcpy(p + ARCHIVE_ENTRY_FIXED, entry->name, len);
+        p += ARCHIVE_ENTRY_FIXED + len;
+    }
+    put_le(out + archive->index_size - 4, crc32c(0, out, archive->index_size - 4), 4);
+}
+
+/*
+ * Parse the on-image index. The checksum must match before any field
+ * is used, and every entry must be a valid name lying inside the data.
+ */
+Status archive_index_unpack(const unsigned char *in, uint32_t index_size, uint64_t payload_size,
+                            ArchiveInfo *archive)
+{
+    if (index_size < ARCHIVE_INDEX_HEAD + 4 || index_size > payload_size ||
+        get_le(in + 4, 4) != index_size || get_le(in + index_size - 4, 4) != crc32c(0, in, index_size - 4))
+        return e_failure;
+
+    uint32_t count = get_le(in, 4);
+    if (count > (index_size - ARCHIVE_INDEX_HEAD - 4) / ARCHIVE_ENTRY_FIXED)
+        return e_failure;
+    archive->entries = calloc(count ? count : 1, sizeof(ArchiveEntry));
+    if (archive->entries == NULL)
+        return e_failure;
+    archive->entry_count = 0;
+    archive->index_size = index_size;
+    archive->data_size = payload_size - index_size;
+
+    const unsigned char *p = in + ARCHIVE_INDEX_HEAD, *end = in + index_size - 4;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ArchiveEntry *entry = &archive->entries[i];
+        if (end - p < ARCHIVE_ENTRY_FIXED)
+            return e_failure;
+        entry->offset = get_le(p, 8);
+        entry->size = get_le(p + 8, 8);
+        entry->crc = get_le(p + 16, 4);
+        size_t len = get_le(p + 20, 2);
+        p += ARCHIVE_ENTRY_FIXED;
+        if ((size_t)(end - p) < len || !archive_name_valid((const char *)p, len) ||
+            entry->offset > archive->data_size || entry->size > archive->data_size - entry->offset)
+            return e_failure;
+        memcpy(entry->name, p, len);
+        entry->name[len] = '\0';
+        p += len;
+        archive->entry_count++;
+    }
+    return e_success;
+}
+
+ArchiveEntry *archive_find(ArchiveInfo *archive, const char *name)
+{
+    for (uint32_t i = 0; i < archive->entry_count; i++)
+        if (strcmp(archive->entries[i].name, name) == 0)
+            return &archive->entries[i];
+    return NULL;
+}
+
+void free_archive(ArchiveInfo *archive)
+{
+    free(archive->entries);
+    archive->entries = NULL;
+    archive->entry_count = 0;
+}
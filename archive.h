@@ -0,0 +1,74 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * Multi-file archives (--archive)
+ * -------------------------------
+ * Many files share one cover: the payload is an index followed by the
+ * contents of every file back to back, and the stego header carries
+ * STEG_FLAG_ARCHIVE (payload_size and payload_crc cover the whole
+ * payload). The index, little-endian:
+ *
+ *   size field
+ *   4    entry_count
+ *   4    index_size   (bytes of the index, this header and the CRC included)
+ *   then for every entry:
+ *   8    offset       (from the end of the index)
+ *   8    size
+ *   4    crc          (CRC-32C of the entry)
+ *   2    name_len
+ *   n    name         (file name without directories, not NUL terminated)
+ *   then zero padding, so the index fills whole k-LSB groups, and
+ *   4    index_crc    (CRC-32C of every index byte before it)
+ *
+ * The payload is a plain (unframed) one, so an entry is extracted by
+ * seeking straight to its bytes, like --range.
+ */
+
+/* Longest file name stored in the index */
+#define ARCHIVE_MAX_NAME 255
+
+/* Index bytes before the first entry */
+#define ARCHIVE_INDEX_HEAD 8
+
+/* Fixed index bytes per entry (before the name) */
+#define ARCHIVE_ENTRY_FIXED 22
+
+typedef struct _ArchiveEntry
+{
+    char *fname;                     // Path to read when encoding (NULL when decoded)
+    char name[ARCHIVE_MAX_NAME + 1]; // Name recorded in the index
+    uint64_t offset;                 // Start within the data after the index
+    uint64_t size;                   // Size in bytes
+    uint32_t crc;                    // CRC-32C of the contents
+} ArchiveEntry;
+
+typedef struct _ArchiveInfo
+{
+    ArchiveEntry *entries; // Entries in payload order
+    uint32_t entry_count;  // Number of entries
+    uint32_t index_size;   // Bytes of the packed index
+    uint64_t data_size;    // Bytes of file data after the index
+} ArchiveInfo;
+
+/* Collect the files to pack (NULL-terminated list); sizes, names and offsets */
+Status archive_add_files(ArchiveInfo *archive, char *fnames[], int lsb_bits);
+
+/* Serialize the index (index_size bytes, computes index_crc) */
+void archive_index_pack(const ArchiveInfo *archive, unsigned char *out);
+
+/* Parse and check an index read from the payload (payload_size bytes in all) */
+Status archive_index_unpack(const unsigned char *in, uint32_t index_size, uint64_t payload_size,
+                            ArchiveInfo *archive);
+
+/* Entry with the given name, NULL if there is none */
+ArchiveEntry *archive_find(ArchiveInfo *archive, const char *name);
+
+/* Release the entry list */
+void free_archive(ArchiveInfo *archive);
+
+#endif
@@ -0,0 +1,343 @@
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "batch.h"
+#include "encode.h"
+#include "decode.h"
+#include "stats.h"
+#include "types.h"
+
+/*
+ * Per-worker job deque
+ * The owner pops from the tail, idle workers steal from the head
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    size_t *items;
+    size_t head;
+    size_t tail;
+} JobDeque;
+
+typedef struct
+{
+    BatchInfo *batchInfo;
+    JobDeque *deques;
+    int workers;
+    sem_t inflight;         // Bounds jobs holding files and buffers
+    pthread_mutex_t report; // Serialises status lines and counters
+    size_t finished;
+} BatchScheduler;
+
+typedef struct
+{
+    BatchScheduler *sched;
+    int id;
+} BatchWorker;
+
+/*
+ * Parse one manifest line into a job
+ */
+static Status parse_batch_line(char *text, BatchJob *job)
+{
+    char *save;
+    char *tokens[5];
+    int count = 0;
+
+    strncpy(job->line, text, BATCH_MAX_LINE - 1);
+    job->line[BATCH_MAX_LINE - 1] = '\0';
+    for (char *tok = strtok_r(job->line, " \t\r\n", &save); tok != NULL && count < 5;
+         tok = strtok_r(NULL, " \t\r\n", &save))
+        tokens[count++] = tok;
+
+    // Build the same argv layout main passes to the validators
+    memset(job->args, 0, sizeof(job->args));
+    job->args[0] = "batch";
+    if (count >= 3 && strcmp(tokens[0], "e") == 0)
+    {
+        job->op = e_encode;
+        job->args[1] = "-e";
+        for (int i = 1; i < count && i < 4; i++)
+            job->args[i + 1] = tokens[i];
+        return e_success;
+    }
+    if (count >= 2 && strcmp(tokens[0], "d") == 0)
+    {
+        job->op = e_decode;
+        job->args[1] = "-d";
+        for (int i = 1; i < count && i < 3; i++)
+            job->args[i + 1] = tokens[i];
+        return e_success;
+    }
+    return e_failure;
+}
+
+/*
+ * Read the manifest file into the job list
+ */
+Status read_batch_manifest(BatchInfo *batchInfo)
+{
+    FILE *fptr = fopen(batchInfo->manifest_fname, "r");
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open manifest %s\n", batchInfo->manifest_fname);
+        return e_failure;
+    }
+
+    char text[BATCH_MAX_LINE];
+    size_t capacity = 0, line_no = 0;
+    Status ret = e_success;
+    batchInfo->jobs = NULL;
+    batchInfo->job_count = 0;
+
+    while (fgets(text, sizeof(text), fptr) != NULL)
+    {
+        line_no++;
+        char *p = text + strspn(text, " \t\r\n");
+        if (*p == '\0' || *p == '#')
+            continue;
+
+        if (batchInfo->job_count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            BatchJob *jobs = realloc(batchInfo->jobs, capacity * sizeof(BatchJob));
+            if (jobs == NULL)
+            {
+                ret = e_failure;
+                break;
+            }
+            batchInfo->jobs = jobs;
+        }
+
+        BatchJob *job = &batchInfo->jobs[batchInfo->job_count];
+        if (parse_batch_line(p, job) != e_success)
+        {
+            fprintf(stderr, "ERROR: %s:%zu: expected 'e <cover.bmp> <secret> [out.bmp]' or 'd <stego.bmp> [out]'\n",
+                    batchInfo->manifest_fname, line_no);
+            ret = e_failure;
+            break;
+        }
+        batchInfo->job_count++;
+    }
+    fclose(fptr);
+    return ret;
+}
+
+void free_batch(BatchInfo *batchInfo)
+{
+    free(batchInfo->jobs);
+    batchInfo->jobs = NULL;
+    batchInfo->job_count = 0;
+}
+
+/*
+ * Run a single job with the normal encode/decode pipeline, quietly
+ */
+static void run_batch_job(BatchJob *job)
+{
+    double start = stats_now();
+    job->status = e_failure;
+    job->payload_bytes = 0;
+    job->output[0] = '\0';
+
+    if (job->op == e_encode)
+    {
+        EncodeInfo enc_info = {0};
+        enc_info.quiet = 1;
+        enc_info.lsb_bits = job->lsb_bits;
+        enc_info.compress = job->compress;
+        enc_info.cover_cache = job->cover_cache;
+        if (read_and_validate_encode_args(job->args, &enc_info) == e_success)
+        {
+            job->status = do_encoding(&enc_info);
+            job->payload_bytes = enc_info.size_secret_file;
+            snprintf(job->output, sizeof(job->output), "%s", enc_info.stego_image_fname);
+        }
+        close_files(&enc_info);
+    }
+    else
+    {
+        DecodeInfo dec_info = {0};
+        dec_info.quiet = 1;
+        if (read_and_validate_decode_args(job->args, &dec_info) == e_success &&
+            open_decoded_files(&dec_info) == e_success)
+        {
+            if (skip_bmp_header(&dec_info) == e_success && decode_magic_string(&dec_info) == e_success)
+                job->status = do_decoding(&dec_info);
+            job->payload_bytes = dec_info.size_secret_file;
+            snprintf(job->output, sizeof(job->output), "%s", dec_info.secret_fname);
+        }
+        close_decoded_files(&dec_info);
+    }
+    job->seconds = stats_now() - start;
+}
+
+/*
+ * Take the next job: own tail first, then steal from other heads
+ */
+static int next_batch_job(BatchScheduler *sched, int id, size_t *index)
+{
+    for (int i = 0; i < sched->workers; i++)
+    {
+        JobDeque *dq = &sched->deques[(id + i) % sched->workers];
+        int found = 0;
+
+        pthread_mutex_lock(&dq->lock);
+        if (dq->head < dq->tail)
+        {
+            *index = (i == 0) ? dq->items[--dq->tail] : dq->items[dq->head++];
+            found = 1;
+        }
+        pthread_mutex_unlock(&dq->lock);
+        if (found)
+            return 1;
+    }
+    return 0;
+}
+
+static void *batch_worker(void *arg)
+{
+    BatchWorker *worker = arg;
+    BatchScheduler *sched = worker->sched;
+    BatchInfo *batchInfo = sched->batchInfo;
+    size_t index;
+
+    while (next_batch_job(sched, worker->id, &index))
+    {
+        BatchJob *job = &batchInfo->jobs[index];
+
+        sem_wait(&sched->inflight);
+        run_batch_job(job);
+        sem_post(&sched->inflight);
+
+        pthread_mutex_lock(&sched->report);
+        sched->finished++;
+        printf("[%5zu/%zu] %s %s %-28s -> %-28s %10llu B %9.2f ms\n",
+               sched->finished, batchInfo->job_count,
+               job->status == e_success ? "✅" : "❌",
+               job->op == e_encode ? "enc" : "dec",
+               job->args[2], job->output[0] ? job->output : "-",
+               (unsigned long long)job->payload_bytes, job->seconds * 1000);
+        pthread_mutex_unlock(&sched->report);
+    }
+    return NULL;
+}
+
+/*
+ * Run every manifest job on a work-stealing pool and print the summary
+ */
+Status do_batch(BatchInfo *batchInfo)
+{
+    BatchScheduler sched;
+    CoverCache cache;
+    int workers = batchInfo->threads > 0 ? batchInfo->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers < 1)
+        workers = 1;
+    if ((size_t)workers > batchInfo->job_count && batchInfo->job_count > 0)
+        workers = batchInfo->job_count;
+    int inflight = batchInfo->max_inflight > 0 ? batchInfo->max_inflight : workers;
+
+    printf("-> %zu jobs, %d workers, %d jobs in flight", batchInfo->job_count, workers, inflight);
+    if (batchInfo->cache_mb > 0)
+        printf(", %d MB cover cache", batchInfo->cache_mb);
+    printf("\n\n");
+    if (batchInfo->cache_mb > 0 && cover_cache_init(&cache, (size_t)batchInfo->cache_mb * 1024 * 1024) != e_success)
+        return e_failure;
+
+    sched.batchInfo = batchInfo;
+    sched.workers = workers;
+    sched.finished = 0;
+    sched.deques = calloc(workers, sizeof(JobDeque));
+    pthread_t *threads = calloc(workers, sizeof(pthread_t));
+    BatchWorker *args = calloc(workers, sizeof(BatchWorker));
+    size_t per_worker = (batchInfo->job_count + workers - 1) / workers;
+    if (sched.deques == NULL || threads == NULL || args == NULL)
+    {
+        free(sched.deques);
+        free(threads);
+        free(args);
+        if (batchInfo->cache_mb > 0)
+            cover_cache_free(&cache);
+        return e_failure;
+    }
+
+    // Deal jobs round-robin so every deque starts with a similar mix
+    for (int w = 0; w < workers; w++)
+    {
+        pthread_mutex_init(&sched.deques[w].lock, NULL);
+        sched.deques[w].items = calloc(per_worker ? per_worker : 1, sizeof(size_t));
+    }
+    for (size_t i = 0; i < batchInfo->job_count; i++)
+    {
+        JobDeque *dq = &sched.deques[i % workers];
+        dq->items[dq->tail++] = i;
+        batchInfo->jobs[i].lsb_bits = batchInfo->lsb_bits;
+        batchInfo->jobs[i].compress = batchInfo->compress;
+        batchInfo->jobs[i].cover_cache = batchInfo->cache_mb > 0 ? &cache : NULL;
+    }
+    sem_init(&sched.inflight, 0, inflight);
+    pthread_mutex_init(&sched.report, NULL);
+
+    // Workers steal from every deque, so jobs dealt to a worker that
+    // could not be created still run; with no worker at all the calling
+    // thread drains the deques itself
+    double start = stats_now();
+    int started = 0;
+    for (int w = 0; w < workers; w++)
+    {
+        args[w].sched = &sched;
+        args[w].id = w;
+        if (pthread_create(&threads[started], NULL, batch_worker, &args[w]) != 0)
+            break;
+        started++;
+    }
+    if (started < workers)
+        fprintf(stderr, "WARNING: Started %d of %d batch workers\n", started, workers);
+    if (started == 0)
+        batch_worker(&args[0]);
+    for (int w = 0; w < started; w++)
+        pthread_join(threads[w], NULL);
+    double elapsed = stats_now() - start;
+
+    // Aggregate summary
+    size_t ok = 0;
+    uint64_t payload = 0;
+    double job_time = 0;
+    for (size_t i = 0; i < batchInfo->job_count; i++)
+    {
+        if (batchInfo->jobs[i].status == e_success)
+        {
+            ok++;
+            payload += batchInfo->jobs[i].payload_bytes;
+        }
+        job_time += batchInfo->jobs[i].seconds;
+    }
+    printf("\n-> Jobs        : %zu succeeded, %zu failed\n", ok, batchInfo->job_count - ok);
+    printf("-> Wall time   : %.3f s (%.3f s of job time)\n", elapsed, job_time);
+    if (elapsed > 0)
+    {
+        printf("-> Throughput  : %.1f jobs/s, %.2f MB/s payload\n",
+               batchInfo->job_count / elapsed, payload / (1024.0 * 1024.0) / elapsed);
+    }
+    if (batchInfo->cache_mb > 0)
+    {
+        cover_cache_print(&cache, "-> Cover cache : ");
+        cover_cache_free(&cache);
+    }
+
+    for (int w = 0; w < workers; w++)
+    {
+        pthread_mutex_destroy(&sched.deques[w].lock);
+        free(sched.deques[w].items);
+    }
+    sem_destroy(&sched.inflight);
+    pthread_mutex_destroy(&sched.report);
+    free(sched.deques);
+    free(threads);
+    free(args);
+    return ok == batchInfo->job_count ? e_success : e_failure;
+}
@@ -0,0 +1,56 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+#include "types.h" // Contains user defined types
+#include "cache.h" // Parsed covers kept in memory
+
+/*
+ * Batch mode
+ * ----------
+ * Runs many encode/decode jobs from a manifest in one process.
+ * Manifest lines (blank lines and lines starting with '#' are skipped):
+ *
+ *   e <cover.bmp> <secret_file> [output.bmp]
+ *   d <stego.bmp> [output_name]
+ */
+
+/* Longest manifest line accepted */
+#define BATCH_MAX_LINE 4096
+
+typedef struct _BatchJob
+{
+    OperationType op;           // e_encode or e_decode
+    char line[BATCH_MAX_LINE];  // Owns the strings args points into
+    char *args[6];              // argv-style arguments for the validators
+    Status status;              // Result of the job
+    double seconds;             // Wall time of the job
+    uint64_t payload_bytes;     // Secret bytes embedded or extracted
+    char output[256];           // Output file produced
+    int lsb_bits;               // Payload bits per pixel byte for encode jobs
+    int compress;               // LZ-compress the payload of encode jobs
+    CoverCache *cover_cache;    // Covers shared by the encode jobs, NULL when off
+} BatchJob;
+
+typedef struct _BatchInfo
+{
+    char *manifest_fname;  // Manifest file name
+    BatchJob *jobs;        // Parsed jobs
+    size_t job_count;      // Number of jobs
+    int threads;           // Worker threads (0 = one per online CPU)
+    int max_inflight;      // Jobs allowed to hold open files at once (0 = threads)
+    int lsb_bits;          // --lsb for every encode job (0 = 1)
+    int compress;          // --compress for every encode job
+    int cache_mb;          // --cache-mb: cover cache budget (0 = no cache)
+} BatchInfo;
+
+/* Read the manifest into BatchInfo.jobs */
+Status read_batch_manifest(BatchInfo *batchInfo);
+
+/* Run every job on the work-stealing pool and print the summary */
+Status do_batch(BatchInfo *batchInfo);
+
+/* Release the job list */
+void free_batch(BatchInfo *batchInfo);
+
+#endif
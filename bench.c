@@ -0,0 +1,1841 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "bench.h"
+#include "steg.h"
+#include "encode.h"
+#include "decode.h"
+#include "lsb.h"
+#include "bmp.h"
+#include "lz.h"
+#include "checksum.h"
+#include "scatter.h"
+#include "cipher.h"
+#include "serve.h"
+#include "cache.h"
+#include "stats.h"
+#include "types.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define bench_cycles() __rdtsc()
+#else
+#define bench_cycles() 0ULL
+#endif
+
+/* Payload bytes pushed through each kernel per microbenchmark round */
+#define KERNEL_BENCH_BYTES (1024 * 1024)
+#define KERNEL_BENCH_ROUNDS 16
+
+/*
+ * Fill a buffer with pseudo-random bytes (xorshift64*)
+ */
+void bench_fill_random(void *buffer, size_t len, uint64_t *state)
+{
+    unsigned char *p = buffer;
+    uint64_t x = *state ? *state : 0x9E3779B97F4A7C15ULL;
+    while (len > 0)
+    {
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        uint64_t r = x * 0x2545F4914F6CDD1DULL;
+        size_t n = len < 8 ? len : 8;
+        memcpy(p, &r, n);
+        p += n;
+        len -= n;
+    }
+    *state = x;
+}
+
+/*
+ * Write a 54 byte BMP header followed by random 24-bit pixels
+ */
+Status bench_write_bmp(FILE *fptr, uint width, uint height)
+{
+    unsigned char header[54] = {'B', 'M'};
+    uint row = (width * 3 + 3) & ~3u;
+    uint image_size = row * height;
+    uint file_size = 54 + image_size;
+    uint offset = 54, info_size = 40;
+    unsigned short planes = 1, bpp = 24;
+    uint64_t seed = width * 2654435761u + height;
+
+    memcpy(header + 2, &file_size, 4);
+    memcpy(header + 10, &offset, 4);
+    memcpy(header + 14, &info_size, 4);
+    memcpy(header + 18, &width, 4);
+    memcpy(header + 22, &height, 4);
+    memcpy(header + 26, &planes, 2);
+    memcpy(header + 28, &bpp, 2);
+    memcpy(header + 34, &image_size, 4);
+    fwrite(header, 54, 1, fptr);
+
+    unsigned char *pixels = calloc(row, 1);
+    if (pixels == NULL)
+        return e_failure;
+    for (uint y = 0; y < height; y++)
+    {
+        bench_fill_random(pixels, width * 3, &seed);
+        if (fwrite(pixels, 1, row, fptr) != row)
+        {
+            free(pixels);
+            return e_failure;
+        }
+    }
+    free(pixels);
+    fflush(fptr);
+    return e_success;
+}
+
+/*
+ * Legacy encoder: one 8 byte fread/fwrite pair per secret byte
+ */
+static void bench_legacy_encode(const char *data, size_t size, EncodeInfo *encInfo)
+{
+    char buffer[8];
+    for (size_t i = 0; i < size; i++)
+    {
+        fread(buffer, 8, 1, encInfo->fptr_src_image);
+        encode_byte_to_lsb(data[i], buffer);
+        fwrite(buffer, 8, 1, encInfo->fptr_stego_image);
+    }
+}
+
+/*
+ * Read back the pixel area of an encoded stream for comparison
+ */
+static char *bench_read_back(FILE *fptr, size_t size)
+{
+    char *buffer = malloc(size);
+    if (buffer == NULL)
+        return NULL;
+    fflush(fptr);
+    rewind(fptr);
+    if (fread(buffer, 1, size, fptr) != size)
+    {
+        free(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+/*
+ * Encode the same payload with the per-byte loop and the block engine,
+ * check that both outputs are identical and report throughput in MB/s
+ */
+Status run_encode_benchmark(size_t payload_kb)
+{
+    size_t size = payload_kb * 1024;
+    size_t pixels = size * 8;
+    uint width = 1024;
+    uint height = (pixels + width * 3 - 1) / (width * 3);
+
+    printf("-> Payload: %zu KB, cover: %ux%u (%.1f MB)\n",
+           payload_kb, width, height, width * 3.0 * height / (1024 * 1024));
+
+    char *data = malloc(size);
+    FILE *cover = tmpfile();
+    FILE *out_legacy = tmpfile();
+    FILE *out_block = tmpfile();
+    if (data == NULL || cover == NULL || out_legacy == NULL || out_block == NULL)
+    {
+        fprintf(stderr, "ERROR: Unable to set up benchmark buffers\n");
+        return e_failure;
+    }
+    for (size_t i = 0; i < size; i++)
+        data[i] = rand();
+    bench_write_bmp(cover, width, height);
+
+    EncodeInfo encInfo = {0};
+    encInfo.fptr_src_image = cover;
+    bmp_read_header(cover, &encInfo.bmp);
+
+    // Run 1: per-byte legacy loop
+    fseek(cover, 54, SEEK_SET);
+    encInfo.fptr_stego_image = out_legacy;
+    double start = stats_now();
+    bench_legacy_encode(data, size, &encInfo);
+    fflush(out_legacy);
+    double legacy = stats_now() - start;
+
+    // Run 2: block-buffered engine
+    fseek(cover, 54, SEEK_SET);
+    encInfo.carrier_pos = encInfo.pixel_pos = 0;
+    encInfo.fptr_stego_image = out_block;
+    start = stats_now();
+    Status ret = encode_data_to_image(data, size, &encInfo);
+    fflush(out_block);
+    double block = stats_now() - start;
+
+    // Outputs must be bit-identical
+    char *a = bench_read_back(out_legacy, pixels);
+    char *b = bench_read_back(out_block, pixels);
+    if (ret != e_success || a == NULL || b == NULL || memcmp(a, b, pixels) != 0)
+    {
+        printf("❌ ERROR: Block encoder output differs from per-byte encoder!\n");
+        ret = e_failure;
+    }
+    else
+    {
+        double mb = size / (1024.0 * 1024.0);
+        printf("-> Per-byte encode : %8.3f s  %8.2f MB/s payload\n", legacy, mb / legacy);
+        printf("-> Block encode    : %8.3f s  %8.2f MB/s payload\n", block, mb / block);
+        printf("-> Speedup         : %8.2fx\n", legacy / block);
+    }
+
+    free(encInfo.image_buffer);
+    free(encInfo.carrier_buffer);
+    free(a);
+    free(b);
+    free(data);
+    fclose(cover);
+    fclose(out_legacy);
+    fclose(out_block);
+    return ret;
+}
+
+/*
+ * Load a whole file into a new buffer
+ */
+static unsigned char *bench_load_file(const char *fname, size_t *len)
+{
+    FILE *fptr = fopen(fname, "rb");
+    unsigned char *buffer = NULL;
+    if (fptr == NULL)
+        return NULL;
+    fseeko(fptr, 0, SEEK_END);
+    *len = ftello(fptr);
+    rewind(fptr);
+    if ((buffer = malloc(*len)) != NULL && fread(buffer, 1, *len, fptr) != *len)
+    {
+        free(buffer);
+        buffer = NULL;
+    }
+    fclose(fptr);
+    return buffer;
+}
+
+/*
+ * Encode the same secret with the CLI pipeline and with libsteg, check
+ * that both images are identical and that steg_decode_mem returns the
+ * secret. The cover has padded rows so the gather/scatter path is used.
+ */
+Status run_library_benchmark(size_t payload_kb)
+{
+    size_t size = payload_kb * 1024;
+    uint width = 1021;
+    uint height = ((STEG_HEADER_SIZE + 2 + size) * 8 + width * 3 - 1) / (width * 3);
+    char dir[] = "/tmp/steg-bench-XXXXXX";
+    char cover[64], secret[64], stego[64];
+    size_t cover_len = 0, stego_len = 0, decoded_len = 0;
+
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("mkdtemp");
+        return e_failure;
+    }
+    snprintf(cover, sizeof(cover), "%s/cover.bmp", dir);
+    snprintf(secret, sizeof(secret), "%s/secret.txt", dir);
+    snprintf(stego, sizeof(stego), "%s/stego.bmp", dir);
+
+    printf("\n-> libsteg: %zu KB into a %ux%u padded cover\n", payload_kb, width, height);
+
+    // Reference image from the file-based encoder
+    FILE *fptr = fopen(cover, "wb");
+    Status ret = fptr != NULL ? bench_write_bmp(fptr, width, height) : e_failure;
+    if (fptr != NULL)
+        fclose(fptr);
+    EncodeInfo enc_info = {0};
+    enc_info.src_image_fname = cover;
+    enc_info.secret_fname = secret;
+    enc_info.stego_image_fname = stego;
+    enc_info.quiet = 1;
+    if (ret == e_success && bench_write_secret(secret, size) == e_success)
+        ret = do_encoding(&enc_info);
+    close_files(&enc_info);
+
+    unsigned char *cover_data = bench_load_file(cover, &cover_len);
+    unsigned char *stego_data = bench_load_file(stego, &stego_len);
+    unsigned char *secret_data = bench_load_file(secret, &size);
+    unsigned char *out = malloc(cover_len);
+    unsigned char *decoded = malloc(size);
+    char extn[STEG_MAX_EXTN + 1];
+
+    if (ret == e_success && cover_data != NULL && stego_data != NULL && secret_data != NULL &&
+        out != NULL && decoded != NULL)
+    {
+        double start = stats_now();
+        ret = steg_encode_mem(cover_data, cover_len, secret_data, size, out, ".txt");
+        double encode = stats_now() - start;
+
+        // Size query first, then the real decode
+        steg_decode_mem(out, cover_len, NULL, 0, &decoded_len, NULL);
+        start = stats_now();
+        if (ret == e_success && decoded_len == size)
+            ret = steg_decode_mem(out, cover_len, decoded, size, &decoded_len, extn);
+        double decode = stats_now() - start;
+
+        if (ret != e_success || stego_len != cover_len || memcmp(out, stego_data, cover_len) != 0 ||
+            decoded_len != size || memcmp(decoded, secret_data, size) != 0 || strcmp(extn, ".txt") != 0)
+        {
+            printf("❌ ERROR: libsteg output differs from the file-based encoder!\n");
+            ret = e_failure;
+        }
+        else
+        {
+            double mb = size / (1024.0 * 1024.0);
+            printf("-> steg_encode_mem : %8.3f s  %8.2f MB/s payload (identical to -e)\n", encode, mb / encode);
+            printf("-> steg_decode_mem : %8.3f s  %8.2f MB/s payload\n", decode, mb / decode);
+        }
+    }
+    else
+    {
+        ret = e_failure;
+    }
+
+    free(cover_data);
+    free(stego_data);
+    free(secret_data);
+    free(out);
+    free(decoded);
+    unlink(cover);
+    unlink(secret);
+    unlink(stego);
+    rmdir(dir);
+    return ret;
+}
+
+/*
+ * Check one kernel against encode_byte_to_lsb / decode_byte_from_lsb
+ * Covers every (payload byte, pixel byte) pair, every LSB pattern with
+ * every upper-bit pattern, all tail lengths and the 32-bit size fields
+ */
+static Status bench_verify_kernel(LsbKernel kernel)
+{
+    char data[256 + 80], out[256 + 80];
+    char ref[(256 + 80) * 8], img[(256 + 80) * 8];
+
+    for (int i = 0; i < 256; i++)
+        data[i] = i;
+    for (int i = 256; i < 256 + 80; i++)
+        data[i] = rand();
+
+    // Embed: all payload values against every pixel value
+    for (int p = 0; p < 256; p++)
+    {
+        memset(ref, p, sizeof(ref));
+        memset(img, p, sizeof(img));
+        for (int i = 0; i < 256 + 80; i++)
+            encode_byte_to_lsb(data[i], ref + i * 8);
+        lsb_embed_bytes_with(kernel, img, data, 256 + 80);
+        if (memcmp(ref, img, sizeof(img)) != 0)
+            return e_failure;
+    }
+
+    // Embed/extract: every length up to two full AVX2 blocks plus tail
+    for (size_t n = 0; n <= 80; n++)
+    {
+        for (size_t i = 0; i < sizeof(img); i++)
+            ref[i] = img[i] = rand();
+        for (size_t i = 0; i < n; i++)
+            encode_byte_to_lsb(data[256 + i], ref + i * 8);
+        lsb_embed_bytes_with(kernel, img, data + 256, n);
+        if (memcmp(ref, img, sizeof(img)) != 0)
+            return e_failure;
+
+        memset(out, 0, sizeof(out));
+        lsb_extract_bytes_with(kernel, out, img, n);
+        if (memcmp(out, data + 256, n) != 0)
+            return e_failure;
+    }
+
+    // Extract: every LSB pattern under every upper-bit pattern
+    for (int p = 0; p < 256; p++)
+    {
+        for (int i = 0; i < 256; i++)
+            for (int bit = 0; bit < 8; bit++)
+                img[i * 8 + bit] = (p & ~1) | ((i >> bit) & 1);
+        lsb_extract_bytes_with(kernel, out, img, 256);
+        for (int i = 0; i < 256; i++)
+        {
+            char ch;
+            decode_byte_from_lsb(&ch, img + i * 8);
+            if (ch != out[i])
+                return e_failure;
+        }
+    }
+
+    // Size fields: 4 little-endian bytes == encode_size_to_lsb
+    int sizes[] = {0, 1, 2, 4, 35, 255, 256, 65535, 100000, 0x7FFFFFFF, -1};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        int size;
+        for (int i = 0; i < 32; i++)
+            ref[i] = img[i] = rand();
+        encode_size_to_lsb(sizes[s], ref);
+        lsb_embed_bytes_with(kernel, img, (char *)&sizes[s], 4);
+        if (memcmp(ref, img, 32) != 0)
+            return e_failure;
+        lsb_extract_bytes_with(kernel, (char *)&size, img, 4);
+        decode_size_from_lsb(&sizes[s], ref);
+        if (size != sizes[s])
+            return e_failure;
+    }
+    return e_success;
+}
+
+/*
+ * Check the k-LSB kernels against a bit-by-bit reference: payload bit p
+ * goes to bit (p % bits) of carrier p / bits. Every length up to a few
+ * groups is tried so short last groups are covered.
+ */
+static Status bench_verify_bits(int bits)
+{
+    char data[64], out[64];
+    char ref[64 * 8], img[64 * 8];
+
+    for (size_t n = 0; n <= sizeof(data); n++)
+    {
+        for (size_t i = 0; i < sizeof(img); i++)
+            ref[i] = img[i] = rand();
+        for (size_t i = 0; i < n; i++)
+            data[i] = rand();
+
+        // The last carrier of a short group is padded with zero bits
+        for (size_t p = 0; p < lsb_carriers(n, bits) * bits; p++)
+        {
+            int bit = p < n * 8 ? (data[p / 8] >> (p % 8)) & 1 : 0;
+            ref[p / bits] = (ref[p / bits] & ~(1 << (p % bits))) | (bit << (p % bits));
+        }
+        lsb_embed_bits(img, data, n, bits);
+        if (memcmp(ref, img, sizeof(img)) != 0)
+            return e_failure;
+
+        memset(out, 0, sizeof(out));
+        lsb_extract_bits(out, img, n, bits);
+        if (memcmp(out, data, n) != 0)
+            return e_failure;
+    }
+    return e_success;
+}
+
+/*
+ * Check crc32c against the table version over every alignment and all
+ * short lengths, plus long ones that go through the 3-way SSE4.2 loop,
+ * and crc32c_combine at one split per length
+ * (buffer holds at least 64 KB + 8 bytes)
+ */
+static Status bench_verify_crc32c(const char *buffer)
+{
+    for (size_t len = 0; len <= 64 * 1024; len += len < 256 ? 1 : 4093)
+    {
+        for (size_t align = 0; align < 8; align++)
+            if (crc32c(len, buffer + align, len) != crc32c_sw(len, buffer + align, len))
+                return e_failure;
+
+        // Split point for crc32c_combine
+        size_t split = len / 3;
+        if (crc32c_combine(crc32c(0, buffer, split), crc32c(0, buffer + split, len - split), len - split) !=
+            crc32c(0, buffer, len))
+            return e_failure;
+    }
+    return e_success;
+}
+
+/*
+ * Verify every supported kernel, then time embed/extract in memory
+ * and report payload bytes per TSC cycle
+ */
+Status run_kernel_benchmark(void)
+{
+    char *data = malloc(KERNEL_BENCH_BYTES);
+    char *image = malloc(KERNEL_BENCH_BYTES * 8);
+    if (data == NULL || image == NULL)
+    {
+        free(data);
+        free(image);
+        return e_failure;
+    }
+    for (size_t i = 0; i < KERNEL_BENCH_BYTES; i++)
+        data[i] = rand();
+    for (size_t i = 0; i < KERNEL_BENCH_BYTES * 8; i++)
+        image[i] = rand();
+
+    Status ret = e_success;
+    double mb = (double)KERNEL_BENCH_BYTES * KERNEL_BENCH_ROUNDS / (1024 * 1024);
+    printf("\n-> LSB kernels (best: %s)\n", lsb_kernel_name(lsb_best_kernel()));
+    for (LsbKernel k = e_lsb_scalar; k < e_lsb_kernel_count; k++)
+    {
+        if (!lsb_kernel_supported(k))
+        {
+            printf("   %-7s: not supported on this CPU\n", lsb_kernel_name(k));
+            continue;
+        }
+        if (bench_verify_kernel(k) != e_success)
+        {
+            printf("❌ ERROR: %s kernel does not match the scalar reference!\n", lsb_kernel_name(k));
+            ret = e_failure;
+            continue;
+        }
+
+        double start = stats_now();
+        unsigned long long c0 = bench_cycles();
+        for (int r = 0; r < KERNEL_BENCH_ROUNDS; r++)
+            lsb_embed_bytes_with(k, image, data, KERNEL_BENCH_BYTES);
+        unsigned long long c1 = bench_cycles();
+        double embed = stats_now() - start;
+
+        start = stats_now();
+        for (int r = 0; r < KERNEL_BENCH_ROUNDS; r++)
+            lsb_extract_bytes_with(k, data, image, KERNEL_BENCH_BYTES);
+        unsigned long long c2 = bench_cycles();
+        double extract = stats_now() - start;
+
+        double bytes = (double)KERNEL_BENCH_BYTES * KERNEL_BENCH_ROUNDS;
+        printf("   %-7s: verified | embed %8.1f MB/s %6.3f B/cycle | extract %8.1f MB/s %6.3f B/cycle\n",
+               lsb_kernel_name(k), mb / embed, c1 > c0 ? bytes / (c1 - c0) : 0.0,
+               mb / extract, c2 > c1 ? bytes / (c2 - c1) : 0.0);
+    }
+
+    // k-LSB kernels: checked against a bit-by-bit reference, then timed
+    for (int bits = 2; ret == e_success && bits <= LSB_MAX_BITS; bits++)
+    {
+        if (bench_verify_bits(bits) != e_success)
+        {
+            printf("❌ ERROR: %d-bit LSB kernel does not match the reference!\n", bits);
+            ret = e_failure;
+            break;
+        }
+
+        double start = stats_now();
+        for (int r = 0; r < KERNEL_BENCH_ROUNDS; r++)
+            lsb_embed_bits(image, data, KERNEL_BENCH_BYTES, bits);
+        double embed = stats_now() - start;
+
+        start = stats_now();
+        for (int r = 0; r < KERNEL_BENCH_ROUNDS; r++)
+            lsb_extract_bits(data, image, KERNEL_BENCH_BYTES, bits);
+        double extract = stats_now() - start;
+
+        printf("   %d-bit  : verified | embed %8.1f MB/s                 | extract %8.1f MB/s (%zu image bytes per KB)\n",
+               bits, mb / embed, mb / extract, lsb_carriers(1024, bits));
+    }
+
+    // Payload CRC-32C against the table version, then timed
+    if (ret == e_success && bench_verify_crc32c(image) != e_success)
+    {
+        printf("❌ ERROR: crc32c does not match the table version!\n");
+        ret = e_failure;
+    }
+    if (ret == e_success)
+    {
+        double start = stats_now();
+        crc32c(0, image, (size_t)KERNEL_BENCH_BYTES * 8);
+        double hw = stats_now() - start;
+        start = stats_now();
+        crc32c_sw(0, image, (size_t)KERNEL_BENCH_BYTES * 8);
+        double sw = stats_now() - start;
+        printf("   crc32c : verified | %-6s %8.1f MB/s | table %8.1f MB/s\n",
+               crc32c_hw_supported() ? "sse4.2" : "table", 8 * mb / KERNEL_BENCH_ROUNDS / hw,
+               8 * mb / KERNEL_BENCH_ROUNDS / sw);
+    }
+
+    free(data);
+    free(image);
+    return ret;
+}
+
+/*
+ * Benchmark suite
+ * ---------------
+ * Synthetic covers of 1, 10 and 100 MP against secrets of 1 KB, 1 MB,
+ * 32 MB and 1 GB, plus one secret that fills each cover completely.
+ * Pairs whose secret does not fit the cover are skipped (a 1 GB secret
+ * needs a cover of about 2900 MP).
+ */
+static const uint bench_cover_mp[] = {1, 10, 100};
+static const uint64_t bench_secret_bytes[] = {1024ULL, 1024ULL * 1024, 32ULL * 1024 * 1024,
+                                              1024ULL * 1024 * 1024};
+
+/* Iterations per case: more for small cases so the percentiles mean something */
+static int bench_iterations(uint64_t cover_bytes)
+{
+    if (cover_bytes <= 4ULL * 1024 * 1024)
+        return 50;
+    if (cover_bytes <= 40ULL * 1024 * 1024)
+        return 10;
+    return 3;
+}
+
+static int bench_cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of a sorted sample */
+static double bench_percentile(const double *sorted, int count, double pct)
+{
+    int rank = (int)(pct / 100.0 * count + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    if (rank > count)
+        rank = count;
+    return sorted[rank - 1];
+}
+
+static long bench_peak_rss_kb(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/*
+ * Write a random secret file of the requested size
+ */
+Status bench_write_secret(const char *fname, uint64_t size)
+{
+    FILE *fptr = fopen(fname, "wb");
+    char *buffer = malloc(1024 * 1024);
+    uint64_t seed = size;
+    Status ret = (fptr != NULL && buffer != NULL) ? e_success : e_failure;
+
+    for (uint64_t done = 0; ret == e_success && done < size;)
+    {
+        size_t len = size - done < 1024 * 1024 ? size - done : 1024 * 1024;
+        bench_fill_random(buffer, len, &seed);
+        if (fwrite(buffer, 1, len, fptr) != len)
+            ret = e_failure;
+        done += len;
+    }
+    free(buffer);
+    if (fptr != NULL)
+        fclose(fptr);
+    return ret;
+}
+
+/*
+ * One timed encode through the normal pipeline
+ */
+static Status bench_encode_once(char *cover, char *secret, char *stego, const BenchOptions *opts, double *seconds)
+{
+    EncodeInfo enc_info = {0};
+    enc_info.src_image_fname = cover;
+    enc_info.secret_fname = secret;
+    enc_info.stego_image_fname = stego;
+    enc_info.threads = opts->threads;
+    enc_info.compress = opts->compress;
+    enc_info.key = opts->key;
+    enc_info.password = opts->password;
+    enc_info.quiet = 1;
+
+    double start = stats_now();
+    Status ret = do_encoding(&enc_info);
+    close_files(&enc_info);
+    *seconds = stats_now() - start;
+    return ret;
+}
+
+/*
+ * One timed decode through the normal pipeline
+ */
+static Status bench_decode_once(char *stego, char *output, const BenchOptions *opts, double *seconds)
+{
+    DecodeInfo dec_info = {0};
+    dec_info.stego_image_fname = stego;
+    dec_info.secret_fname = output;
+    dec_info.use_mmap = opts->use_mmap;
+    dec_info.threads = opts->threads;
+    dec_info.key = opts->key;
+    dec_info.password = opts->password;
+    dec_info.quiet = 1;
+
+    double start = stats_now();
+    Status ret = e_failure;
+    if (open_decoded_files(&dec_info) == e_success && skip_bmp_header(&dec_info) == e_success &&
+        decode_magic_string(&dec_info) == e_success)
+        ret = do_decoding(&dec_info);
+    close_decoded_files(&dec_info);
+    *seconds = stats_now() - start;
+    return ret;
+}
+
+/*
+ * Print one result line and append it to the results file
+ */
+static void bench_report(FILE *results, const char *op, uint mp, uint64_t cover_bytes, uint64_t secret,
+                         double *samples, int count)
+{
+    qsort(samples, count, sizeof(double), bench_cmp_double);
+    double p50 = bench_percentile(samples, count, 50);
+    double p99 = bench_percentile(samples, count, 99);
+    double mbps = secret / (1024.0 * 1024.0) / p50;
+    double image_mbps = cover_bytes / (1024.0 * 1024.0) / p50;
+    long rss = bench_peak_rss_kb();
+
+    printf("   %-6s %4u MP %12llu B  x%-3d p50 %9.3f ms  p99 %9.3f ms  %9.2f MB/s payload  %9.2f MB/s image  rss %ld KB\n",
+           op, mp, (unsigned long long)secret, count, p50 * 1000, p99 * 1000, mbps, image_mbps, rss);
+    if (results != NULL)
+        fprintf(results, "%s,%u,%llu,%llu,%d,%.6f,%.6f,%.3f,%.3f,%ld\n", op, mp,
+                (unsigned long long)cover_bytes, (unsigned long long)secret, count,
+                p50 * 1000, p99 * 1000, mbps, image_mbps, rss);
+}
+
+/*
+ * Run the synthetic encode/decode matrix
+ */
+Status run_bench_suite(const BenchOptions *opts)
+{
+    char dir[] = "/tmp/steg-bench-XXXXXX";
+    char cover[64], secret[64], stego[64], output[64], decoded[64];
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("mkdtemp");
+        return e_failure;
+    }
+    snprintf(cover, sizeof(cover), "%s/cover.bmp", dir);
+    snprintf(secret, sizeof(secret), "%s/secret.txt", dir);
+    snprintf(stego, sizeof(stego), "%s/stego.bmp", dir);
+    snprintf(output, sizeof(output), "%s/decoded", dir);
+    snprintf(decoded, sizeof(decoded), "%s/decoded.txt", dir);
+
+    FILE *results = fopen(opts->results_fname, "w");
+    if (results == NULL)
+        perror("fopen");
+    else
+        fprintf(results, "op,cover_mp,cover_bytes,secret_bytes,iterations,p50_ms,p99_ms,payload_mbps,image_mbps,peak_rss_kb\n");
+
+    printf("-> Suite up to %u MP, %d thread(s)%s, results in %s\n\n", opts->max_mp,
+           opts->threads > 1 ? opts->threads : 1, opts->use_mmap ? ", mmap decode" : "", opts->results_fname);
+
+    Status ret = e_success;
+    for (size_t c = 0; ret == e_success && c < sizeof(bench_cover_mp) / sizeof(bench_cover_mp[0]); c++)
+    {
+        uint mp = bench_cover_mp[c];
+        if (mp > opts->max_mp)
+            break;
+
+        // 1000 pixels wide, 1000 * mp rows
+        FILE *fptr = fopen(cover, "wb");
+        if (fptr == NULL || bench_write_bmp(fptr, 1000, 1000 * mp) != e_success)
+            ret = e_failure;
+        if (fptr != NULL)
+            fclose(fptr);
+        uint64_t cover_bytes = 1000ULL * 3000 * mp;
+        uint64_t capacity = cover_bytes / 8 - STEG_HEADER_SIZE - 2 - (opts->password != NULL ? CIPHER_HEAD_SIZE : 0);
+
+        size_t sizes = sizeof(bench_secret_bytes) / sizeof(bench_secret_bytes[0]);
+        for (size_t k = 0; ret == e_success && k <= sizes; k++)
+        {
+            // The last case fills the cover to capacity
+            uint64_t size = k < sizes ? bench_secret_bytes[k] : capacity;
+            if (size > capacity)
+            {
+                printf("   skip   %4u MP %12llu B  (secret larger than cover capacity)\n", mp, (unsigned long long)size);
+                continue;
+            }
+            if (bench_write_secret(secret, size) != e_success)
+            {
+                ret = e_failure;
+                break;
+            }
+
+            int count = bench_iterations(cover_bytes);
+            double *enc = malloc(count * sizeof(double));
+            double *dec = malloc(count * sizeof(double));
+            for (int i = 0; ret == e_success && i < count; i++)
+            {
+                if (bench_encode_once(cover, secret, stego, opts, &enc[i]) != e_success ||
+                    bench_decode_once(stego, output, opts, &dec[i]) != e_success)
+                {
+                    printf("❌ ERROR: Round trip failed for %u MP / %llu B\n", mp, (unsigned long long)size);
+                    ret = e_failure;
+                }
+            }
+            if (ret == e_success)
+            {
+                bench_report(results, "encode", mp, cover_bytes, size, enc, count);
+                bench_report(results, "decode", mp, cover_bytes, size, dec, count);
+            }
+            free(enc);
+            free(dec);
+        }
+    }
+
+    if (results != NULL)
+        fclose(results);
+    unlink(cover);
+    unlink(secret);
+    unlink(stego);
+    unlink(decoded);
+    rmdir(dir);
+    return ret;
+}
+
+/*
+ * Fill a buffer with text that looks like C source: tokens drawn from a
+ * small vocabulary, so it compresses roughly like the secrets the
+ * validator accepts
+ */
+static void bench_fill_text(char *buffer, size_t len, uint64_t *state)
+{
+    static const char *words[] = {
+        "int ", "char *", "return ", "Status ", "if (", "for (", "while (", ")\n", ");\n", "{\n", "}\n",
+        "    ", "        ", "encInfo->", "decInfo->", "size", "buffer", "data", "image", "bits", "len",
+        " = ", " == ", " + ", ", ", "0", "1", "8", "e_success", "e_failure", "printf(\"", "\\n\"",
+        "/* ", " */\n", "// Step ", "ERROR: ", "fread", "fwrite", "malloc", "free", "NULL", "size_t "};
+    size_t count = sizeof(words) / sizeof(words[0]);
+    size_t done = 0;
+
+    while (done < len)
+    {
+        uint64_t r;
+        bench_fill_random(&r, sizeof(r), state);
+        const char *word = words[r % count];
+        size_t n = strlen(word);
+        if (n > len - done)
+            n = len - done;
+        memcpy(buffer + done, word, n);
+        done += n;
+    }
+}
+
+/*
+ * Compress a buffer block by block and check the round trip
+ * Returns the compressed size (frame fields included), 0 on mismatch
+ */
+static uint64_t bench_lz_round_trip(const unsigned char *data, size_t size, unsigned char *packed,
+                                    unsigned char *block, double *compress, double *decompress)
+{
+    uint64_t total = 0;
+    *compress = *decompress = 0;
+    for (size_t offset = 0; offset < size; offset += LZ_BLOCK_SIZE)
+    {
+        size_t len = size - offset < LZ_BLOCK_SIZE ? size - offset : LZ_BLOCK_SIZE;
+        double start = stats_now();
+        size_t n = lz_compress(data + offset, len, packed, len - 1);
+        *compress += stats_now() - start;
+
+        size_t out_len = 0;
+        start = stats_now();
+        Status ret = n > 0 ? lz_decompress(packed, n, block, LZ_BLOCK_SIZE, &out_len) : e_success;
+        *decompress += stats_now() - start;
+        if (n > 0 && (ret != e_success || out_len != len || memcmp(block, data + offset, len) != 0))
+            return 0;
+        total += STREAM_FRAME_LEN_SIZE + (n > 0 ? n : len);
+    }
+    return total + STREAM_FRAME_LEN_SIZE;
+}
+
+/*
+ * Check the LZ codec on text and on random data, then time a text
+ * secret through the whole pipeline with and without --compress
+ */
+Status run_compression_benchmark(size_t payload_kb)
+{
+    size_t size = payload_kb * 1024;
+    unsigned char *text = malloc(size);
+    unsigned char *noise = malloc(size);
+    unsigned char *packed = malloc(LZ_BLOCK_SIZE);
+    unsigned char *block = malloc(LZ_BLOCK_SIZE);
+    uint64_t seed = 0x1f2e3d4c5b6a7988ULL;
+    Status ret = (text != NULL && noise != NULL && packed != NULL && block != NULL) ? e_success : e_failure;
+
+    printf("\n-> LZ compression: %zu KB in %d KB blocks\n", payload_kb, LZ_BLOCK_SIZE / 1024);
+
+    // Step 1: Codec round trips (random data must fall back to stored blocks)
+    if (ret == e_success)
+    {
+        bench_fill_text((char *)text, size, &seed);
+        bench_fill_random(noise, size, &seed);
+        const char *names[] = {"text", "random"};
+        unsigned char *inputs[] = {text, noise};
+        for (int i = 0; ret == e_success && i < 2; i++)
+        {
+            double compress, decompress;
+            uint64_t packed_size = bench_lz_round_trip(inputs[i], size, packed, block, &compress, &decompress);
+            if (packed_size == 0)
+            {
+                printf("❌ ERROR: LZ round trip failed on %s data!\n", names[i]);
+                ret = e_failure;
+                break;
+            }
+            double mb = size / (1024.0 * 1024.0);
+            if (packed_size >= size)
+                printf("   %-6s ratio %5.2fx  compress %9.2f MB/s  (blocks stored raw)\n", names[i],
+                       (double)size / packed_size, mb / compress);
+            else
+                printf("   %-6s ratio %5.2fx  compress %9.2f MB/s  decompress %9.2f MB/s\n", names[i],
+                       (double)size / packed_size, mb / compress, mb / decompress);
+        }
+    }
+
+    // Step 2: Plain and compressed encode/decode of the text secret
+    char dir[] = "/tmp/steg-bench-XXXXXX";
+    char cover[64], secret[64], stego[64], output[64], decoded[72];
+    if (ret == e_success && mkdtemp(dir) != NULL)
+    {
+        snprintf(cover, sizeof(cover), "%s/cover.bmp", dir);
+        snprintf(secret, sizeof(secret), "%s/secret.txt", dir);
+        snprintf(stego, sizeof(stego), "%s/stego.bmp", dir);
+        snprintf(output, sizeof(output), "%s/decoded", dir);
+        snprintf(decoded, sizeof(decoded), "%s.txt", output);
+
+        uint width = 1000;
+        uint height = ((STEG_HEADER_SIZE + 2 + size) * 8 + width * 3 - 1) / (width * 3);
+        FILE *fptr = fopen(cover, "wb");
+        ret = fptr != NULL ? bench_write_bmp(fptr, width, height) : e_failure;
+        if (fptr != NULL)
+            fclose(fptr);
+        fptr = fopen(secret, "wb");
+        if (fptr == NULL || fwrite(text, 1, size, fptr) != size)
+            ret = e_failure;
+        if (fptr != NULL)
+            fclose(fptr);
+
+        for (int compress = 0; ret == e_success && compress <= 1; compress++)
+        {
+            BenchOptions opts = {0};
+            opts.compress = compress;
+            double enc, dec;
+            size_t len = 0;
+            unsigned char *back = NULL;
+            if (bench_encode_once(cover, secret, stego, &opts, &enc) != e_success ||
+                bench_decode_once(stego, output, &opts, &dec) != e_success ||
+                (back = bench_load_file(decoded, &len)) == NULL || len != size || memcmp(back, text, size) != 0)
+            {
+                printf("❌ ERROR: %s round trip failed!\n", compress ? "Compressed" : "Plain");
+                ret = e_failure;
+            }
+            else
+            {
+                double mb = size / (1024.0 * 1024.0);
+                printf("   %-10s encode %8.3f s  %9.2f MB/s   decode %8.3f s  %9.2f MB/s\n",
+                       compress ? "--compress" : "plain", enc, mb / enc, dec, mb / dec);
+            }
+            free(back);
+        }
+        unlink(cover);
+        unlink(secret);
+        unlink(stego);
+        unlink(decoded);
+        rmdir(dir);
+    }
+    else if (ret == e_success)
+    {
+        perror("mkdtemp");
+        ret = e_failure;
+    }
+
+    free(text);
+    free(noise);
+    free(packed);
+    free(block);
+    return ret;
+}
+
+/*
+ * Embed (or extract) size bytes at 1 bit per carrier in the keyed
+ * blocked order over an in-memory carrier region: per block, generate
+ * the group order, gather, run the kernel, put back
+ */
+static void bench_scatter_pass(const ScatterMap *map, char *image, char *data, size_t size, int embed,
+                               uint32_t *perm, char *groups)
+{
+    size_t done = 0;
+    for (uint64_t block = 0; done < size; block++)
+    {
+        uint32_t n = scatter_block_groups(map, block);
+        uint32_t used = size - done < n ? (uint32_t)(size - done) : n;
+        char *carriers = image + scatter_block_carrier(map, block);
+
+        scatter_block_perm(map, block, perm, n);
+        scatter_gather_groups(groups, carriers, perm, used);
+        if (embed)
+        {
+            lsb_embed_bits(groups, data + done, used, 1);
+            scatter_put_groups(carriers, groups, perm, used);
+        }
+        else
+        {
+            lsb_extract_bits(data + done, groups, used, 1);
+        }
+        done += used;
+    }
+}
+
+/*
+ * Compare the embedding orders on an in-memory region of carriers: the
+ * sequential one, the keyed blocked order of --key, and one global
+ * shuffle of every group (the cache-hostile alternative). The blocked
+ * order is checked by extracting the payload back, then a keyed encode
+ * and decode runs through the file pipeline next to a plain one.
+ */
+Status run_scatter_benchmark(size_t payload_kb)
+{
+    size_t size = payload_kb * 1024;
+    char *image = malloc(size * 8);
+    char *groups = malloc(size * 8);
+    char *data = malloc(size);
+    char *back = malloc(size);
+    uint32_t *perm = malloc(size * sizeof(uint32_t));
+    uint64_t seed = 0x5ca77e2bee5eed01ULL;
+    ScatterMap map = {0};
+    Status ret = (image != NULL && groups != NULL && data != NULL && back != NULL && perm != NULL &&
+                  scatter_map_init(&map, scatter_key_seed("bench"), 0, size * 8) == e_success)
+                     ? e_success
+                     : e_failure;
+
+    printf("\n-> Keyed scattering: %zu KB payload, %d KB blocks\n", payload_kb, SCATTER_BLOCK_GROUPS * 8 / 1024);
+
+    // Step 1: Sequential, blocked and global orders over the same region
+    if (ret == e_success)
+    {
+        double mb = size / (1024.0 * 1024.0);
+        bench_fill_random(image, size * 8, &seed);
+        bench_fill_random(data, size, &seed);
+
+        double start = stats_now();
+        lsb_embed_bits(image, data, size, 1);
+        double seq_embed = stats_now() - start;
+        start = stats_now();
+        lsb_extract_bits(back, image, size, 1);
+        double seq_extract = stats_now() - start;
+
+        start = stats_now();
+        bench_scatter_pass(&map, image, data, size, 1, perm, groups);
+        double blk_embed = stats_now() - start;
+        start = stats_now();
+        bench_scatter_pass(&map, image, back, size, 0, perm, groups);
+        double blk_extract = stats_now() - start;
+        if (memcmp(back, data, size) != 0)
+        {
+            printf("❌ ERROR: Keyed blocked order does not extract the payload it embedded!\n");
+            ret = e_failure;
+        }
+
+        // One shuffle of every group in the region, generated like a block's
+        start = stats_now();
+        scatter_block_perm(&map, 0, perm, size);
+        scatter_gather_groups(groups, image, perm, size);
+        lsb_embed_bits(groups, data, size, 1);
+        scatter_put_groups(image, groups, perm, size);
+        double glb_embed = stats_now() - start;
+        start = stats_now();
+        scatter_block_perm(&map, 0, perm, size);
+        scatter_gather_groups(groups, image, perm, size);
+        lsb_extract_bits(back, groups, size, 1);
+        double glb_extract = stats_now() - start;
+        if (ret == e_success && memcmp(back, data, size) != 0)
+        {
+            printf("❌ ERROR: Global order does not extract the payload it embedded!\n");
+            ret = e_failure;
+        }
+
+        if (ret == e_success)
+        {
+            printf("   %-15s embed %9.2f MB/s   extract %9.2f MB/s\n", "sequential", mb / seq_embed, mb / seq_extract);
+            printf("   %-15s embed %9.2f MB/s   extract %9.2f MB/s   (verified, %.2fx the sequential time)\n", "keyed blocked",
+                   mb / blk_embed, mb / blk_extract, blk_embed / seq_embed);
+            printf("   %-15s embed %9.2f MB/s   extract %9.2f MB/s   (%.2fx the sequential time)\n", "global shuffle",
+                   mb / glb_embed, mb / glb_extract, glb_embed / seq_embed);
+        }
+    }
+
+    // Step 2: Plain and --key encode/decode through the file pipeline
+    char dir[] = "/tmp/steg-bench-XXXXXX";
+    char cover[64], secret[64], stego[64], output[64], decoded[72];
+    if (ret == e_success && mkdtemp(dir) != NULL)
+    {
+        snprintf(cover, sizeof(cover), "%s/cover.bmp", dir);
+        snprintf(secret, sizeof(secret), "%s/secret.txt", dir);
+        snprintf(stego, sizeof(stego), "%s/stego.bmp", dir);
+        snprintf(output, sizeof(output), "%s/decoded", dir);
+        snprintf(decoded, sizeof(decoded), "%s.txt", output);
+
+        uint width = 1000;
+        uint height = ((STEG_HEADER_SIZE + 2 + size) * 8 + SCATTER_BLOCK_GROUPS * 8 + width * 3 - 1) / (width * 3);
+        FILE *fptr = fopen(cover, "wb");
+        ret = fptr != NULL ? bench_write_bmp(fptr, width, height) : e_failure;
+        if (fptr != NULL)
+            fclose(fptr);
+        fptr = fopen(secret, "wb");
+        if (fptr == NULL || fwrite(data, 1, size, fptr) != size)
+            ret = e_failure;
+        if (fptr != NULL)
+            fclose(fptr);
+
+        for (int keyed = 0; ret == e_success && keyed <= 1; keyed++)
+        {
+            BenchOptions opts = {0};
+            opts.key = keyed ? "bench" : NULL;
+            double enc, dec;
+            size_t len = 0;
+            unsigned char *file = NULL;
+            if (bench_encode_once(cover, secret, stego, &opts, &enc) != e_success ||
+                bench_decode_once(stego, output, &opts, &dec) != e_success ||
+                (file = bench_load_file(decoded, &len)) == NULL || len != size || memcmp(file, data, size) != 0)
+            {
+                printf("❌ ERROR: %s round trip failed!\n", keyed ? "Keyed" : "Plain");
+                ret = e_failure;
+            }
+            else
+            {
+                double mb = size / (1024.0 * 1024.0);
+                printf("   %-10s encode %8.3f s  %9.2f MB/s   decode %8.3f s  %9.2f MB/s\n",
+                       keyed ? "--key" : "plain", enc, mb / enc, dec, mb / dec);
+            }
+            free(file);
+        }
+        unlink(cover);
+        unlink(secret);
+        unlink(stego);
+        unlink(decoded);
+        rmdir(dir);
+    }
+    else if (ret == e_success)
+    {
+        perror("mkdtemp");
+        ret = e_failure;
+    }
+
+    free(image);
+    free(groups);
+    free(data);
+    free(back);
+    free(perm);
+    free_scatter_map(&map);
+    return ret;
+}
+
+/*
+ * Known answers: SHA-256("abc") (FIPS 180-2), PBKDF2-HMAC-SHA256 of
+ * "password"/"salt" at 4096 rounds and the ChaCha20 block of RFC 8439
+ * section 2.3.2. Then the keystream XORed in uneven chunks must match
+ * one call over the whole buffer (two buffers of size bytes).
+ */
+static Status bench_verify_cipher(char *a, char *b, size_t size)
+{
+    static const unsigned char sha_abc[32] = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad};
+    static const unsigned char pbkdf2[32] = {
+        0xc5, 0xe4, 0x78, 0xd5, 0x92, 0x88, 0xc8, 0x41, 0xaa, 0x53, 0x0d, 0xb6, 0x84, 0x5c, 0x4c, 0x8d,
+        0x96, 0x28, 0x93, 0xa0, 0x01, 0xce, 0x4e, 0x11, 0xa4, 0x96, 0x38, 0x73, 0xaa, 0x98, 0x13, 0x4a};
+    static const unsigned char block[64] = {
+        0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15, 0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+        0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03, 0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+        0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09, 0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+        0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9, 0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e};
+    static const unsigned char nonce[12] = {0, 0, 0, 0x09, 0, 0, 0, 0x4a, 0, 0, 0, 0};
+    unsigned char key[32], out[64];
+    CipherCtx whole, parts;
+
+    sha256("abc", 3, out);
+    if (memcmp(out, sha_abc, 32) != 0)
+        return e_failure;
+    pbkdf2_sha256("password", 8, "salt", 4, 4096, out, 32);
+    if (memcmp(out, pbkdf2, 32) != 0)
+        return e_failure;
+    for (int i = 0; i < 32; i++)
+        key[i] = i;
+    chacha20_init(&whole, key, nonce);
+    chacha20_block(whole.key, 1, whole.nonce, out);
+    if (memcmp(out, block, 64) != 0)
+        return e_failure;
+
+    parts = whole;
+    memcpy(b, a, size);
+    chacha20_xor(&whole, a, size);
+    for (size_t done = 0, len = 1; done < size; done += len, len = len * 3 + 1)
+        chacha20_xor(&parts, b + done, len < size - done ? len : size - done);
+    return memcmp(a, b, size) == 0 ? e_success : e_failure;
+}
+
+/*
+ * Verify the cipher, then compare encrypting the whole payload before
+ * embedding it with the fused loop (each chunk encrypted, checksummed
+ * and embedded while in the cache), and time plain, --password and
+ * "encrypt to a file, then encode" through the file pipeline
+ */
+Status run_cipher_benchmark(size_t payload_kb)
+{
+    size_t size = payload_kb * 1024;
+    char *data = malloc(size);
+    char *copy = malloc(size);
+    char *image = malloc(size * 8);
+    uint64_t seed = 0xc4ac4a20c0ffee01ULL;
+    double kdf = 0;
+    Status ret = (data != NULL && copy != NULL && image != NULL) ? e_success : e_failure;
+
+    printf("\n-> Encryption: %zu KB payload, ChaCha20, PBKDF2-HMAC-SHA256 (%d rounds)\n", payload_kb,
+           CIPHER_KDF_ROUNDS);
+
+    // Step 1: Known answers and chunked keystream
+    if (ret == e_success)
+    {
+        bench_fill_random(data, size, &seed);
+        if (bench_verify_cipher(data, copy, size) != e_success)
+        {
+            printf("❌ ERROR: Cipher does not match its test vectors!\n");
+            ret = e_failure;
+        }
+    }
+
+    // Step 2: Separate passes against the fused chunk loop, in memory
+    if (ret == e_success)
+    {
+        static const unsigned char key[32] = {1};
+        static const unsigned char nonce[12] = {0};
+        CipherCtx ctx;
+        double mb = size / (1024.0 * 1024.0);
+        size_t chunk = ENCODE_CHUNK_SIZE / 8;
+        bench_fill_random(image, size * 8, &seed);
+
+        double start = stats_now();
+        unsigned char derived[32];
+        pbkdf2_sha256("bench", 5, "saltsaltsaltsalt", CIPHER_SALT_SIZE, CIPHER_KDF_ROUNDS, derived, 32);
+        kdf = stats_now() - start;
+
+        chacha20_init(&ctx, key, nonce);
+        start = stats_now();
+        chacha20_xor(&ctx, data, size);
+        uint32_t crc = crc32c(0, data, size);
+        lsb_embed_bits(image, data, size, 1);
+        double separate = stats_now() - start;
+
+        chacha20_init(&ctx, key, nonce);
+        start = stats_now();
+        chacha20_xor(&ctx, data, size);
+        double xor = stats_now() - start;
+
+        chacha20_init(&ctx, key, nonce);
+        uint32_t fused_crc = 0;
+        start = stats_now();
+        for (size_t done = 0; done < size; done += chunk)
+        {
+            size_t len = size - done < chunk ? size - done : chunk;
+            chacha20_xor(&ctx, data + done, len);
+            fused_crc = crc32c(fused_crc, data + done, len);
+            lsb_embed_bits(image + done * 8, data + done, len, 1);
+        }
+        double fused = stats_now() - start;
+
+        // Both loops saw the same ciphertext, and it decrypts back
+        lsb_extract_bits(copy, image, size, 1);
+        chacha20_init(&ctx, key, nonce);
+        chacha20_xor(&ctx, copy, size);
+        chacha20_init(&ctx, key, nonce);
+        chacha20_xor(&ctx, data, size);
+        if (crc != fused_crc || memcmp(copy, data, size) != 0)
+        {
+            printf("❌ ERROR: Fused loop does not match the separate passes!\n");
+            ret = e_failure;
+        }
+        else
+        {
+            printf("   vectors    : SHA-256, PBKDF2-HMAC-SHA256, ChaCha20 block and chunked keystream verified\n");
+            printf("   key        : %8.1f ms per password (once per image)\n", kdf * 1000);
+            printf("   chacha20   : %8.1f MB/s\n", mb / xor);
+            printf("   separate   : %8.1f MB/s   (encrypt all, checksum all, embed all)\n", mb / separate);
+            printf("   fused      : %8.1f MB/s   (%zu KB chunks, %.2fx the separate time)\n", mb / fused, chunk / 1024,
+                   fused / separate);
+        }
+    }
+
+    // Step 3: Plain, --password and a separate encryption tool through the file pipeline
+    char dir[] = "/tmp/steg-bench-XXXXXX";
+    char cover[64], secret[64], sealed[64], stego[64], output[64], decoded[72];
+    if (ret == e_success && mkdtemp(dir) != NULL)
+    {
+        snprintf(cover, sizeof(cover), "%s/cover.bmp", dir);
+        snprintf(secret, sizeof(secret), "%s/secret.txt", dir);
+        snprintf(sealed, sizeof(sealed), "%s/sealed.txt", dir);
+        snprintf(stego, sizeof(stego), "%s/stego.bmp", dir);
+        snprintf(output, sizeof(output), "%s/decoded", dir);
+        snprintf(decoded, sizeof(decoded), "%s.txt", output);
+
+        uint width = 1000;
+        uint height = ((STEG_HEADER_SIZE + 2 + CIPHER_HEAD_SIZE + size) * 8 + width * 3 - 1) / (width * 3);
+        FILE *fptr = fopen(cover, "wb");
+        ret = fptr != NULL ? bench_write_bmp(fptr, width, height) : e_failure;
+        if (fptr != NULL)
+            fclose(fptr);
+        fptr = fopen(secret, "wb");
+        if (fptr == NULL || fwrite(data, 1, size, fptr) != size)
+            ret = e_failure;
+        if (fptr != NULL)
+            fclose(fptr);
+
+        double mb = size / (1024.0 * 1024.0);
+        for (int mode = 0; ret == e_success && mode <= 2; mode++)
+        {
+            BenchOptions opts = {0};
+            opts.password = mode == 1 ? "bench" : NULL;
+            char *input = secret;
+            double enc = 0, dec, seal = 0;
+            size_t len = 0;
+            unsigned char *file = NULL;
+
+            // The separate tool reads the secret and writes an encrypted copy first
+            if (mode == 2)
+            {
+                static const unsigned char key[32] = {2};
+                static const unsigned char nonce[12] = {0};
+                CipherCtx ctx;
+                double start = stats_now();
+                unsigned char *plain = bench_load_file(secret, &len);
+                fptr = fopen(sealed, "wb");
+                if (plain != NULL && fptr != NULL)
+                {
+                    chacha20_init(&ctx, key, nonce);
+                    chacha20_xor(&ctx, plain, len);
+                    fwrite(plain, 1, len, fptr);
+                }
+                if (fptr != NULL)
+                    fclose(fptr);
+                free(plain);
+                seal = stats_now() - start;
+                input = sealed;
+            }
+
+            if (bench_encode_once(cover, input, stego, &opts, &enc) != e_success ||
+                bench_decode_once(stego, output, &opts, &dec) != e_success ||
+                (file = bench_load_file(decoded, &len)) == NULL || len != size ||
+                (mode != 2 && memcmp(file, data, size) != 0))
+            {
+                printf("❌ ERROR: %s round trip failed!\n", mode == 0 ? "Plain" : mode == 1 ? "Encrypted" : "Pre-encrypted");
+                ret = e_failure;
+            }
+            else
+            {
+                printf("   %-13s encode %8.3f s  %9.2f MB/s   decode %8.3f s  %9.2f MB/s\n",
+                       mode == 0 ? "plain" : mode == 1 ? "--password" : "tool + plain", seal + enc,
+                       mb / (seal + enc), dec, mb / dec);
+            }
+            free(file);
+        }
+        if (ret == e_success)
+            printf("   (--password times include one %.1f ms key derivation each)\n", kdf * 1000);
+        unlink(cover);
+        unlink(secret);
+        unlink(sealed);
+        unlink(stego);
+        unlink(decoded);
+        rmdir(dir);
+    }
+    else if (ret == e_success)
+    {
+        perror("mkdtemp");
+        ret = e_failure;
+    }
+
+    free(data);
+    free(copy);
+    free(image);
+    return ret;
+}
+
+/*
+ * One encode through a running daemon, the way the --connect client
+ * sends it (persistent: reuse the connection in *sock)
+ */
+static Status bench_serve_once(const char *socket_path, int *sock, char *cover, char *secret, char *stego,
+                               ServeReply *reply)
+{
+    ServeRequest request;
+    int fds[3];
+    Status ret = e_failure;
+
+    memset(&request, 0, sizeof(request));
+    request.magic = SERVE_MAGIC;
+    request.op = SERVE_OP_ENCODE;
+    request.fd_count = 3;
+    snprintf(request.names[0], SERVE_NAME_MAX, "%s", cover);
+    snprintf(request.names[1], SERVE_NAME_MAX, "%s", secret);
+    snprintf(request.names[2], SERVE_NAME_MAX, "%s", stego);
+    fds[0] = open(cover, O_RDONLY | O_CLOEXEC);
+    fds[1] = open(secret, O_RDONLY | O_CLOEXEC);
+    fds[2] = open(stego, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    int fresh = *sock < 0;
+    if (fresh)
+        *sock = serve_connect(socket_path);
+    if (fds[0] >= 0 && fds[1] >= 0 && fds[2] >= 0 && *sock >= 0 &&
+        serve_request(*sock, &request, fds, reply) == e_success)
+        ret = reply->status == e_success ? e_success : e_failure;
+    for (int i = 0; i < 3; i++)
+        if (fds[i] >= 0)
+            close(fds[i]);
+    return ret;
+}
+
+/*
+ * One encode as a separate process of this binary (what a script
+ * calling the CLI pays per request)
+ */
+static Status bench_spawn_once(char *cover, char *secret, char *stego)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0)
+        {
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+        }
+        char *argv[] = {"stegnography", "-e", cover, secret, stego, NULL};
+        execv("/proc/self/exe", argv);
+        _exit(127);
+    }
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid)
+        return e_failure;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? e_success : e_failure;
+}
+
+/*
+ * Small encodes one after the other: a process per request, the
+ * pipeline called in-process, and a daemon on a socket reached with a
+ * connection per request (the --connect client) or one kept open.
+ * The daemon's images must match the in-process ones byte for byte,
+ * and a decode through it must give the secret back.
+ */
+Status run_serve_benchmark(size_t payload_kb)
+{
+    size_t size = (payload_kb < 16 ? payload_kb : 16) * 1024;
+    int requests = 200;
+    int spawns = 20;
+    char dir[] = "/tmp/steg-bench-XXXXXX";
+    char cover[64], secret[64], local[64], remote[64], socket_path[64], output[64], decoded[72];
+    ServeServer server;
+    ServeReply reply;
+    Status ret = e_success;
+
+    printf("\n-> Daemon: %d encodes of a %zu KB payload (%d spawned)\n", requests, size / 1024, spawns);
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("mkdtemp");
+        return e_failure;
+    }
+    snprintf(cover, sizeof(cover), "%s/cover.bmp", dir);
+    snprintf(secret, sizeof(secret), "%s/secret.txt", dir);
+    snprintf(local, sizeof(local), "%s/local.bmp", dir);
+    snprintf(remote, sizeof(remote), "%s/remote.bmp", dir);
+    snprintf(socket_path, sizeof(socket_path), "%s/steg.sock", dir);
+    snprintf(output, sizeof(output), "%s/decoded", dir);
+    snprintf(decoded, sizeof(decoded), "%s.txt", output);
+
+    // Step 1: A cover just big enough, and the secret
+    uint width = 256;
+    uint height = ((STEG_HEADER_SIZE + 2 + size) * 8 + width * 3 - 1) / (width * 3);
+    FILE *fptr = fopen(cover, "wb");
+    ret = fptr != NULL ? bench_write_bmp(fptr, width, height) : e_failure;
+    if (fptr != NULL)
+        fclose(fptr);
+    if (ret == e_success)
+        ret = bench_write_secret(secret, size);
+    if (ret == e_success)
+        ret = serve_open(&server, socket_path, 1, NULL, 1);
+    if (ret != e_success)
+    {
+        printf("❌ ERROR: Unable to set up the daemon benchmark!\n");
+        unlink(cover);
+        unlink(secret);
+        rmdir(dir);
+        return e_failure;
+    }
+
+    // Step 2: Time every way of running the same request
+    BenchOptions opts = {0};
+    double spawn = 0, inproc = 0, connect = 0, persistent = 0, daemon = 0, seconds;
+    int sock = -1;
+
+    double start = stats_now();
+    for (int i = 0; ret == e_success && i < spawns; i++)
+        ret = bench_spawn_once(cover, secret, local);
+    spawn = (stats_now() - start) / spawns;
+
+    for (int i = 0; ret == e_success && i < requests; i++)
+    {
+        ret = bench_encode_once(cover, secret, local, &opts, &seconds);
+        inproc += seconds / requests;
+    }
+
+    start = stats_now();
+    for (int i = 0; ret == e_success && i < requests; i++)
+    {
+        ret = bench_serve_once(socket_path, &sock, cover, secret, remote, &reply);
+        close(sock);
+        sock = -1;
+    }
+    connect = (stats_now() - start) / requests;
+
+    start = stats_now();
+    for (int i = 0; ret == e_success && i < requests; i++)
+    {
+        ret = bench_serve_once(socket_path, &sock, cover, secret, remote, &reply);
+        daemon += reply.seconds / requests;
+    }
+    persistent = (stats_now() - start) / requests;
+    if (sock >= 0)
+        close(sock);
+
+    // Step 3: Same image as in-process, and it decodes back
+    size_t len_local = 0, len_remote = 0, len_secret = 0, len_decoded = 0;
+    unsigned char *a = NULL, *b = NULL, *c = NULL, *d = NULL;
+    if (ret == e_success)
+    {
+        a = bench_load_file(local, &len_local);
+        b = bench_load_file(remote, &len_remote);
+        ret = bench_decode_once(remote, output, &opts, &seconds);
+        c = bench_load_file(secret, &len_secret);
+        d = bench_load_file(decoded, &len_decoded);
+    }
+    if (ret != e_success || a == NULL || b == NULL || c == NULL || d == NULL || len_local != len_remote ||
+        memcmp(a, b, len_local) != 0 || len_secret != len_decoded || memcmp(c, d, len_secret) != 0)
+    {
+        printf("❌ ERROR: Daemon requests do not match the in-process pipeline!\n");
+        ret = e_failure;
+    }
+    else
+    {
+        printf("   outputs    : daemon images identical to in-process, decoded secret verified\n");
+        printf("   spawn      : %8.3f ms per request (fork + exec of the CLI)\n", spawn * 1000);
+        printf("   in-process : %8.3f ms per request\n", inproc * 1000);
+        printf("   --connect  : %8.3f ms per request (new connection each, %.1fx faster than spawning)\n",
+               connect * 1000, spawn / connect);
+        printf("   persistent : %8.3f ms per request (one connection, %.3f ms inside the daemon)\n",
+               persistent * 1000, daemon * 1000);
+    }
+    free(a);
+    free(b);
+    free(c);
+    free(d);
+
+    serve_close(&server);
+    unlink(cover);
+    unlink(secret);
+    unlink(local);
+    unlink(remote);
+    unlink(decoded);
+    rmdir(dir);
+    return ret;
+}
+
+/*
+ * One timed encode with the cover cache (NULL = read the cover file)
+ */
+static Status bench_cached_once(CoverCache *cache, char *cover, char *secret, char *stego, const char *key,
+                                double *seconds)
+{
+    EncodeInfo enc_info = {0};
+    enc_info.src_image_fname = cover;
+    enc_info.secret_fname = secret;
+    enc_info.stego_image_fname = stego;
+    enc_info.key = key;
+    enc_info.cover_cache = cache;
+    enc_info.quiet = 1;
+
+    double start = stats_now();
+    Status ret = do_encoding(&enc_info);
+    close_files(&enc_info);
+    *seconds = stats_now() - start;
+    return ret;
+}
+
+/*
+ * Two files hold the same bytes
+ */
+static int bench_same_file(const char *a, const char *b)
+{
+    size_t len_a = 0, len_b = 0;
+    unsigned char *data_a = bench_load_file(a, &len_a);
+    unsigned char *data_b = bench_load_file(b, &len_b);
+    int same = data_a != NULL && data_b != NULL && len_a == len_b && memcmp(data_a, data_b, len_a) == 0;
+    free(data_a);
+    free(data_b);
+    return same;
+}
+
+/*
+ * Repeated encodes into the same covers with and without the cover
+ * cache: the images must be identical (sequential and --key, on a
+ * cover with and one without row padding), the counters must add up,
+ * a rewritten cover must miss and a budget of one cover must evict
+ */
+Status run_cache_benchmark(size_t payload_kb)
+{
+    size_t size = (payload_kb < 64 ? payload_kb : 64) * 1024;
+    int rounds = 50;
+    char dir[] = "/tmp/steg-bench-XXXXXX";
+    char cover[64], odd[64], secret[64], plain[64], cached[64];
+    CoverCache cache;
+    Status ret = e_success;
+
+    printf("\n-> Cover cache: %d encodes of a %zu KB payload into a 2000x2000 cover\n", rounds, size / 1024);
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("mkdtemp");
+        return e_failure;
+    }
+    snprintf(cover, sizeof(cover), "%s/cover.bmp", dir);
+    snprintf(odd, sizeof(odd), "%s/odd.bmp", dir);
+    snprintf(secret, sizeof(secret), "%s/secret.txt", dir);
+    snprintf(plain, sizeof(plain), "%s/plain.bmp", dir);
+    snprintf(cached, sizeof(cached), "%s/cached.bmp", dir);
+
+    // Step 1: A large cover, a padded one (rows of 3 * 1001 bytes) and the secret
+    FILE *fptr = fopen(cover, "wb");
+    ret = fptr != NULL ? bench_write_bmp(fptr, 2000, 2000) : e_failure;
+    if (fptr != NULL)
+        fclose(fptr);
+    fptr = fopen(odd, "wb");
+    if (ret == e_success)
+        ret = fptr != NULL ? bench_write_bmp(fptr, 1001, 500) : e_failure;
+    if (fptr != NULL)
+        fclose(fptr);
+    if (ret == e_success)
+        ret = bench_write_secret(secret, size);
+    if (ret == e_success)
+        ret = cover_cache_init(&cache, (size_t)COVER_CACHE_DEFAULT_MB * 1024 * 1024);
+    if (ret != e_success)
+    {
+        printf("❌ ERROR: Unable to set up the cover cache benchmark!\n");
+        unlink(cover);
+        unlink(odd);
+        unlink(secret);
+        rmdir(dir);
+        return e_failure;
+    }
+
+    // Step 2: Same images with and without the cache: 2 misses, then hits
+    char *covers[] = {cover, odd};
+    const char *keys[] = {NULL, "bench"};
+    double seconds;
+    int checks = 0;
+    for (int c = 0; ret == e_success && c < 2; c++)
+        for (int k = 0; ret == e_success && k < 2; k++)
+        {
+            if (bench_cached_once(NULL, covers[c], secret, plain, keys[k], &seconds) != e_success ||
+                bench_cached_once(&cache, covers[c], secret, cached, keys[k], &seconds) != e_success ||
+                !bench_same_file(plain, cached))
+                ret = e_failure;
+            checks++;
+        }
+    if (ret == e_success && (cache.misses != 2 || cache.hits != 2))
+        ret = e_failure;
+
+    // Step 3: A rewritten cover misses and replaces the old copy
+    if (ret == e_success)
+    {
+        struct timespec times[2] = {{0, UTIME_OMIT}, {0, 0}};
+        clock_gettime(CLOCK_REALTIME, &times[1]);
+        times[1].tv_sec++;
+        if (utimensat(AT_FDCWD, odd, times, 0) != 0 ||
+            bench_cached_once(&cache, odd, secret, cached, NULL, &seconds) != e_success || cache.misses != 3 ||
+            cache.entries != 2)
+            ret = e_failure;
+    }
+
+    // Step 4: A budget of one cover evicts the other
+    CoverCache small;
+    if (ret == e_success && cover_cache_init(&small, cache.used - 1) == e_success)
+    {
+        for (int i = 0; ret == e_success && i < 4; i++)
+            ret = bench_cached_once(&small, covers[i % 2], secret, cached, NULL, &seconds);
+        if (small.misses != 4 || small.evictions != 3 || small.entries != 1)
+            ret = e_failure;
+        cover_cache_free(&small);
+    }
+
+    if (ret != e_success)
+    {
+        printf("❌ ERROR: Cover cache does not match the uncached encoder or its counters are off!\n");
+    }
+    else
+    {
+        // Step 5: Repeated encodes into the large cover
+        double uncached = 0, hit = 0;
+        for (int i = 0; ret == e_success && i < rounds; i++)
+        {
+            ret = bench_cached_once(NULL, cover, secret, plain, NULL, &seconds);
+            uncached += seconds / rounds;
+            if (ret == e_success)
+                ret = bench_cached_once(&cache, cover, secret, cached, NULL, &seconds);
+            hit += seconds / rounds;
+        }
+        if (ret == e_success)
+        {
+            printf("   outputs    : %d cached encodes identical to uncached (plain, --key, padded rows)\n", checks);
+            printf("   counters   : hits, misses, rewritten cover and LRU eviction verified\n");
+            printf("   uncached   : %8.3f ms per encode (parse and read the cover file)\n", uncached * 1000);
+            printf("   cached     : %8.3f ms per encode (%.2fx)\n", hit * 1000, uncached / hit);
+            cover_cache_print(&cache, "   cache      : ");
+        }
+    }
+
+    cover_cache_free(&cache);
+    unlink(cover);
+    unlink(odd);
+    unlink(secret);
+    unlink(plain);
+    unlink(cached);
+    rmdir(dir);
+    return ret;
+}
+
+/*
+ * One timed encode, synchronous (sync_io), through io_uring or through
+ * the I/O thread (io_thread); stats receives the pipeline counters
+ */
+static Status bench_pipeline_once(CoverCache *cache, char *cover, char *secret, char *stego, int sync_io,
+                                  int io_thread, StegStats *stats, double *seconds)
+{
+    EncodeInfo enc_info = {0};
+    enc_info.src_image_fname = cover;
+    enc_info.secret_fname = secret;
+    enc_info.stego_image_fname = stego;
+    enc_info.cover_cache = cache;
+    enc_info.sync_io = sync_io;
+    enc_info.async_io = !sync_io;
+    enc_info.io_thread = io_thread;
+    enc_info.stats = stats;
+    enc_info.quiet = 1;
+
+    double start = stats_now();
+    Status ret = do_encoding(&enc_info);
+    close_files(&enc_info);
+    *seconds = stats_now() - start;
+    return ret;
+}
+
+/*
+ * Synchronous encodes against the asynchronous pipeline, on io_uring and
+ * on the I/O thread: the images must be identical (on a cover with and
+ * one without row padding, and from the cover cache), then the timings
+ * and the share of the I/O hidden behind the embedding are compared
+ */
+Status run_pipeline_benchmark(size_t payload_kb)
+{
+    size_t size = (payload_kb > 4096 ? payload_kb : 4096) * 1024;
+    int rounds = 5;
+    char dir[] = "/tmp/steg-bench-XXXXXX";
+    char cover[64], odd[64], secret[64], plain[64], piped[64];
+    Status ret = e_success;
+
+    printf("\n-> Async pipeline: %zu KB payload into a 4000x3000 cover\n", size / 1024);
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("mkdtemp");
+        return e_failure;
+    }
+    snprintf(cover, sizeof(cover), "%s/cover.bmp", dir);
+    snprintf(odd, sizeof(odd), "%s/odd.bmp", dir);
+    snprintf(secret, sizeof(secret), "%s/secret.txt", dir);
+    snprintf(plain, sizeof(plain), "%s/plain.bmp", dir);
+    snprintf(piped, sizeof(piped), "%s/piped.bmp", dir);
+
+    // Step 1: A large cover, a padded one (rows of 3 * 4001 bytes) and the secret
+    FILE *fptr = fopen(cover, "wb");
+    ret = fptr != NULL ? bench_write_bmp(fptr, 4000, 3000) : e_failure;
+    if (fptr != NULL)
+        fclose(fptr);
+    fptr = fopen(odd, "wb");
+    if (ret == e_success)
+        ret = fptr != NULL ? bench_write_bmp(fptr, 4001, 3000) : e_failure;
+    if (fptr != NULL)
+        fclose(fptr);
+    if (ret == e_success)
+        ret = bench_write_secret(secret, size);
+    if (ret != e_success)
+    {
+        printf("❌ ERROR: Unable to set up the pipeline benchmark!\n");
+        unlink(cover);
+        unlink(odd);
+        unlink(secret);
+        rmdir(dir);
+        return e_failure;
+    }
+
+    // Step 2: Both engines write the same images as the synchronous loop,
+    // also when the cover comes from the cache
+    CoverCache cache;
+    int cache_ok = cover_cache_init(&cache, (size_t)COVER_CACHE_DEFAULT_MB * 1024 * 1024) == e_success;
+    char *covers[] = {cover, odd};
+    double seconds;
+    int checks = 0;
+    const char *engines[2] = {NULL, NULL};
+    for (int c = 0; ret == e_success && c < 2; c++)
+        for (int t = 0; ret == e_success && t < 2; t++)
+        {
+            StegStats stats = {0}, cached = {0};
+            if (bench_pipeline_once(NULL, covers[c], secret, plain, 1, 0, NULL, &seconds) != e_success ||
+                bench_pipeline_once(NULL, covers[c], secret, piped, 0, t, &stats, &seconds) != e_success ||
+                !bench_same_file(plain, piped) || stats.async.engine == NULL ||
+                (cache_ok && (bench_pipeline_once(&cache, covers[c], secret, piped, 0, t, &cached, &seconds) !=
+                                  e_success ||
+                              !bench_same_file(plain, piped) || cached.async.engine == NULL)))
+                ret = e_failure;
+            engines[t] = stats.async.engine;
+            checks += cache_ok ? 2 : 1;
+        }
+    if (cache_ok)
+        cover_cache_free(&cache);
+
+    if (ret != e_success)
+    {
+        printf("❌ ERROR: Asynchronous pipeline does not match the synchronous encoder!\n");
+    }
+    else
+    {
+        // Step 3: Repeated encodes into the large cover
+        double sync = 0, async[2] = {0, 0};
+        StegStats stats[2];
+        memset(stats, 0, sizeof(stats));
+        for (int i = 0; ret == e_success && i < rounds; i++)
+        {
+            ret = bench_pipeline_once(NULL, cover, secret, plain, 1, 0, NULL, &seconds);
+            sync += seconds / rounds;
+            for (int t = 0; ret == e_success && t < 2; t++)
+            {
+                ret = bench_pipeline_once(NULL, cover, secret, piped, 0, t, &stats[t], &seconds);
+                async[t] += seconds / rounds;
+            }
+        }
+        if (ret == e_success)
+        {
+            printf("   outputs    : %d pipelined encodes identical to synchronous (padded rows, cover cache)\n",
+                   checks);
+            printf("   synchronous: %8.3f ms per encode (--sync-io)\n", sync * 1000);
+            for (int t = 0; t < 2; t++)
+            {
+                AsyncStats *a = &stats[t].async;
+                printf("   %-11s: %8.3f ms per encode (%.2fx), %.1f%% of %.3f ms I/O overlapped\n", engines[t],
+                       async[t] * 1000, sync / async[t],
+                       a->io_seconds > a->wait_seconds ? 100 * (1 - a->wait_seconds / a->io_seconds) : 0.0,
+                       a->io_seconds * 1000 / rounds);
+            }
+            if (sysconf(_SC_NPROCESSORS_ONLN) < 2)
+                printf("   (one CPU: cached reads and writes are copies that compete with the embedding)\n");
+        }
+    }
+
+    unlink(cover);
+    unlink(odd);
+    unlink(secret);
+    unlink(plain);
+    unlink(piped);
+    rmdir(dir);
+    return ret;
+}
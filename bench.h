@@ -0,0 +1,67 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "types.h" // Contains user defined types
+
+/* Default payload size used by the benchmark (in KB) */
+#define BENCH_DEFAULT_PAYLOAD_KB 1024
+
+/* Default largest cover (in megapixels) and results file of the suite */
+#define BENCH_DEFAULT_MAX_MP 10
+#define BENCH_DEFAULT_RESULTS "bench_results.csv"
+
+typedef struct _BenchOptions
+{
+    uint max_mp;               // Largest synthetic cover in megapixels
+    const char *results_fname; // CSV file the results are written to
+    int threads;               // -j value passed to encode/decode
+    int use_mmap;              // Decode with --mmap
+    int compress;              // Encode with --compress
+    const char *key;           // Encode and decode with --key (NULL = sequential order)
+    const char *password;      // Encode and decode with --password (NULL = not encrypted)
+} BenchOptions;
+
+/* Benchmark function prototypes */
+
+/* Compare per-byte and block-buffered encoding throughput */
+Status run_encode_benchmark(size_t payload_kb);
+
+/* Verify the LSB kernels and report their bytes/cycle */
+Status run_kernel_benchmark(void);
+
+/* Time encode/decode over synthetic covers and secrets, write CSV results */
+Status run_bench_suite(const BenchOptions *opts);
+
+/* Check libsteg against the file-based encoder and time it */
+Status run_library_benchmark(size_t payload_kb);
+
+/* Verify the LZ codec and compare plain and --compress round trips */
+Status run_compression_benchmark(size_t payload_kb);
+
+/* Compare sequential, keyed blocked and globally shuffled embedding orders */
+Status run_scatter_benchmark(size_t payload_kb);
+
+/* Verify SHA-256, PBKDF2 and ChaCha20 and compare fused and separate encryption */
+Status run_cipher_benchmark(size_t payload_kb);
+
+/* Compare a daemon (--serve) with in-process and spawned encodes */
+Status run_serve_benchmark(size_t payload_kb);
+
+/* Verify the cover cache and compare cached and uncached encodes */
+Status run_cache_benchmark(size_t payload_kb);
+
+/* Compare synchronous encodes with the io_uring and I/O thread pipelines */
+Status run_pipeline_benchmark(size_t payload_kb);
+
+/* Fill a buffer with pseudo-random bytes */
+void bench_fill_random(void *buffer, size_t len, uint64_t *state);
+
+/* Write a random secret file of the requested size */
+Status bench_write_secret(const char *fname, uint64_t size);
+
+/* Write a synthetic 24-bit BMP with random pixel data */
+Status bench_write_bmp(FILE *fptr, uint width, uint height);
+
+#endif
@@ -0,0 +1,135 @@
+#include <string.h>
+#include <sys/types.h>
+#include "bmp.h"
+
+/* Compression types accepted for embedding */
+#define BI_RGB 0
+#define BI_BITFIELDS 3
+
+static uint32_t get_u32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get_u16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+/*
+ * Parse BITMAPFILEHEADER and the common part of the info header
+ * Accepts uncompressed 24-bit and 32-bit images with any info header
+ * version (INFO/V4/V5) and any bfOffBits
+ */
+Status bmp_parse_header(const unsigned char *buffer, size_t len, uint64_t file_size, BmpInfo *bmp)
+{
+    if (len < BMP_HEADER_PARSE_SIZE || buffer[0] != 'B' || buffer[1] != 'M')
+        return e_failure;
+
+    memset(bmp, 0, sizeof(*bmp));
+    bmp->data_offset = get_u32(buffer + 10);
+    bmp->info_size = get_u32(buffer + 14);
+    bmp->width = (int32_t)get_u32(buffer + 18);
+    bmp->height = (int32_t)get_u32(buffer + 22);
+    bmp->bpp = get_u16(buffer + 28);
+    bmp->compression = get_u32(buffer + 30);
+
+    // Only the old OS/2 core header (12 bytes) lacks these fields
+    if (bmp->info_size < 40 || bmp->data_offset < 14 + bmp->info_size)
+        return e_failure;
+    if (bmp->bpp != 24 && bmp->bpp != 32)
+        return e_failure;
+    if (bmp->compression != BI_RGB && !(bmp->compression == BI_BITFIELDS && bmp->bpp == 32))
+        return e_failure;
+    if (bmp->width <= 0 || bmp->height == 0 || bmp->height == INT32_MIN)
+        return e_failure;
+
+    // Rows are padded to a multiple of 4 bytes
+    uint64_t row_bytes = (uint64_t)bmp->width * (bmp->bpp / 8);
+    if (row_bytes > UINT32_MAX - 3)
+        return e_failure;
+    bmp->rows = bmp->height < 0 ? -(int64_t)bmp->height : bmp->height;
+    bmp->row_bytes = row_bytes;
+    bmp->stride = (bmp->row_bytes + 3) & ~3u;
+    bmp->capacity = (uint64_t)bmp->row_bytes * bmp->rows;
+
+    // The whole pixel array must be present
+    if (file_size != 0 && bmp->data_offset + (uint64_t)bmp->stride * bmp->rows > file_size)
+        return e_failure;
+    return e_success;
+}
+
+Status bmp_read_header(FILE *fptr, BmpInfo *bmp)
+{
+    unsigned char buffer[BMP_HEADER_PARSE_SIZE];
+
+    fseeko(fptr, 0, SEEK_END);
+    off_t file_size = ftello(fptr);
+    fseeko(fptr, 0, SEEK_SET);
+    if (fread(buffer, 1, sizeof(buffer), fptr) != sizeof(buffer))
+        return e_failure;
+    fseeko(fptr, 0, SEEK_SET);
+    return bmp_parse_header(buffer, sizeof(buffer), file_size > 0 ? file_size : 0, bmp);
+}
+
+void bmp_set_raw(BmpInfo *bmp)
+{
+    bmp->capacity = (uint64_t)bmp->stride * bmp->rows;
+    bmp->row_bytes = bmp->stride;
+}
+
+int bmp_is_contiguous(const BmpInfo *bmp)
+{
+    return bmp->row_bytes == bmp->stride;
+}
+
+uint64_t bmp_carrier_offset(const BmpInfo *bmp, uint64_t carrier)
+{
+    if (bmp_is_contiguous(bmp))
+        return carrier;
+    return (carrier / bmp->row_bytes) * bmp->stride + carrier % bmp->row_bytes;
+}
+
+uint64_t bmp_carriers_before(const BmpInfo *bmp, uint64_t offset)
+{
+    if (bmp_is_contiguous(bmp))
+        return offset;
+    uint64_t col = offset % bmp->stride;
+    return (offset / bmp->stride) * bmp->row_bytes + (col < bmp->row_bytes ? col : bmp->row_bytes);
+}
+
+/*
+ * Walk the carrier range one row run at a time
+ */
+static void bmp_copy_runs(const BmpInfo *bmp, char *block, uint64_t block_offset,
+                          uint64_t carrier, size_t n, char *buffer, int to_block)
+{
+    while (n > 0)
+    {
+        size_t run = bmp->row_bytes - carrier % bmp->row_bytes;
+        if (run > n)
+            run = n;
+
+        char *pixel = block + (bmp_carrier_offset(bmp, carrier) - block_offset);
+        if (to_block)
+            memcpy(pixel, buffer, run);
+        else
+            memcpy(buffer, pixel, run);
+
+        buffer += run;
+        carrier += run;
+        n -= run;
+    }
+}
+
+void bmp_gather(const BmpInfo *bmp, const char *block, uint64_t block_offset,
+                uint64_t carrier, size_t n, char *out)
+{
+    bmp_copy_runs(bmp, (char *)block, block_offset, carrier, n, out, 0);
+}
+
+void bmp_scatter(const BmpInfo *bmp, char *block, uint64_t block_offset,
+                 uint64_t carrier, size_t n, const char *in)
+{
+    bmp_copy_runs(bmp, block, block_offset, carrier, n, (char *)in, 1);
+}
@@ -0,0 +1,64 @@
+#ifndef BMP_H
+#define BMP_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * BMP header parser
+ * -----------------
+ * Only real pixel bytes carry payload bits ("carrier bytes"): the
+ * headers, palette and the padding at the end of every row are copied
+ * through untouched. Carrier byte c lives at file offset
+ *
+ *   data_offset + (c / row_bytes) * stride + (c % row_bytes)
+ */
+
+/* Bytes needed to parse the file header and the BITMAPINFOHEADER part */
+#define BMP_HEADER_PARSE_SIZE 54
+
+typedef struct _BmpInfo
+{
+    uint32_t data_offset;  // bfOffBits: start of the pixel array
+    uint32_t info_size;    // biSize: 40 (INFO), 108 (V4), 124 (V5), ...
+    int32_t width;         // Pixels per row
+    int32_t height;        // Rows (negative for top-down images)
+    uint16_t bpp;          // Bits per pixel (24 or 32)
+    uint32_t compression;  // BI_RGB (0) or BI_BITFIELDS (3)
+    uint32_t rows;         // Number of rows, |height|
+    uint32_t row_bytes;    // Pixel bytes per row (width * bpp / 8)
+    uint32_t stride;       // Row size in the file, padded to 4 bytes
+    uint64_t capacity;     // Carrier bytes in the image (row_bytes * rows)
+} BmpInfo;
+
+/* Parse the headers from a buffer; file_size 0 skips the size check */
+Status bmp_parse_header(const unsigned char *buffer, size_t len, uint64_t file_size, BmpInfo *bmp);
+
+/* Read and parse the headers of an open image (position is restored to 0) */
+Status bmp_read_header(FILE *fptr, BmpInfo *bmp);
+
+/* Treat every byte after data_offset as a carrier (original layout) */
+void bmp_set_raw(BmpInfo *bmp);
+
+/* True when carrier bytes are contiguous in the file (no row padding) */
+int bmp_is_contiguous(const BmpInfo *bmp);
+
+/* Offset of carrier byte c relative to data_offset */
+uint64_t bmp_carrier_offset(const BmpInfo *bmp, uint64_t carrier);
+
+/* Carrier bytes lying before offset (relative to data_offset) */
+uint64_t bmp_carriers_before(const BmpInfo *bmp, uint64_t offset);
+
+/*
+ * Copy n carrier bytes starting at carrier between a file block and a
+ * contiguous buffer. block holds the file bytes starting at block_offset
+ * (relative to data_offset).
+ */
+void bmp_gather(const BmpInfo *bmp, const char *block, uint64_t block_offset,
+                uint64_t carrier, size_t n, char *out);
+void bmp_scatter(const BmpInfo *bmp, char *block, uint64_t block_offset,
+                 uint64_t carrier, size_t n, const char *in);
+
+#endif
@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cache.h"
+
+Status cover_cache_init(CoverCache *cache, size_t budget)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->budget = budget;
+    return pthread_mutex_init(&cache->lock, NULL) == 0 ? e_success : e_failure;
+}
+
+static void cover_entry_free(CoverEntry *entry)
+{
+    free(entry->data);
+    free(entry);
+}
+
+/*
+ * Take an entry out of the LRU list; it is freed now if nobody uses it,
+ * otherwise by the last cover_cache_release (lock held)
+ */
+static void cover_cache_drop(CoverCache *cache, CoverEntry *entry)
+{
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        cache->head = entry->next;
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+    else
+        cache->tail = entry->prev;
+    cache->used -= entry->size;
+    cache->entries--;
+
+    if (entry->refs == 0)
+        cover_entry_free(entry);
+    else
+        entry->stale = 1;
+}
+
+/*
+ * Put an entry in front of the LRU list (lock held)
+ */
+static void cover_cache_push(CoverCache *cache, CoverEntry *entry)
+{
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head != NULL)
+        cache->head->prev = entry;
+    cache->head = entry;
+    if (cache->tail == NULL)
+        cache->tail = entry;
+}
+
+/*
+ * Entry for the file described by st, moved to the front; an entry of
+ * the same file with another size or mtime is out of date and dropped
+ * (lock held)
+ */
+static CoverEntry *cover_cache_find(CoverCache *cache, const struct stat *st)
+{
+    for (CoverEntry *entry = cache->head; entry != NULL; entry = entry->next)
+    {
+        if (entry->dev != st->st_dev || entry->ino != st->st_ino)
+            continue;
+        if (entry->size != st->st_size || entry->mtime.tv_sec != st->st_mtim.tv_sec ||
+            entry->mtime.tv_nsec != st->st_mtim.tv_nsec)
+        {
+            cover_cache_drop(cache, entry);
+            return NULL;
+        }
+        if (entry != cache->head)
+        {
+            entry->prev->next = entry->next;
+            if (entry->next != NULL)
+                entry->next->prev = entry->prev;
+            else
+                cache->tail = entry->prev;
+            cover_cache_push(cache, entry);
+        }
+        return entry;
+    }
+    return NULL;
+}
+
+/*
+ * Read the whole cover and parse its headers (no lock held, so other
+ * jobs keep hitting the cache while a miss is read)
+ */
+static CoverEntry *cover_entry_load(int fd, const struct stat *st)
+{
+    CoverEntry *entry = calloc(1, sizeof(CoverEntry));
+    if (entry == NULL || (entry->data = malloc(st->st_size)) == NULL)
+    {
+        free(entry);
+        return NULL;
+    }
+    entry->dev = st->st_dev;
+    entry->ino = st->st_ino;
+    entry->size = st->st_size;
+    entry->mtime = st->st_mtim;
+
+    for (off_t done = 0; done < st->st_size;)
+    {
+        ssize_t n = pread(fd, entry->data + done, st->st_size - done, done);
+        if (n <= 0)
+        {
+            cover_entry_free(entry);
+            return NULL;
+        }
+        done += n;
+    }
+    if (bmp_parse_header(entry->data, st->st_size, st->st_size, &entry->bmp) != e_success)
+    {
+        cover_entry_free(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+const CoverEntry *cover_cache_acquire(CoverCache *cache, int fd)
+{
+    struct stat st;
+    if (cache == NULL || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+        return NULL;
+
+    // Step 1: Hit
+    pthread_mutex_lock(&cache->lock);
+    CoverEntry *entry = cover_cache_find(cache, &st);
+    if (entry != NULL)
+    {
+        entry->refs++;
+        cache->hits++;
+        pthread_mutex_unlock(&cache->lock);
+        return entry;
+    }
+    if ((uint64_t)st.st_size > cache->budget)
+    {
+        cache->bypassed++;
+        pthread_mutex_unlock(&cache->lock);
+        return NULL;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    // Step 2: Miss, read the cover
+    CoverEntry *loaded = cover_entry_load(fd, &st);
+    if (loaded == NULL)
+        return NULL;
+
+    // Step 3: Insert it, unless another job got there first, and evict
+    // from the cold end until the budget holds
+    pthread_mutex_lock(&cache->lock);
+    cache->misses++;
+    entry = cover_cache_find(cache, &st);
+    if (entry != NULL)
+    {
+        cover_entry_free(loaded);
+    }
+    else
+    {
+        entry = loaded;
+        cover_cache_push(cache, entry);
+        cache->used += entry->size;
+        cache->entries++;
+        while (cache->used > cache->budget && cache->tail != entry)
+        {
+            cover_cache_drop(cache, cache->tail);
+            cache->evictions++;
+        }
+    }
+    entry->refs++;
+    pthread_mutex_unlock(&cache->lock);
+    return entry;
+}
+
+void cover_cache_release(CoverCache *cache, const CoverEntry *entry)
+{
+    if (cache == NULL || entry == NULL)
+        return;
+
+    CoverEntry *owned = (CoverEntry *)entry;
+    pthread_mutex_lock(&cache->lock);
+    if (--owned->refs == 0 && owned->stale)
+        cover_entry_free(owned);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void cover_cache_free(CoverCache *cache)
+{
+    while (cache->head != NULL)
+        cover_cache_drop(cache, cache->head);
+    pthread_mutex_destroy(&cache->lock);
+}
+
+void cover_cache_print(CoverCache *cache, const char *prefix)
+{
+    pthread_mutex_lock(&cache->lock);
+    uint64_t lookups = cache->hits + cache->misses + cache->bypassed;
+    printf("%s%llu hits, %llu misses (%.1f%% hit rate), %llu evicted, %llu too large\n", prefix,
+           (unsigned long long)cache->hits, (unsigned long long)cache->misses,
+           lookups ? 100.0 * cache->hits / lookups : 0.0, (unsigned long long)cache->evictions,
+           (unsigned long long)cache->bypassed);
+    printf("%s%zu covers, %.1f of %.1f MB\n", prefix, cache->entries, cache->used / (1024.0 * 1024.0),
+           cache->budget / (1024.0 * 1024.0));
+    pthread_mutex_unlock(&cache->lock);
+}
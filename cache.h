@@ -0,0 +1,84 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <time.h>
+#include "types.h" // Contains user defined types
+#include "bmp.h"   // BMP header parser
+
+/*
+ * Cover cache
+ * -----------
+ * Batch jobs and daemon requests often embed into the same few covers.
+ * The cache keeps each cover in memory, parsed, so a repeated encode
+ * takes the header, capacity and pixel bytes from memory instead of
+ * parsing and reading the cover file again; only the output is written.
+ *
+ * Covers are looked up by the open descriptor: device, inode, size and
+ * modification time identify the file, so a rewritten cover is a miss
+ * that replaces the old copy, and the daemon, which only receives
+ * descriptors, hits the same entries as a path would. Entries are kept
+ * in least-recently-used order and evicted once the total exceeds the
+ * memory budget; an entry in use by an encode is never freed under it.
+ * Covers larger than the whole budget are not cached.
+ */
+
+/* Default memory budget (in MB) of --batch and --serve */
+#define COVER_CACHE_DEFAULT_MB 256
+
+typedef struct _CoverEntry
+{
+    /* Key */
+    dev_t dev;               // Device of the cover file
+    ino_t ino;               // Inode of the cover file
+    off_t size;              // File size
+    struct timespec mtime;   // Last modification
+
+    /* Contents */
+    unsigned char *data;     // The whole cover file
+    BmpInfo bmp;             // Parsed headers
+    int refs;                // Encodes using the entry right now
+    int stale;               // Dropped from the cache, freed on last release
+
+    struct _CoverEntry *prev; // More recently used
+    struct _CoverEntry *next; // Less recently used
+} CoverEntry;
+
+typedef struct _CoverCache
+{
+    pthread_mutex_t lock;    // Guards the list and the counters
+    CoverEntry *head;        // Most recently used
+    CoverEntry *tail;        // Least recently used
+    size_t budget;           // Bytes the entries may hold
+    size_t used;             // Bytes the entries hold
+    size_t entries;          // Entries cached
+    uint64_t hits;           // Covers served from memory
+    uint64_t misses;         // Covers read from disk and cached
+    uint64_t evictions;      // Entries dropped to stay within the budget
+    uint64_t bypassed;       // Covers larger than the budget, not cached
+} CoverCache;
+
+/* Empty cache holding up to budget bytes of covers */
+Status cover_cache_init(CoverCache *cache, size_t budget);
+
+/* Drop every entry (none may be in use) */
+void cover_cache_free(CoverCache *cache);
+
+/*
+ * Cached copy of the cover open on fd, read and parsed on a miss.
+ * NULL when the cover is not cacheable (too large, not a regular file,
+ * not a BMP): the caller then reads the file as usual. Every entry
+ * returned must be given back with cover_cache_release.
+ */
+const CoverEntry *cover_cache_acquire(CoverCache *cache, int fd);
+
+/* Done with an entry from cover_cache_acquire (NULL is ignored) */
+void cover_cache_release(CoverCache *cache, const CoverEntry *entry);
+
+/* Print the counters, prefix starts every line */
+void cover_cache_print(CoverCache *cache, const char *prefix);
+
+#endif
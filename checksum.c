@@ -0,0 +1,208 @@
+#include <string.h>
+#include "checksum.h"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#endif
+
+/* Reflected CRC-32C polynomial */
+#define CRC32C_POLY 0x82F63B78u
+
+/* Bytes per stream of the 3-way interleaved SSE4.2 loop */
+#define CRC32C_LANE 4096
+
+/*
+ * Slicing-by-8 tables for the portable path and the tables that append
+ * CRC32C_LANE zero bytes to a CRC state, built once at load time
+ * (read-only afterwards, so every thread can use them)
+ */
+static uint32_t crc32c_table[8][256];
+static uint32_t crc32c_lane_shift[4][256];
+
+__attribute__((constructor)) static void crc32c_init_table(void)
+{
+    for (uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t crc = n;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (CRC32C_POLY & -(crc & 1));
+        crc32c_table[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; n++)
+        for (int k = 1; k < 8; k++)
+            crc32c_table[k][n] = (crc32c_table[k - 1][n] >> 8) ^ crc32c_table[0][crc32c_table[k - 1][n] & 0xFF];
+
+    // Appending zeros is linear in the state: run each state bit through
+    // CRC32C_LANE zero bytes once, then combine the bits of every byte value
+    static const unsigned char zeros[CRC32C_LANE];
+    uint32_t basis[32];
+    for (int bit = 0; bit < 32; bit++)
+        basis[bit] = ~crc32c_sw(~(1u << bit), zeros, sizeof(zeros));
+    for (int k = 0; k < 4; k++)
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t crc = 0;
+            for (int bit = 0; bit < 8; bit++)
+                if (n & (1u << bit))
+                    crc ^= basis[8 * k + bit];
+            crc32c_lane_shift[k][n] = crc;
+        }
+}
+
+/*
+ * Portable CRC-32C: 8 bytes per step through the slicing tables
+ */
+uint32_t crc32c_sw(uint32_t crc, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    crc = ~crc;
+    for (; len >= 8; len -= 8, p += 8)
+    {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = crc32c_table[7][lo & 0xFF] ^ crc32c_table[6][(lo >> 8) & 0xFF] ^
+              crc32c_table[5][(lo >> 16) & 0xFF] ^ crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][hi & 0xFF] ^ crc32c_table[2][(hi >> 8) & 0xFF] ^
+              crc32c_table[1][(hi >> 16) & 0xFF] ^ crc32c_table[0][hi >> 24];
+    }
+    while (len--)
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xFF];
+    return ~crc;
+}
+
+#ifdef CRC32C_X86
+
+/*
+ * State after CRC32C_LANE more zero bytes
+ */
+static uint32_t crc32c_shift_lane(uint32_t crc)
+{
+    return crc32c_lane_shift[0][crc & 0xFF] ^ crc32c_lane_shift[1][(crc >> 8) & 0xFF] ^
+           crc32c_lane_shift[2][(crc >> 16) & 0xFF] ^ crc32c_lane_shift[3][crc >> 24];
+}
+
+__attribute__((target("sse4.2")))
+static uint64_t crc32c_load_step(uint64_t crc, const unsigned char *p)
+{
+    uint64_t value;
+    memcpy(&value, p, 8);
+    return _mm_crc32_u64(crc, value);
+}
+
+/*
+ * SSE4.2 CRC32 instruction, 8 bytes per step
+ * The instruction has a 3-cycle latency but issues every cycle, so long
+ * buffers run as three independent streams over consecutive lanes; the
+ * streams are merged with the zero-append tables
+ * (crc(A B) = shift(crc(A)) ^ crc(B) on the raw state).
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    uint32_t state = ~crc;
+
+    for (; len >= 3 * CRC32C_LANE; len -= 3 * CRC32C_LANE, p += 3 * CRC32C_LANE)
+    {
+        uint64_t a = state, b = 0, c = 0;
+        for (size_t i = 0; i < CRC32C_LANE; i += 8)
+        {
+            a = crc32c_load_step(a, p + i);
+            b = crc32c_load_step(b, p + CRC32C_LANE + i);
+            c = crc32c_load_step(c, p + 2 * CRC32C_LANE + i);
+        }
+        state = crc32c_shift_lane(crc32c_shift_lane(a) ^ b) ^ c;
+    }
+
+    uint64_t crc64 = state;
+    for (; len >= 8; len -= 8, p += 8)
+        crc64 = crc32c_load_step(crc64, p);
+    state = crc64;
+    while (len--)
+        state = _mm_crc32_u8(state, *p++);
+    return ~state;
+}
+
+#endif /* CRC32C_X86 */
+
+/*
+ * GF(2) matrix helpers for crc32c_combine: a matrix is 32 columns, one
+ * per state bit
+ */
+static uint32_t gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+    uint32_t sum = 0;
+    for (; vec != 0; vec >>= 1, mat++)
+        if (vec & 1)
+            sum ^= *mat;
+    return sum;
+}
+
+static void gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+    for (int n = 0; n < 32; n++)
+        square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+/*
+ * CRC of a concatenation without the data: crc1 is run through len2
+ * zero bytes (the zero-append operator, squared for every bit of len2)
+ * and xored with crc2
+ */
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
+{
+    uint32_t even[32], odd[32];
+    if (len2 == 0)
+        return crc1;
+
+    // Operator for one zero bit, then two and four
+    odd[0] = CRC32C_POLY;
+    for (int n = 1; n < 32; n++)
+        odd[n] = 1u << (n - 1);
+    gf2_matrix_square(even, odd);
+    gf2_matrix_square(odd, even);
+
+    // Apply the operator for each set bit of len2 (in bytes)
+    do
+    {
+        gf2_matrix_square(even, odd);
+        if (len2 & 1)
+            crc1 = gf2_matrix_times(even, crc1);
+        len2 >>= 1;
+        if (len2 == 0)
+            break;
+        gf2_matrix_square(odd, even);
+        if (len2 & 1)
+            crc1 = gf2_matrix_times(odd, crc1);
+        len2 >>= 1;
+    } while (len2 != 0);
+    return crc1 ^ crc2;
+}
+
+/*
+ * Whether the SSE4.2 path is used on this CPU
+ */
+int crc32c_hw_supported(void)
+{
+#ifdef CRC32C_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return 0;
+#endif
+}
+
+/*
+ * CRC-32C with the fastest implementation the CPU supports
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len)
+{
+#ifdef CRC32C_X86
+    if (crc32c_hw_supported())
+        return crc32c_sse42(crc, data, len);
+#endif
+    return crc32c_sw(crc, data, len);
+}
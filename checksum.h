@@ -0,0 +1,19 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* CRC-32C (Castagnoli) over a buffer, continuing from crc (start with 0) */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+
+/* Portable table-driven version (used when SSE4.2 is missing, and by the benchmark) */
+uint32_t crc32c_sw(uint32_t crc, const void *data, size_t len);
+
+/* CRC-32C of A followed by B, from crc1 = crc32c(A), crc2 = crc32c(B) and the length of B */
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+/* Non-zero when crc32c() uses the SSE4.2 CRC32 instruction */
+int crc32c_hw_supported(void);
+
+#endif
@@ -0,0 +1,395 @@
+#include <string.h>
+#include <sys/random.h>
+#include "cipher.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CIPHER_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * SHA-256 (FIPS 180-4)
+ */
+typedef struct
+{
+    uint32_t state[8];
+    uint64_t length;          // Bytes hashed so far
+    unsigned char block[64];  // Pending partial block
+    size_t used;              // Bytes in block
+} Sha256Ctx;
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static uint32_t rotr32(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static uint32_t rotl32(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static uint32_t load_be32(const unsigned char *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void store_be32(unsigned char *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static uint32_t load_le32(const unsigned char *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void store_le32(unsigned char *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static void sha256_compress(uint32_t state[8], const unsigned char block[64])
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = load_be32(block + i * 4);
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+static void sha256_init(Sha256Ctx *ctx)
+{
+    static const uint32_t iv[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+static void sha256_update(Sha256Ctx *ctx, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    ctx->length += len;
+    while (len > 0)
+    {
+        size_t n = 64 - ctx->used < len ? 64 - ctx->used : len;
+        memcpy(ctx->block + ctx->used, p, n);
+        ctx->used += n;
+        p += n;
+        len -= n;
+        if (ctx->used == 64)
+        {
+            sha256_compress(ctx->state, ctx->block);
+            ctx->used = 0;
+        }
+    }
+}
+
+static void sha256_final(Sha256Ctx *ctx, unsigned char out[32])
+{
+    uint64_t bits = ctx->length * 8;
+    unsigned char pad[72] = {0x80};
+    size_t pad_len = (ctx->used < 56 ? 56 : 120) - ctx->used;
+    for (int i = 0; i < 8; i++)
+        pad[pad_len + i] = bits >> (56 - i * 8);
+    sha256_update(ctx, pad, pad_len + 8);
+    for (int i = 0; i < 8; i++)
+        store_be32(out + i * 4, ctx->state[i]);
+}
+
+void sha256(const void *data, size_t len, unsigned char out[32])
+{
+    Sha256Ctx ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, out);
+}
+
+/*
+ * PBKDF2-HMAC-SHA256. The HMAC inner and outer pad states are hashed
+ * once, so every iteration costs two compressions of a padded 32-byte
+ * digest.
+ */
+void pbkdf2_sha256(const void *password, size_t password_len, const void *salt, size_t salt_len,
+                   uint32_t rounds, unsigned char *out, size_t out_len)
+{
+    unsigned char key[64] = {0}, pad[64];
+    Sha256Ctx inner, outer, ctx;
+
+    // Step 1: HMAC key, hashed first when longer than a block
+    if (password_len > 64)
+        sha256(password, password_len, key);
+    else
+        memcpy(key, password, password_len);
+    for (int i = 0; i < 64; i++)
+        pad[i] = key[i] ^ 0x36;
+    sha256_init(&inner);
+    sha256_update(&inner, pad, 64);
+    for (int i = 0; i < 64; i++)
+        pad[i] = key[i] ^ 0x5c;
+    sha256_init(&outer);
+    sha256_update(&outer, pad, 64);
+
+    // Step 2: One 32-byte block T_i per counter i
+    for (uint32_t block = 1; out_len > 0; block++)
+    {
+        unsigned char u[32], t[32], counter[4];
+
+        // U_1 = HMAC(password, salt || i)
+        store_be32(counter, block);
+        ctx = inner;
+        sha256_update(&ctx, salt, salt_len);
+        sha256_update(&ctx, counter, 4);
+        sha256_final(&ctx, u);
+        ctx = outer;
+        sha256_update(&ctx, u, 32);
+        sha256_final(&ctx, u);
+        memcpy(t, u, 32);
+
+        // U_j = HMAC(password, U_j-1), T_i = U_1 ^ ... ^ U_rounds
+        for (uint32_t j = 1; j < rounds; j++)
+        {
+            ctx = inner;
+            sha256_update(&ctx, u, 32);
+            sha256_final(&ctx, u);
+            ctx = outer;
+            sha256_update(&ctx, u, 32);
+            sha256_final(&ctx, u);
+            for (int k = 0; k < 32; k++)
+                t[k] ^= u[k];
+        }
+
+        size_t n = out_len < 32 ? out_len : 32;
+        memcpy(out, t, n);
+        out += n;
+        out_len -= n;
+    }
+}
+
+/*
+ * ChaCha20 (RFC 8439)
+ */
+#define CHACHA_QR(a, b, c, d)          \
+    do                                 \
+    {                                  \
+        a += b, d = rotl32(d ^ a, 16); \
+        c += d, b = rotl32(b ^ c, 12); \
+        a += b, d = rotl32(d ^ a, 8);  \
+        c += d, b = rotl32(b ^ c, 7);  \
+    } while (0)
+
+void chacha20_block(const uint32_t key[8], uint32_t counter, const uint32_t nonce[3], unsigned char out[64])
+{
+    uint32_t input[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+                          key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+                          counter, nonce[0], nonce[1], nonce[2]};
+    uint32_t x[16];
+    memcpy(x, input, sizeof(x));
+
+    // 20 rounds: a column round and a diagonal round, ten times
+    for (int i = 0; i < 10; i++)
+    {
+        CHACHA_QR(x[0], x[4], x[8], x[12]);
+        CHACHA_QR(x[1], x[5], x[9], x[13]);
+        CHACHA_QR(x[2], x[6], x[10], x[14]);
+        CHACHA_QR(x[3], x[7], x[11], x[15]);
+        CHACHA_QR(x[0], x[5], x[10], x[15]);
+        CHACHA_QR(x[1], x[6], x[11], x[12]);
+        CHACHA_QR(x[2], x[7], x[8], x[13]);
+        CHACHA_QR(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; i++)
+        store_le32(out + i * 4, x[i] + input[i]);
+}
+
+#ifdef CIPHER_X86
+
+/*
+ * SSE2 keystream: four blocks at once, one block per 32-bit lane, so
+ * every quarter round works on four states; the rows are transposed
+ * back into block order before they are XORed into 256 bytes of data
+ */
+#define CHACHA_ROTL_SSE2(v, n) _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define CHACHA_QR_SSE2(a, b, c, d)                                            \
+    do                                                                       \
+    {                                                                        \
+        a = _mm_add_epi32(a, b), d = CHACHA_ROTL_SSE2(_mm_xor_si128(d, a), 16); \
+        c = _mm_add_epi32(c, d), b = CHACHA_ROTL_SSE2(_mm_xor_si128(b, c), 12); \
+        a = _mm_add_epi32(a, b), d = CHACHA_ROTL_SSE2(_mm_xor_si128(d, a), 8);  \
+        c = _mm_add_epi32(c, d), b = CHACHA_ROTL_SSE2(_mm_xor_si128(b, c), 7);  \
+    } while (0)
+
+__attribute__((target("sse2")))
+static void chacha20_xor4_sse2(const uint32_t key[8], uint32_t counter, const uint32_t nonce[3], unsigned char *p)
+{
+    const uint32_t words[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+                                key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+                                counter, nonce[0], nonce[1], nonce[2]};
+    __m128i in[16], x[16];
+    for (int i = 0; i < 16; i++)
+        in[i] = x[i] = _mm_set1_epi32(words[i]);
+    in[12] = x[12] = _mm_add_epi32(in[12], _mm_set_epi32(3, 2, 1, 0));
+
+    for (int i = 0; i < 10; i++)
+    {
+        CHACHA_QR_SSE2(x[0], x[4], x[8], x[12]);
+        CHACHA_QR_SSE2(x[1], x[5], x[9], x[13]);
+        CHACHA_QR_SSE2(x[2], x[6], x[10], x[14]);
+        CHACHA_QR_SSE2(x[3], x[7], x[11], x[15]);
+        CHACHA_QR_SSE2(x[0], x[5], x[10], x[15]);
+        CHACHA_QR_SSE2(x[1], x[6], x[11], x[12]);
+        CHACHA_QR_SSE2(x[2], x[7], x[8], x[13]);
+        CHACHA_QR_SSE2(x[3], x[4], x[9], x[14]);
+    }
+
+    // Words 4j..4j+3 of the four blocks: a 4x4 transpose gives 16 bytes of each block
+    for (int j = 0; j < 4; j++)
+    {
+        __m128i a = _mm_add_epi32(x[4 * j], in[4 * j]);
+        __m128i b = _mm_add_epi32(x[4 * j + 1], in[4 * j + 1]);
+        __m128i c = _mm_add_epi32(x[4 * j + 2], in[4 * j + 2]);
+        __m128i d = _mm_add_epi32(x[4 * j + 3], in[4 * j + 3]);
+        __m128i ab_lo = _mm_unpacklo_epi32(a, b), cd_lo = _mm_unpacklo_epi32(c, d);
+        __m128i ab_hi = _mm_unpackhi_epi32(a, b), cd_hi = _mm_unpackhi_epi32(c, d);
+        __m128i rows[4] = {_mm_unpacklo_epi64(ab_lo, cd_lo), _mm_unpackhi_epi64(ab_lo, cd_lo),
+                           _mm_unpacklo_epi64(ab_hi, cd_hi), _mm_unpackhi_epi64(ab_hi, cd_hi)};
+        for (int k = 0; k < 4; k++)
+        {
+            __m128i *q = (__m128i *)(p + k * 64 + j * 16);
+            _mm_storeu_si128(q, _mm_xor_si128(_mm_loadu_si128(q), rows[k]));
+        }
+    }
+}
+
+static int chacha20_sse2_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+#endif
+
+void chacha20_init(CipherCtx *ctx, const unsigned char key[32], const unsigned char nonce[12])
+{
+    for (int i = 0; i < 8; i++)
+        ctx->key[i] = load_le32(key + i * 4);
+    for (int i = 0; i < 3; i++)
+        ctx->nonce[i] = load_le32(nonce + i * 4);
+    ctx->offset = 0;
+}
+
+/*
+ * The keystream position is a byte offset, so chunks of any length can
+ * follow each other: a block cut by the previous call is regenerated and
+ * its remaining bytes used first. Whole runs of four blocks go through
+ * the SSE2 kernel when the CPU has it.
+ */
+void chacha20_xor(CipherCtx *ctx, void *data, size_t len)
+{
+    unsigned char *p = data;
+    unsigned char stream[64];
+#ifdef CIPHER_X86
+    int sse2 = len >= 256 && chacha20_sse2_supported();
+#endif
+
+    while (len > 0)
+    {
+        size_t skip = ctx->offset % 64;
+#ifdef CIPHER_X86
+        if (sse2 && skip == 0 && len >= 256)
+        {
+            chacha20_xor4_sse2(ctx->key, (uint32_t)(ctx->offset / 64), ctx->nonce, p);
+            p += 256;
+            len -= 256;
+            ctx->offset += 256;
+            continue;
+        }
+#endif
+        size_t n = 64 - skip < len ? 64 - skip : len;
+        chacha20_block(ctx->key, (uint32_t)(ctx->offset / 64), ctx->nonce, stream);
+        for (size_t i = 0; i < n; i++)
+            p[i] ^= stream[skip + i];
+        p += n;
+        len -= n;
+        ctx->offset += n;
+    }
+}
+
+/*
+ * Key and check value from the password and salt: the first 32 derived
+ * bytes are the ChaCha20 key, the next 4 the check
+ */
+static uint32_t cipher_derive(CipherCtx *ctx, const char *password, const unsigned char *salt, uint32_t rounds)
+{
+    unsigned char derived[36];
+    static const unsigned char nonce[12] = {0};
+
+    pbkdf2_sha256(password, strlen(password), salt, CIPHER_SALT_SIZE, rounds, derived, sizeof(derived));
+    chacha20_init(ctx, derived, nonce);
+    uint32_t check = load_le32(derived + 32);
+    memset(derived, 0, sizeof(derived));
+    return check;
+}
+
+Status cipher_init_encrypt(CipherCtx *ctx, const char *password, unsigned char head[CIPHER_HEAD_SIZE])
+{
+    // The salt must never repeat under one password, so there is no
+    // weaker fallback when the kernel cannot supply random bytes
+    if (getrandom(head, CIPHER_SALT_SIZE, 0) != CIPHER_SALT_SIZE)
+        return e_failure;
+    store_le32(head + 16, CIPHER_KDF_ROUNDS);
+    store_le32(head + 20, cipher_derive(ctx, password, head, CIPHER_KDF_ROUNDS));
+    return e_success;
+}
+
+Status cipher_init_decrypt(CipherCtx *ctx, const char *password, const unsigned char head[CIPHER_HEAD_SIZE])
+{
+    uint32_t rounds = load_le32(head + 16);
+    if (rounds == 0 || rounds > CIPHER_KDF_MAX_ROUNDS)
+        return e_failure;
+    return cipher_derive(ctx, password, head, rounds) == load_le32(head + 20) ? e_success : e_failure;
+}
@@ -0,0 +1,80 @@
+#ifndef CIPHER_H
+#define CIPHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * Encrypted payloads (--password)
+ * -------------------------------
+ * The secret is encrypted with ChaCha20 (RFC 8439) while it is embedded:
+ * every chunk read from the secret file is XORed with the keystream and
+ * embedded while it is still in the cache, and the decoder XORs every
+ * extracted chunk before writing it. No intermediate file, no second
+ * pass over the data.
+ *
+ * The key is derived from the password with PBKDF2-HMAC-SHA256 over a
+ * random salt, so every image gets its own key and the nonce can stay
+ * zero. The payload starts with a cipher head, little-endian:
+ *
+ *   offset size field
+ *   0      16   salt         (random, per image)
+ *   16     4    kdf_rounds   (PBKDF2 iterations)
+ *   20     4    check        (recognises the password)
+ *
+ * followed by the ciphertext. payload_size and payload_crc cover the
+ * head and the ciphertext, so a corrupted image is still told apart
+ * from a wrong password without decrypting anything. There is no MAC:
+ * the CRC catches damage, not deliberate tampering.
+ *
+ * The block counter is 32 bits wide and the nonce is fixed, so one key
+ * yields 2^32 blocks of 64 bytes before the keystream would repeat:
+ * payloads above CIPHER_MAX_PAYLOAD (256 GiB of ciphertext) are refused
+ * by the encoder and by the decoder.
+ */
+
+/* Bytes of the cipher head (a multiple of every LSB depth, so the
+   ciphertext starts on a fresh k-LSB group) */
+#define CIPHER_HEAD_SIZE 24
+#define CIPHER_SALT_SIZE 16
+
+/* Most ciphertext bytes one key may encrypt (2^32 keystream blocks) */
+#define CIPHER_MAX_PAYLOAD ((uint64_t)1 << 38)
+
+/* PBKDF2 iterations written by the encoder, and the most a decoder
+   accepts from an image */
+#define CIPHER_KDF_ROUNDS 100000
+#define CIPHER_KDF_MAX_ROUNDS 10000000
+
+typedef struct _CipherCtx
+{
+    uint32_t key[8];    // ChaCha20 key words
+    uint32_t nonce[3];  // ChaCha20 nonce words
+    uint64_t offset;    // Keystream position of the next byte
+} CipherCtx;
+
+/* SHA-256 of a buffer */
+void sha256(const void *data, size_t len, unsigned char out[32]);
+
+/* PBKDF2-HMAC-SHA256 (RFC 8018), out_len bytes of derived key */
+void pbkdf2_sha256(const void *password, size_t password_len, const void *salt, size_t salt_len,
+                   uint32_t rounds, unsigned char *out, size_t out_len);
+
+/* One 64-byte ChaCha20 keystream block */
+void chacha20_block(const uint32_t key[8], uint32_t counter, const uint32_t nonce[3], unsigned char out[64]);
+
+/* Set the key and nonce, keystream position 0 */
+void chacha20_init(CipherCtx *ctx, const unsigned char key[32], const unsigned char nonce[12]);
+
+/* XOR len bytes with the keystream at ctx->offset and advance it */
+void chacha20_xor(CipherCtx *ctx, void *data, size_t len);
+
+/* Fresh salt and key for the encoder; writes the cipher head (fails
+   when no random salt can be drawn) */
+Status cipher_init_encrypt(CipherCtx *ctx, const char *password, unsigned char head[CIPHER_HEAD_SIZE]);
+
+/* Key from the cipher head read back; fails on a wrong password */
+Status cipher_init_decrypt(CipherCtx *ctx, const char *password, const unsigned char head[CIPHER_HEAD_SIZE]);
+
+#endif
@@ -1,7 +1,18 @@
 #ifndef COMMON_H
 #define COMMON_H
 
-/* Magic string to identify whether stegged or not */
+/* Magic string to identify whether stegged or not (original layout) */
 #define MAGIC_STRING "#*"
 
+/* Magic string of images carrying the versioned stego header */
+#define MAGIC_STRING_V2 "#@"
+
+/* Print a progress line unless the run is quiet (batch jobs) */
+#define STEP_PRINT(info, ...)         \
+    do                                \
+    {                                 \
+        if (!(info)->quiet)           \
+            printf(__VA_ARGS__);      \
+    } while (0)
+
 #endif
@@ -1,8 +1,19 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "decode.h"
 #include "types.h"
 #include "common.h"
+#include "lsb.h"
+#include "header.h"
+#include "bmp.h"
+#include "lz.h"
+#include "checksum.h"
 
 /*
  * Checks if the given file name has a valid extension (like .bmp)
@@ -44,8 +55,9 @@ Status read_and_validate_decode_args(char *argv[], DecodeInfo *decInfo)
 {
     char *bmp_ext[] = {".bmp"};
 
-    // Validate the input image file
-    if (validate_file_extension_decode(argv[2], bmp_ext, 1) == e_success)
+    // Validate the input image file ("-" is stdin in --stream mode)
+    if ((decInfo->stream && strcmp(argv[2], "-") == 0) ||
+        validate_file_extension_decode(argv[2], bmp_ext, 1) == e_success)
     {
         decInfo->stego_image_fname = argv[2];
     }
@@ -58,66 +70,231 @@ Status read_and_validate_decode_args(char *argv[], DecodeInfo *decInfo)
     // If user didn’t give an output file name, use “Decoded” by default
     if (argv[3] == NULL)
     {
-        decInfo->secret_fname = "Decoded";
+        decInfo->secret_fname = decInfo->stream ? "-" : "Decoded";
     }
     else
     {
         // Remove any extension from the provided output name
-        char *str;
-        str = strtok(argv[3], ".");
-        decInfo->secret_fname = str;
+        char *save;
+        decInfo->secret_fname = strtok_r(argv[3], ".", &save);
     }
     return e_success;
 }
 
+/*
+ * Parses the --range argument "offset:len". Both are byte counts of
+ * the decoded secret; "offset:" reads from offset to the end.
+ */
+Status read_decode_range(const char *arg, DecodeInfo *decInfo)
+{
+    char *end;
+
+    if (arg[0] < '0' || arg[0] > '9')
+        return e_failure;
+    decInfo->range_offset = strtoull(arg, &end, 10);
+    if (*end != ':')
+        return e_failure;
+
+    arg = end + 1;
+    decInfo->range_len = UINT64_MAX;
+    if (*arg != '\0')
+    {
+        if (arg[0] < '0' || arg[0] > '9')
+            return e_failure;
+        decInfo->range_len = strtoull(arg, &end, 10);
+        if (*end != '\0')
+            return e_failure;
+    }
+    decInfo->has_range = 1;
+    return e_success;
+}
+
 /*
  * Opens the encoded (stego) BMP image file for reading.
+ * In --mmap mode the whole file is also mapped read-only.
  */
 Status open_decoded_files(DecodeInfo *decInfo)
 {
-    decInfo->fptr_stego_image = fopen(decInfo->stego_image_fname, "rb");
+    // An image handed over already open (--serve) is used as it is
+    if (decInfo->fptr_stego_image == NULL)
+        decInfo->fptr_stego_image = stream_open(decInfo->stego_image_fname, "rb");
     if (decInfo->fptr_stego_image == NULL)
     {
         perror("fopen");
         fprintf(stderr, "ERROR: Unable to open file %s\n", decInfo->stego_image_fname);
         return e_failure;
     }
+
+    decInfo->image_map = NULL;
+    decInfo->image_map_size = 0;
+    if (decInfo->use_mmap && decInfo->stream)
+    {
+        // A pipe cannot be mapped; read it front to back instead
+        fprintf(stderr, "WARNING: --mmap is ignored in --stream mode\n");
+        decInfo->use_mmap = 0;
+    }
+    if (decInfo->use_mmap)
+    {
+        struct stat st;
+        int fd = fileno(decInfo->fptr_stego_image);
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            fprintf(stderr, "ERROR: Unable to map file %s\n", decInfo->stego_image_fname);
+            return e_failure;
+        }
+
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            perror("mmap");
+            fprintf(stderr, "ERROR: Unable to map file %s\n", decInfo->stego_image_fname);
+            return e_failure;
+        }
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        decInfo->image_map = map;
+        decInfo->image_map_size = st.st_size;
+    }
+
+    if (decInfo->threads > 1)
+        decInfo->pool = pool_create(decInfo->threads);
     return e_success;
 }
 
 /*
- * Skips the first 54 bytes of the BMP file (header section)
- * since we only want the pixel data.
+ * Unmaps and closes the stego image (and frees an archive index).
  */
-Status skip_bmp_header(FILE *fptr_dest_image)
+void close_decoded_files(DecodeInfo *decInfo)
 {
-    fseek(fptr_dest_image, 54, SEEK_SET);
+    if (decInfo->image_map != NULL)
+        munmap((void *)decInfo->image_map, decInfo->image_map_size);
+    decInfo->image_map = NULL;
+
+    if (decInfo->fptr_stego_image != NULL)
+        fclose(decInfo->fptr_stego_image);
+    decInfo->fptr_stego_image = NULL;
+    if (decInfo->fptr_output != NULL)
+        fclose(decInfo->fptr_output);
+    decInfo->fptr_output = NULL;
+
+    pool_destroy(decInfo->pool);
+    decInfo->pool = NULL;
+    free_archive(&decInfo->archive);
+}
+
+/*
+ * Parses the BMP headers and moves to the start of the pixel array
+ * (bfOffBits), so only real pixel bytes are decoded.
+ */
+Status skip_bmp_header(DecodeInfo *decInfo)
+{
+    Status ret;
+    if (decInfo->stream)
+        ret = stream_copy_bmp_header(decInfo->fptr_stego_image, NULL, &decInfo->bmp);
+    else if (decInfo->image_map != NULL)
+        ret = bmp_parse_header((const unsigned char *)decInfo->image_map, decInfo->image_map_size,
+                               decInfo->image_map_size, &decInfo->bmp);
+    else
+        ret = bmp_read_header(decInfo->fptr_stego_image, &decInfo->bmp);
+    if (ret != e_success)
+    {
+        fprintf(stderr, "ERROR: %s is not an uncompressed 24/32-bit BMP\n", decInfo->stego_image_fname);
+        return e_failure;
+    }
+
+    decInfo->carrier_pos = 0;
+    decInfo->pixel_pos = 0;
+    if (!decInfo->stream)
+        fseeko(decInfo->fptr_stego_image, decInfo->bmp.data_offset, SEEK_SET);
     return e_success;
 }
 
+/*
+ * Returns the next size carrier bytes.
+ * With a mapping of an image without row padding this is a pointer
+ * into the mapped file (no copy); otherwise the carrier bytes are
+ * read or gathered into buffer. NULL when the image runs out.
+ */
+const char *read_image_bytes(DecodeInfo *decInfo, char *buffer, size_t size)
+{
+    const BmpInfo *bmp = &decInfo->bmp;
+    uint64_t first = decInfo->carrier_pos;
+    if (size == 0)
+        return buffer;
+    if (first + size > bmp->capacity)
+        return NULL;
+    decInfo->carrier_pos += size;
+
+    if (decInfo->image_map != NULL)
+    {
+        const char *pixels = decInfo->image_map + bmp->data_offset;
+        if (bmp_is_contiguous(bmp))
+            return pixels + first;
+        bmp_gather(bmp, pixels, 0, first, size, buffer);
+        return buffer;
+    }
+
+    // Stream: read row runs, skipping the padding between them
+    for (size_t done = 0; done < size;)
+    {
+        uint64_t offset = bmp_carrier_offset(bmp, first + done);
+        size_t run = bmp->row_bytes - (first + done) % bmp->row_bytes;
+        if (run > size - done)
+            run = size - done;
+
+        if (offset != decInfo->pixel_pos && decInfo->stream)
+        {
+            if (stream_skip(decInfo->fptr_stego_image, offset - decInfo->pixel_pos) != e_success)
+                return NULL;
+        }
+        else if (offset != decInfo->pixel_pos)
+        {
+            fseeko(decInfo->fptr_stego_image, (off_t)(offset - decInfo->pixel_pos), SEEK_CUR);
+        }
+        if (fread(buffer + done, 1, run, decInfo->fptr_stego_image) != run)
+            return NULL;
+        decInfo->pixel_pos = offset + run;
+        done += run;
+    }
+    return buffer;
+}
+
 /*
  * Checks for the special magic string to verify that
  * the image actually contains hidden data.
+ * Also tells which header layout follows: MAGIC_STRING (original)
+ * or MAGIC_STRING_V2 (versioned header).
  */
-Status decode_magic_string(const char *magic_string, DecodeInfo *decInfo)
+Status decode_magic_string(DecodeInfo *decInfo)
 {
     char string[20];
     char ch;
     char buffer[8];
+    const char *image;
     int i;
 
     // Decode the first few bytes to reconstruct the magic string
     for (i = 0; i < 2; i++)
     {
-        fread(buffer, 8, 1, decInfo->fptr_stego_image);
-        decode_byte_from_lsb(&ch, buffer);
+        if ((image = read_image_bytes(decInfo, buffer, 8)) == NULL)
+            return e_failure;
+        decode_byte_from_lsb(&ch, (char *)image);
         string[i] = ch;
     }
     string[i] = '\0';
 
-    // Compare the decoded string with our known MAGIC_STRING
+    // Compare the decoded string with our known magic strings
+    if (strcmp(MAGIC_STRING_V2, string) == 0)
+    {
+        decInfo->version = STEG_VERSION;
+        return e_success;
+    }
     if (strcmp(MAGIC_STRING, string) == 0)
+    {
+        // The original encoder wrote straight through row padding
+        decInfo->version = 1;
+        bmp_set_raw(&decInfo->bmp);
         return e_success;
+    }
 
     return e_failure;
 }
@@ -156,11 +333,16 @@ Status decode_size_from_lsb(int *size, char *imageBuffer)
 Status decode_secret_file_extn_size(DecodeInfo *decInfo)
 {
     char buffer[32];
+    const char *image;
     int size;
 
-    fread(buffer, 32, 1, decInfo->fptr_stego_image);
-    decode_size_from_lsb(&size, buffer);
+    if ((image = read_image_bytes(decInfo, buffer, 32)) == NULL)
+        return e_failure;
+    decode_size_from_lsb(&size, (char *)image);
 
+    // The extension buffer only holds 4 characters
+    if (size < 0 || size > 4)
+        return e_failure;
     decInfo->ext_size = (long)size;
     return e_success;
 }
@@ -172,6 +354,7 @@ Status decode_secret_file_extn_size(DecodeInfo *decInfo)
 Status decode_secret_file_extn(DecodeInfo *decInfo)
 {
     char buffer[8];
+    const char *image;
     char extn[5];
     char ch;
     int i;
@@ -179,16 +362,38 @@ Status decode_secret_file_extn(DecodeInfo *decInfo)
     // Decode the extension character by character
     for (i = 0; i < decInfo->ext_size; i++)
     {
-        fread(buffer, 8, 1, decInfo->fptr_stego_image);
-        decode_byte_from_lsb(&ch, buffer);
+        if ((image = read_image_bytes(decInfo, buffer, 8)) == NULL)
+            return e_failure;
+        decode_byte_from_lsb(&ch, (char *)image);
         extn[i] = ch;
     }
     extn[i] = '\0';
 
-    static char new_fname[100];
-    sprintf(new_fname, "%s%s", decInfo->secret_fname, extn);
-    decInfo->secret_fname = new_fname;   
+    return set_output_fname(decInfo, extn);
+}
+
+/*
+ * Appends the decoded extension to the output name.
+ * Extensions carrying a path separator are refused.
+ */
+Status set_output_fname(DecodeInfo *decInfo, const char *extn)
+{
+    char *new_fname = decInfo->output_fname;
+
+    if (strchr(extn, '/') != NULL)
+        return e_failure;
 
+    // "-" (stdout) takes no extension
+    if (strcmp(decInfo->secret_fname, "-") == 0)
+    {
+        strcpy(decInfo->extn_secret_file, extn);
+        return e_success;
+    }
+    if (snprintf(new_fname, sizeof(decInfo->output_fname), "%s%s", decInfo->secret_fname, extn) >=
+        (int)sizeof(decInfo->output_fname))
+        return e_failure;
+    strcpy(decInfo->extn_secret_file, extn);
+    decInfo->secret_fname = new_fname;
     return e_success;
 }
 
@@ -198,88 +403,886 @@ Status decode_secret_file_extn(DecodeInfo *decInfo)
 Status decode_secret_file_size(DecodeInfo *decInfo)
 {
     char buffer[32];
+    const char *image;
     int size;
 
-    fread(buffer, 32, 1, decInfo->fptr_stego_image);
-    decode_size_from_lsb(&size, buffer);
+    if ((image = read_image_bytes(decInfo, buffer, 32)) == NULL)
+        return e_failure;
+    decode_size_from_lsb(&size, (char *)image);
+    if (size < 0)
+        return e_failure;
     decInfo->size_secret_file = size;
 
     return e_success;
 }
 
+/*
+ * Reads the versioned stego header: extension, 64-bit size and the
+ * header checksum, which must match before any field is used.
+ */
+Status decode_stego_header(DecodeInfo *decInfo)
+{
+    char buffer[STEG_HEADER_SIZE * 8];
+    unsigned char packed[STEG_HEADER_SIZE];
+    const char *image;
+
+    if ((image = read_image_bytes(decInfo, buffer, sizeof(buffer))) == NULL)
+        return e_failure;
+    lsb_extract_bytes((char *)packed, image, STEG_HEADER_SIZE);
+
+    if (steg_header_unpack(packed, &decInfo->header) != e_success)
+    {
+        fprintf(stderr, "ERROR: Stego header is corrupted or of an unknown version\n");
+        return e_failure;
+    }
+    if (decInfo->header.flags & ~STEG_FLAGS_KNOWN)
+    {
+        fprintf(stderr, "ERROR: Unsupported stego header flags 0x%02x\n", decInfo->header.flags);
+        return e_failure;
+    }
+    if (decInfo->header.lsb_bits < 1 || decInfo->header.lsb_bits > LSB_MAX_BITS)
+    {
+        fprintf(stderr, "ERROR: Unsupported LSB depth %d\n", decInfo->header.lsb_bits);
+        return e_failure;
+    }
+
+    decInfo->ext_size = decInfo->header.extn_len;
+    decInfo->size_secret_file = decInfo->header.payload_size;
+    return set_output_fname(decInfo, decInfo->header.extn);
+}
+
+/*
+ * Reads the original header layout: 32-bit extension size,
+ * extension characters and 32-bit secret size.
+ */
+Status decode_legacy_header(DecodeInfo *decInfo)
+{
+    if (decode_secret_file_extn_size(decInfo) != e_success)
+    {
+        STEP_PRINT(decInfo, "❌ ERROR: Decoding secret file extension size failed!\n");
+        return e_failure;
+    }
+    if (decode_secret_file_extn(decInfo) != e_success)
+    {
+        STEP_PRINT(decInfo, "❌ ERROR: Decoding secret file extension failed!\n");
+        return e_failure;
+    }
+    if (decode_secret_file_size(decInfo) != e_success)
+    {
+        STEP_PRINT(decInfo, "❌ ERROR: Decoding secret file size failed!\n");
+        return e_failure;
+    }
+    return e_success;
+}
+
+/*
+ * Payload bits per carrier byte (the original layout has no header
+ * and always uses 1)
+ */
+static int decode_lsb_bits(const DecodeInfo *decInfo)
+{
+    return decInfo->header.lsb_bits ? decInfo->header.lsb_bits : 1;
+}
+
+/*
+ * Decode size payload bytes into fptr_secret, one chunk at a time
+ * (buffer holds chunk image bytes, data chunk / 8 * LSB_MAX_BITS
+ * payload bytes). Encrypted chunks are checksummed as extracted and
+ * decrypted in the same pass.
+ */
+static Status decode_payload_chunks(DecodeInfo *decInfo, uint64_t size, char *buffer, char *data, size_t chunk)
+{
+    int bits = decode_lsb_bits(decInfo);
+    while (size > 0)
+    {
+        size_t len = size < chunk / 8 * bits ? size : chunk / 8 * bits;
+        const char *image = read_image_bytes(decInfo, buffer, lsb_carriers(len, bits));
+        if (image == NULL)
+        {
+            fprintf(stderr, "ERROR: Unexpected end of stego image\n");
+            return e_failure;
+        }
+        parallel_extract_bytes(decInfo->pool, data, image, len, bits);
+        decInfo->payload_crc = crc32c(decInfo->payload_crc, data, len);
+        if (decInfo->header.flags & STEG_FLAG_CIPHER)
+            chacha20_xor(&decInfo->cipher, data, len);
+        if (fwrite(data, 1, len, decInfo->fptr_secret) != len)
+            return e_failure;
+        size -= len;
+    }
+    return e_success;
+}
+
+/*
+ * Opens the output file, or takes the one handed over already open
+ * (--serve); the caller owns the FILE from then on
+ */
+static FILE *open_secret_output(DecodeInfo *decInfo, const char *mode)
+{
+    FILE *fptr = decInfo->fptr_output;
+    decInfo->fptr_output = NULL;
+    return fptr != NULL ? fptr : stream_open(decInfo->secret_fname, mode);
+}
+
 /*
  * Decodes the actual secret data and writes it to a new file.
+ * Image bytes are read DECODE_CHUNK_SIZE (per thread) at a time and
+ * the whole chunk is gathered with the bulk LSB kernel.
  */
 Status decode_secret_file_data(DecodeInfo *decInfo)
 {
-    char buffer[8];
-    char ch;
+    // An encrypted payload starts with the cipher head
+    if ((decInfo->header.flags & STEG_FLAG_CIPHER) && decode_cipher_head(decInfo) != e_success)
+        return e_failure;
 
     // Open the output file to save the decoded content
-    decInfo->fptr_secret = fopen(decInfo->secret_fname, "w");
+    decInfo->fptr_secret = open_secret_output(decInfo, "w");
+    if (decInfo->fptr_secret == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", decInfo->secret_fname);
+        return e_failure;
+    }
+
+    size_t chunk = (size_t)DECODE_CHUNK_SIZE * pool_threads(decInfo->pool);
+    char *buffer = malloc(chunk);
+    char *data = malloc(chunk / 8 * LSB_MAX_BITS);
+    Status ret = (buffer != NULL && data != NULL) ? e_success : e_failure;
+
+    // Decode chunk by chunk and write each chunk into the output file
+    if (ret == e_success)
+        ret = decode_payload_chunks(decInfo, decInfo->size_secret_file, buffer, data, chunk);
+
+    free(buffer);
+    free(data);
+    if (fclose(decInfo->fptr_secret) != 0)
+        ret = e_failure;
+    return ret;
+}
 
-    // Decode byte by byte and write it into the output file
-    for (int i = 0; i < decInfo->size_secret_file; i++)
+/*
+ * Decodes bytes [range_offset, range_offset + range_len) of a plain
+ * payload. Every group of bits payload bytes sits in 8 carriers, so the
+ * carriers of the slice are computed directly: whole groups before it
+ * are skipped by moving carrier_pos (a seek, or a pointer into the
+ * mapping) and only the group the slice starts in is partly discarded.
+ */
+Status decode_secret_file_range(DecodeInfo *decInfo)
+{
+    int bits = decode_lsb_bits(decInfo);
+    uint64_t total = decInfo->size_secret_file;
+    uint64_t offset = decInfo->range_offset;
+
+    // Framed payloads (--stream, --compress) have no fixed byte positions,
+    // scattered ones (--key) no contiguous ones; encrypted ones (--password)
+    // are only decrypted whole
+    if (decInfo->header.flags & (STEG_FLAG_STREAM | STEG_FLAG_LZ | STEG_FLAG_SCATTER | STEG_FLAG_CIPHER))
     {
-        fread(buffer, 8, 1, decInfo->fptr_stego_image);
-        decode_byte_from_lsb(&ch, buffer);
-        fwrite(&ch, 1, 1, decInfo->fptr_secret);
+        fprintf(stderr, "ERROR: --range needs a payload written without --stream, --compress, --key or --password\n");
+        return e_failure;
     }
+    if (offset > total)
+    {
+        fprintf(stderr, "ERROR: Range offset %llu is past the end of the %llu-byte payload\n",
+                (unsigned long long)offset, (unsigned long long)total);
+        return e_failure;
+    }
+    if (decInfo->range_len > total - offset)
+        decInfo->range_len = total - offset;
+
+    decInfo->fptr_secret = open_secret_output(decInfo, "w");
+    if (decInfo->fptr_secret == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", decInfo->secret_fname);
+        return e_failure;
+    }
+
+    size_t chunk = (size_t)DECODE_CHUNK_SIZE * pool_threads(decInfo->pool);
+    char *buffer = malloc(chunk);
+    char *data = malloc(chunk / 8 * LSB_MAX_BITS);
+    Status ret = (buffer != NULL && data != NULL) ? e_success : e_failure;
+    uint64_t size = decInfo->range_len;
+
+    // Step 1: Jump over the groups that end before the slice
+    uint64_t group = offset / bits;
+    size_t skip = offset % bits;
+    decInfo->carrier_pos += group * 8;
+
+    // Step 2: The slice starts inside a group: extract it, keep its tail
+    if (ret == e_success && size > 0 && skip > 0)
+    {
+        size_t n = total - group * bits < (uint64_t)bits ? total - group * bits : (size_t)bits;
+        const char *image = read_image_bytes(decInfo, buffer, lsb_carriers(n, bits));
+        size_t part = n - skip < size ? n - skip : size;
+        if (image == NULL)
+        {
+            fprintf(stderr, "ERROR: Unexpected end of stego image\n");
+            ret = e_failure;
+        }
+        else
+        {
+            lsb_extract_bits(data, image, n, bits);
+            decInfo->payload_crc = crc32c(decInfo->payload_crc, data + skip, part);
+            if (fwrite(data + skip, 1, part, decInfo->fptr_secret) != part)
+                ret = e_failure;
+            size -= part;
+        }
+    }
+
+    // Step 3: The rest of the slice is group aligned
+    if (ret == e_success)
+        ret = decode_payload_chunks(decInfo, size, buffer, data, chunk);
+
+    free(buffer);
+    free(data);
+    if (fclose(decInfo->fptr_secret) != 0)
+        ret = e_failure;
+    return ret;
+}
+
+/*
+ * Decodes a payload written in the keyed order of scatter.h: each
+ * logical block is read in one go (read_image_bytes seeks to it, or
+ * points into the mapping), its groups are put back in payload order
+ * and extracted with the bulk kernel.
+ */
+Status decode_secret_file_scatter(DecodeInfo *decInfo)
+{
+    int bits = decode_lsb_bits(decInfo);
+    ScatterMap map = {0};
+
+    // Step 1: Only the key the image was written with finds the payload
+    if (decInfo->key == NULL)
+    {
+        fprintf(stderr, "ERROR: %s was written with --key, pass the same --key to decode it\n",
+                decInfo->stego_image_fname);
+        return e_failure;
+    }
+    uint64_t seed = scatter_key_seed(decInfo->key);
+    if (scatter_key_check(seed) != decInfo->header.key_check)
+    {
+        fprintf(stderr, "ERROR: Wrong --key for %s\n", decInfo->stego_image_fname);
+        return e_failure;
+    }
+    if (decInfo->stream)
+    {
+        fprintf(stderr, "ERROR: Scattered payloads cannot be decoded in --stream mode\n");
+        return e_failure;
+    }
+    if (scatter_map_init(&map, seed, decInfo->carrier_pos, decInfo->bmp.capacity) != e_success)
+        return e_failure;
+    if ((decInfo->size_secret_file + bits - 1) / bits > map.group_count)
+    {
+        fprintf(stderr, "ERROR: Unexpected end of stego image\n");
+        free_scatter_map(&map);
+        return e_failure;
+    }
+
+    decInfo->fptr_secret = open_secret_output(decInfo, "w");
+    if (decInfo->fptr_secret == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", decInfo->secret_fname);
+        free_scatter_map(&map);
+        return e_failure;
+    }
+
+    size_t carriers_len = (size_t)SCATTER_BLOCK_GROUPS * 8;
+    char *buffer = malloc(carriers_len);
+    char *groups = malloc(carriers_len);
+    char *data = malloc((size_t)SCATTER_BLOCK_GROUPS * bits);
+    uint32_t *perm = malloc(SCATTER_BLOCK_GROUPS * sizeof(uint32_t));
+    Status ret = (buffer != NULL && groups != NULL && data != NULL && perm != NULL) ? e_success : e_failure;
+
+    // Step 2: One logical block at a time, in payload order
+    uint64_t remaining = decInfo->size_secret_file;
+    for (uint64_t block = 0; ret == e_success && remaining > 0; block++)
+    {
+        uint32_t n = scatter_block_groups(&map, block);
+        size_t bytes = remaining < (uint64_t)n * bits ? (size_t)remaining : (size_t)n * bits;
+        uint32_t used = (bytes + bits - 1) / bits;
+
+        decInfo->carrier_pos = scatter_block_carrier(&map, block);
+        const char *image = read_image_bytes(decInfo, buffer, (size_t)n * 8);
+        if (image == NULL)
+        {
+            fprintf(stderr, "ERROR: Unexpected end of stego image\n");
+            ret = e_failure;
+            break;
+        }
+        scatter_block_perm(&map, block, perm, n);
+        scatter_gather_groups(groups, image, perm, used);
+        parallel_extract_bytes(decInfo->pool, data, groups, bytes, bits);
+        decInfo->payload_crc = crc32c(decInfo->payload_crc, data, bytes);
+        if (fwrite(data, 1, bytes, decInfo->fptr_secret) != bytes)
+            ret = e_failure;
+        remaining -= bytes;
+    }
+
+    free(buffer);
+    free(groups);
+    free(data);
+    free(perm);
+    free_scatter_map(&map);
+    if (fclose(decInfo->fptr_secret) != 0)
+        ret = e_failure;
+    return ret;
+}
+
+/*
+ * Reads the archive index from the start of the payload: its fixed
+ * head first for the size, then the whole index, which must check out
+ * before any entry is used
+ */
+static Status decode_archive_index(DecodeInfo *decInfo)
+{
+    int bits = decode_lsb_bits(decInfo);
+    uint64_t payload = decInfo->carrier_pos;
+    unsigned char head[ARCHIVE_INDEX_HEAD];
+    char field[ARCHIVE_INDEX_HEAD * 8];
+    const char *image;
+
+    if (decInfo->size_secret_file < ARCHIVE_INDEX_HEAD ||
+        (image = read_image_bytes(decInfo, field, lsb_carriers(ARCHIVE_INDEX_HEAD, bits))) == NULL)
+        return e_failure;
+    lsb_extract_bits((char *)head, image, ARCHIVE_INDEX_HEAD, bits);
+    uint32_t index_size = head[4] | head[5] << 8 | head[6] << 16 | (uint32_t)head[7] << 24;
+    if (index_size < ARCHIVE_INDEX_HEAD + 4 || index_size > decInfo->size_secret_file)
+        return e_failure;
+
+    char *buffer = malloc(lsb_carriers(index_size, bits));
+    unsigned char *index = malloc(index_size);
+    Status ret = e_failure;
+    decInfo->carrier_pos = payload;
+    if (buffer != NULL && index != NULL &&
+        (image = read_image_bytes(decInfo, buffer, lsb_carriers(index_size, bits))) != NULL)
+    {
+        lsb_extract_bits((char *)index, image, index_size, bits);
+        ret = archive_index_unpack(index, index_size, decInfo->size_secret_file, &decInfo->archive);
+    }
+    free(buffer);
+    free(index);
+    return ret;
+}
+
+/*
+ * Decodes an archive (STEG_FLAG_ARCHIVE). With --list the index is
+ * printed; otherwise every entry (or only the --extract one) is written
+ * into a directory named after the output name. Each entry is a slice
+ * of the plain payload, so it is extracted by seeking straight to it
+ * (decode_secret_file_range) and checked against its CRC-32C.
+ */
+Status decode_secret_file_archive(DecodeInfo *decInfo)
+{
+    ArchiveInfo *archive = &decInfo->archive;
+    uint64_t payload = decInfo->carrier_pos;
+    char *dir = decInfo->secret_fname;
+    char path[4096];
+
+    // Going back to the index and between entries needs seeks
+    if (decInfo->stream)
+    {
+        fprintf(stderr, "ERROR: Archives cannot be decoded in --stream mode\n");
+        return e_failure;
+    }
+
+    // Entries become files in a directory, not the one output handed over
+    if (decInfo->fptr_output != NULL)
+    {
+        fprintf(stderr, "ERROR: Archives are extracted into a directory, decode %s without --connect\n",
+                decInfo->stego_image_fname);
+        return e_failure;
+    }
+
+    // Step 1: Read and check the index
+    if (decode_archive_index(decInfo) != e_success)
+    {
+        fprintf(stderr, "ERROR: Archive index is corrupted\n");
+        return e_failure;
+    }
+
+    // Step 2: --list only prints it
+    if (decInfo->archive_list)
+    {
+        printf("\n   %-40s %14s  %s\n", "Name", "Size", "CRC-32C");
+        for (uint32_t i = 0; i < archive->entry_count; i++)
+            printf("   %-40s %14llu  0x%08x\n", archive->entries[i].name,
+                   (unsigned long long)archive->entries[i].size, archive->entries[i].crc);
+        printf("   %u entries, %llu bytes\n\n", archive->entry_count, (unsigned long long)archive->data_size);
+        return e_success;
+    }
+    if (decInfo->archive_extract != NULL && archive_find(archive, decInfo->archive_extract) == NULL)
+    {
+        fprintf(stderr, "ERROR: No entry named %s in the archive\n", decInfo->archive_extract);
+        return e_failure;
+    }
+
+    // Step 3: Entries go into the output directory
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+    {
+        perror("mkdir");
+        fprintf(stderr, "ERROR: Unable to create directory %s\n", dir);
+        return e_failure;
+    }
+
+    // Step 4: Extract each entry as a slice of the payload
+    Status ret = e_success;
+    for (uint32_t i = 0; ret == e_success && i < archive->entry_count; i++)
+    {
+        ArchiveEntry *entry = &archive->entries[i];
+        if (decInfo->archive_extract != NULL && strcmp(entry->name, decInfo->archive_extract) != 0)
+            continue;
+        if (snprintf(path, sizeof(path), "%s/%s", dir, entry->name) >= (int)sizeof(path))
+        {
+            ret = e_failure;
+            break;
+        }
+
+        decInfo->secret_fname = path;
+        decInfo->carrier_pos = payload;
+        decInfo->range_offset = archive->index_size + entry->offset;
+        decInfo->range_len = entry->size;
+        decInfo->payload_crc = 0;
+        ret = decode_secret_file_range(decInfo);
+        if (ret == e_success && decInfo->payload_crc != entry->crc)
+        {
+            fprintf(stderr, "ERROR: Archive entry %s: CRC-32C is 0x%08x, index records 0x%08x\n",
+                    entry->name, decInfo->payload_crc, entry->crc);
+            ret = e_failure;
+        }
+    }
+    decInfo->secret_fname = dir;
+    return ret;
+}
+
+/*
+ * Reads the shard record from the start of the payload. The payload
+ * CRC covers the record too, so it is the first input of payload_crc.
+ */
+Status decode_shard_record(DecodeInfo *decInfo)
+{
+    int bits = decode_lsb_bits(decInfo);
+    unsigned char record[SHARD_RECORD_SIZE];
+    char buffer[SHARD_RECORD_SIZE * 8];
+    const char *image;
+
+    if (!(decInfo->header.flags & STEG_FLAG_SHARD) || decInfo->size_secret_file < SHARD_RECORD_SIZE ||
+        (image = read_image_bytes(decInfo, buffer, lsb_carriers(SHARD_RECORD_SIZE, bits))) == NULL)
+        return e_failure;
+    lsb_extract_bits((char *)record, image, SHARD_RECORD_SIZE, bits);
+    decInfo->payload_crc = crc32c(0, record, SHARD_RECORD_SIZE);
+    return shard_record_unpack(record, decInfo->size_secret_file, &decInfo->shard);
+}
+
+/*
+ * Reads the cipher head from the start of the payload and derives the
+ * key from --password. The payload CRC covers the head, and what is
+ * left of the payload is the ciphertext.
+ */
+Status decode_cipher_head(DecodeInfo *decInfo)
+{
+    int bits = decode_lsb_bits(decInfo);
+    unsigned char head[CIPHER_HEAD_SIZE];
+    char buffer[CIPHER_HEAD_SIZE * 8];
+    const char *image;
+
+    if (decInfo->password == NULL)
+    {
+        fprintf(stderr, "ERROR: %s is encrypted, give its --password\n", decInfo->stego_image_fname);
+        return e_failure;
+    }
+    if (decInfo->size_secret_file > CIPHER_HEAD_SIZE + CIPHER_MAX_PAYLOAD)
+    {
+        fprintf(stderr, "ERROR: Encrypted payload of %s is larger than one key may cover\n",
+                decInfo->stego_image_fname);
+        return e_failure;
+    }
+    if (decInfo->size_secret_file < CIPHER_HEAD_SIZE ||
+        (image = read_image_bytes(decInfo, buffer, lsb_carriers(CIPHER_HEAD_SIZE, bits))) == NULL)
+    {
+        fprintf(stderr, "ERROR: Unexpected end of stego image\n");
+        return e_failure;
+    }
+    lsb_extract_bits((char *)head, image, CIPHER_HEAD_SIZE, bits);
+    decInfo->payload_crc = crc32c(0, head, CIPHER_HEAD_SIZE);
+    if (cipher_init_decrypt(&decInfo->cipher, decInfo->password, head) != e_success)
+    {
+        fprintf(stderr, "ERROR: Wrong --password for %s\n", decInfo->stego_image_fname);
+        return e_failure;
+    }
+    decInfo->size_secret_file -= CIPHER_HEAD_SIZE;
     return e_success;
 }
 
+/*
+ * Decodes the slice that follows the shard record into fptr_secret.
+ * The caller opens the output and seeks to the slice offset, so every
+ * shard can be written by its own thread.
+ */
+Status decode_secret_file_shard(DecodeInfo *decInfo)
+{
+    size_t chunk = (size_t)DECODE_CHUNK_SIZE * pool_threads(decInfo->pool);
+    char *buffer = malloc(chunk);
+    char *data = malloc(chunk / 8 * LSB_MAX_BITS);
+    Status ret = (buffer != NULL && data != NULL) ? e_success : e_failure;
+
+    if (ret == e_success)
+        ret = decode_payload_chunks(decInfo, decInfo->shard.size, buffer, data, chunk);
+    free(buffer);
+    free(data);
+    return ret;
+}
+
+/*
+ * Decodes a framed payload: 32-bit length, that many bytes, repeated
+ * until a zero length. Frames are written by --stream and --compress;
+ * with STEG_FLAG_LZ each one holds an LZ block that is decompressed
+ * before being written out.
+ */
+Status decode_secret_file_stream(DecodeInfo *decInfo)
+{
+    decInfo->fptr_secret = open_secret_output(decInfo, "w");
+    if (decInfo->fptr_secret == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", decInfo->secret_fname);
+        return e_failure;
+    }
+
+    size_t chunk = (size_t)DECODE_CHUNK_SIZE * pool_threads(decInfo->pool);
+    char *buffer = malloc(chunk);
+    char *data = malloc(chunk / 8 * LSB_MAX_BITS);
+    int compressed = (decInfo->header.flags & STEG_FLAG_LZ) != 0;
+    unsigned char *block = compressed ? malloc(LZ_BLOCK_SIZE) : NULL;
+    Status ret = (buffer != NULL && data != NULL && (!compressed || block != NULL)) ? e_success : e_failure;
+    int bits = decode_lsb_bits(decInfo);
+
+    decInfo->size_secret_file = 0;
+    while (ret == e_success)
+    {
+        char field[STREAM_FRAME_LEN_SIZE * 8];
+        unsigned char len_bytes[STREAM_FRAME_LEN_SIZE];
+        const char *image = read_image_bytes(decInfo, field, lsb_carriers(STREAM_FRAME_LEN_SIZE, bits));
+        if (image == NULL)
+        {
+            fprintf(stderr, "ERROR: Stream payload has no end marker\n");
+            ret = e_failure;
+            break;
+        }
+        lsb_extract_bits((char *)len_bytes, image, STREAM_FRAME_LEN_SIZE, bits);
+        uint32_t len = len_bytes[0] | len_bytes[1] << 8 | len_bytes[2] << 16 | (uint32_t)len_bytes[3] << 24;
+        if (len == 0)
+            break;
+        if (!compressed)
+        {
+            ret = decode_payload_chunks(decInfo, len, buffer, data, chunk);
+            decInfo->size_secret_file += len;
+            continue;
+        }
+
+        // LZ frame: extract the block, then decompress it unless stored raw
+        size_t size = len & ~LZ_FRAME_STORED, out_len = size;
+        if (size > LZ_BLOCK_SIZE || (image = read_image_bytes(decInfo, buffer, lsb_carriers(size, bits))) == NULL)
+        {
+            fprintf(stderr, "ERROR: Compressed frame is corrupted\n");
+            ret = e_failure;
+            break;
+        }
+        parallel_extract_bytes(decInfo->pool, data, image, size, bits);
+        const char *out = data;
+        if (!(len & LZ_FRAME_STORED))
+        {
+            if (lz_decompress((const unsigned char *)data, size, block, LZ_BLOCK_SIZE, &out_len) != e_success)
+            {
+                fprintf(stderr, "ERROR: Compressed frame is corrupted\n");
+                ret = e_failure;
+                break;
+            }
+            out = (const char *)block;
+        }
+        decInfo->payload_crc = crc32c(decInfo->payload_crc, out, out_len);
+        if (fwrite(out, 1, out_len, decInfo->fptr_secret) != out_len)
+            ret = e_failure;
+        decInfo->size_secret_file += out_len;
+    }
+
+    // --stream images carry the payload CRC after the end marker
+    if (ret == e_success && (decInfo->header.flags & STEG_FLAG_STREAM) && (decInfo->header.flags & STEG_FLAG_CRC))
+    {
+        char field[STREAM_FRAME_LEN_SIZE * 8];
+        unsigned char value[STREAM_FRAME_LEN_SIZE];
+        const char *image = read_image_bytes(decInfo, field, lsb_carriers(STREAM_FRAME_LEN_SIZE, bits));
+        if (image == NULL)
+        {
+            fprintf(stderr, "ERROR: Stream payload has no checksum field\n");
+            ret = e_failure;
+        }
+        else
+        {
+            lsb_extract_bits((char *)value, image, STREAM_FRAME_LEN_SIZE, bits);
+            decInfo->header.payload_crc = value[0] | value[1] << 8 | value[2] << 16 | (uint32_t)value[3] << 24;
+        }
+    }
+
+    // A compressed file must expand back to the size in the header
+    if (ret == e_success && compressed && !(decInfo->header.flags & STEG_FLAG_STREAM) &&
+        decInfo->size_secret_file != decInfo->header.payload_size)
+    {
+        fprintf(stderr, "ERROR: Decompressed %llu bytes, header records %llu\n",
+                (unsigned long long)decInfo->size_secret_file, (unsigned long long)decInfo->header.payload_size);
+        ret = e_failure;
+    }
+
+    free(buffer);
+    free(data);
+    free(block);
+    if (fclose(decInfo->fptr_secret) != 0)
+        ret = e_failure;
+    return ret;
+}
+
+/*
+ * Decodes the secret in --mmap mode.
+ * The output file is preallocated to its final size and mapped, and the
+ * LSBs are gathered straight from the image mapping into it in one pass.
+ */
+Status decode_secret_file_data_mmap(DecodeInfo *decInfo)
+{
+    if ((decInfo->header.flags & STEG_FLAG_CIPHER) && decode_cipher_head(decInfo) != e_success)
+        return e_failure;
+
+    const BmpInfo *bmp = &decInfo->bmp;
+    size_t size = decInfo->size_secret_file;
+    int bits = decode_lsb_bits(decInfo);
+    if (decInfo->image_map == NULL || size > bmp->capacity / 8 * bits ||
+        decInfo->carrier_pos + lsb_carriers(size, bits) > bmp->capacity)
+    {
+        fprintf(stderr, "ERROR: Unexpected end of stego image\n");
+        return e_failure;
+    }
+
+    // Create the output file (mapped, so read-write) and preallocate it
+    FILE *output = open_secret_output(decInfo, "w+");
+    int fd = output != NULL ? dup(fileno(output)) : -1;
+    if (output != NULL)
+        fclose(output);
+    if (fd < 0)
+    {
+        perror("open");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", decInfo->secret_fname);
+        return e_failure;
+    }
+    if (size == 0)
+    {
+        close(fd);
+        return e_success;
+    }
+    if (ftruncate(fd, size) != 0)
+    {
+        perror("ftruncate");
+        close(fd);
+        return e_failure;
+    }
+
+    char *out = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (out == MAP_FAILED)
+    {
+        perror("mmap");
+        close(fd);
+        return e_failure;
+    }
+
+    Status ret = e_success;
+    if (bmp_is_contiguous(bmp))
+    {
+        // One pass: mapped image -> mapped output, split across the pool;
+        // each slice is checksummed while it is still in cache
+        size_t slice = (size_t)DECODE_CHUNK_SIZE / 8 * bits * pool_threads(decInfo->pool);
+        for (size_t done = 0; done < size; done += slice)
+        {
+            size_t len = size - done < slice ? size - done : slice;
+            parallel_extract_bytes(decInfo->pool, out + done,
+                                   decInfo->image_map + bmp->data_offset + decInfo->carrier_pos, len, bits);
+            decInfo->payload_crc = crc32c(decInfo->payload_crc, out + done, len);
+            if (decInfo->header.flags & STEG_FLAG_CIPHER)
+                chacha20_xor(&decInfo->cipher, out + done, len);
+            decInfo->carrier_pos += lsb_carriers(len, bits);
+        }
+    }
+    else
+    {
+        // Padded rows: gather carriers a block at a time
+        size_t chunk = (size_t)DECODE_CHUNK_SIZE * pool_threads(decInfo->pool);
+        char *buffer = malloc(chunk);
+        if (buffer == NULL)
+            ret = e_failure;
+        for (size_t done = 0; ret == e_success && done < size;)
+        {
+            size_t len = size - done < chunk / 8 * bits ? size - done : chunk / 8 * bits;
+            const char *image = read_image_bytes(decInfo, buffer, lsb_carriers(len, bits));
+            if (image == NULL)
+            {
+                fprintf(stderr, "ERROR: Unexpected end of stego image\n");
+                ret = e_failure;
+                break;
+            }
+            parallel_extract_bytes(decInfo->pool, out + done, image, len, bits);
+            decInfo->payload_crc = crc32c(decInfo->payload_crc, out + done, len);
+            if (decInfo->header.flags & STEG_FLAG_CIPHER)
+                chacha20_xor(&decInfo->cipher, out + done, len);
+            done += len;
+        }
+        free(buffer);
+    }
+
+    munmap(out, size);
+    close(fd);
+    return ret;
+}
+
+/*
+ * Compares the CRC-32C computed while the secret was written with the
+ * one recorded by the encoder. Images without STEG_FLAG_CRC (original
+ * layout, or written before checksums) have nothing to compare.
+ */
+Status verify_payload_crc(DecodeInfo *decInfo)
+{
+    if (!(decInfo->header.flags & STEG_FLAG_CRC))
+        return e_success;
+    if (decInfo->payload_crc == decInfo->header.payload_crc)
+        return e_success;
+
+    fprintf(stderr, "ERROR: Payload CRC-32C is 0x%08x, header records 0x%08x\n",
+            decInfo->payload_crc, decInfo->header.payload_crc);
+    return e_failure;
+}
+
 /*
  * The main decoding process that performs all steps one by one.
  */
 Status do_decoding(DecodeInfo *decInfo)
 {
-    printf("\n========================================\n");
-    printf(" 🔓 Starting Decoding Process\n");
-    printf("========================================\n\n");
+    STEP_PRINT(decInfo, "\n========================================\n");
+    STEP_PRINT(decInfo, " 🔓 Starting Decoding Process\n");
+    STEP_PRINT(decInfo, "========================================\n\n");
 
-    // Step 1: Decode the size of the file extension
-    if (decode_secret_file_extn_size(decInfo) == e_success)
+    // Step 1: Decode the header fields (layout depends on the magic string)
+    Status header_status = STATS_STAGE(decInfo->stats, "stego_header",
+                                       decInfo->version == STEG_VERSION ? decode_stego_header(decInfo)
+                                                                        : decode_legacy_header(decInfo));
+    if (header_status == e_success)
     {
-        printf("-> Step 1: Secret file extension size decoded successfully.\n");
+        if (decInfo->header.flags & STEG_FLAG_STREAM)
+            STEP_PRINT(decInfo, "-> Step 1: Stego header (v%d, extension %s, streamed payload) decoded successfully.\n",
+                   decInfo->version, decInfo->extn_secret_file);
+        else if (decInfo->header.flags & STEG_FLAG_ARCHIVE)
+            STEP_PRINT(decInfo, "-> Step 1: Stego header (v%d, archive, %llu bytes) decoded successfully.\n",
+                   decInfo->version, (unsigned long long)decInfo->size_secret_file);
+        else
+            STEP_PRINT(decInfo, "-> Step 1: Stego header (v%d, extension %s, %llu bytes%s) decoded successfully.\n",
+                   decInfo->version, decInfo->extn_secret_file,
+                   (unsigned long long)decInfo->size_secret_file,
+                   (decInfo->header.flags & STEG_FLAG_LZ)        ? ", compressed"
+                   : (decInfo->header.flags & STEG_FLAG_SCATTER) ? ", scattered"
+                   : (decInfo->header.flags & STEG_FLAG_CIPHER)  ? ", encrypted"
+                                                                 : "");
+
+        // --list and --extract only make sense for archives
+        int archive = (decInfo->header.flags & STEG_FLAG_ARCHIVE) != 0;
+        if (!archive && (decInfo->archive_list || decInfo->archive_extract != NULL))
+        {
+            fprintf(stderr, "ERROR: --list and --extract need an image written with --archive\n");
+            STEP_PRINT(decInfo, "❌ ERROR: Decoding secret file data failed!\n");
+            return e_failure;
+        }
+
+        // A key or password only matters to images written with one
+        if (decInfo->key != NULL && !(decInfo->header.flags & STEG_FLAG_SCATTER))
+            fprintf(stderr, "WARNING: --key is ignored, %s was written without it\n", decInfo->stego_image_fname);
+        if (decInfo->password != NULL && !(decInfo->header.flags & STEG_FLAG_CIPHER))
+            fprintf(stderr, "WARNING: --password is ignored, %s is not encrypted\n", decInfo->stego_image_fname);
+
+        // A shard holds only part of the secret: it is decoded with the others
+        if (decInfo->header.flags & STEG_FLAG_SHARD)
+        {
+            fprintf(stderr, "ERROR: %s is one shard of a larger secret, decode every shard with --shard\n",
+                    decInfo->stego_image_fname);
+            STEP_PRINT(decInfo, "❌ ERROR: Decoding secret file data failed!\n");
+            return e_failure;
+        }
 
-        // Step 2: Decode the actual file extension
-        if (decode_secret_file_extn(decInfo) == e_success)
+        // Step 2: Decode the secret file content (framed payloads: --stream, --compress)
+        Status data_status = STATS_STAGE(decInfo->stats, "data",
+                                         decInfo->has_range ? decode_secret_file_range(decInfo)
+                                         : archive          ? decode_secret_file_archive(decInfo)
+                                         : (decInfo->header.flags & STEG_FLAG_SCATTER)
+                                             ? decode_secret_file_scatter(decInfo)
+                                         : (decInfo->header.flags & (STEG_FLAG_STREAM | STEG_FLAG_LZ))
+                                             ? decode_secret_file_stream(decInfo)
+                                         : decInfo->use_mmap ? decode_secret_file_data_mmap(decInfo)
+                                                             : decode_secret_file_data(decInfo));
+        if (data_status == e_success && decInfo->has_range)
         {
-            printf("-> Step 2: Secret file extension decoded successfully.\n");
+            // The recorded checksum covers the whole payload, not a slice
+            STEP_PRINT(decInfo, "-> Step 2: Secret file bytes %llu..%llu (%llu of %llu) decoded successfully.\n",
+                   (unsigned long long)decInfo->range_offset,
+                   (unsigned long long)(decInfo->range_offset + decInfo->range_len),
+                   (unsigned long long)decInfo->range_len, (unsigned long long)decInfo->size_secret_file);
+            STEP_PRINT(decInfo, "-> Step 3: Partial extraction, payload checksum not verified.\n");
+            return e_success;
+        }
+        else if (data_status == e_success && archive)
+        {
+            // The index and every extracted entry carry their own CRC-32C
+            if (decInfo->archive_list)
+            {
+                STEP_PRINT(decInfo, "-> Step 2: Archive index (%u entries) listed successfully.\n",
+                       decInfo->archive.entry_count);
+                STEP_PRINT(decInfo, "-> Step 3: Archive index checksum (CRC-32C) verified successfully.\n");
+            }
+            else
+            {
+                STEP_PRINT(decInfo, "-> Step 2: %u archive entries extracted to %s/ successfully.\n",
+                       decInfo->archive_extract != NULL ? 1 : decInfo->archive.entry_count, decInfo->secret_fname);
+                STEP_PRINT(decInfo, "-> Step 3: Archive index and entry checksums (CRC-32C) verified successfully.\n");
+            }
+            return e_success;
+        }
+        else if (data_status == e_success)
+        {
+            if (decInfo->header.flags & STEG_FLAG_CIPHER)
+                STEP_PRINT(decInfo, "-> Step 2: Secret file data decoded and decrypted (ChaCha20) successfully.\n");
+            else
+                STEP_PRINT(decInfo, "-> Step 2: Secret file data decoded successfully.\n");
 
-            // Step 3: Decode the secret file’s total size
-            if (decode_secret_file_size(decInfo) == e_success)
+            // Step 3: Check the payload against the recorded checksum
+            if (verify_payload_crc(decInfo) == e_success)
             {
-                printf("-> Step 3: Secret file size decoded successfully.\n");
-
-                // Step 4: Decode the secret file content
-                if (decode_secret_file_data(decInfo) == e_success)
-                {
-                    printf("-> Step 4: Secret file data decoded successfully.\n");
-                    return e_success;
-                }
+                if (decInfo->header.flags & STEG_FLAG_CRC)
+                    STEP_PRINT(decInfo, "-> Step 3: Payload checksum (CRC-32C 0x%08x) verified successfully.\n",
+                           decInfo->payload_crc);
                 else
-                {
-                    printf("❌ ERROR: Decoding secret file data failed!\n");
-                }
+                    STEP_PRINT(decInfo, "-> Step 3: No payload checksum recorded in this image, not verified.\n");
+                return e_success;
             }
             else
             {
-                printf("❌ ERROR: Decoding secret file size failed!\n");
+                STEP_PRINT(decInfo, "❌ ERROR: Payload checksum mismatch: the stego image is corrupted or truncated!\n");
             }
         }
         else
         {
-            printf("❌ ERROR: Decoding secret file extension failed!\n");
+            STEP_PRINT(decInfo, "❌ ERROR: Decoding secret file data failed!\n");
         }
     }
     else
     {
-        printf("❌ ERROR: Decoding secret file extension size failed!\n");
+        STEP_PRINT(decInfo, "❌ ERROR: Decoding stego header failed!\n");
     }
 
-    printf("========================================\n");
-    printf(" ❌ Decoding process terminated with errors.\n");
-    printf("========================================\n\n");
+    STEP_PRINT(decInfo, "========================================\n");
+    STEP_PRINT(decInfo, " ❌ Decoding process terminated with errors.\n");
+    STEP_PRINT(decInfo, "========================================\n\n");
     return e_failure;
 }
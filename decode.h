@@ -2,7 +2,21 @@
 #define DECODE_H
 
 #include <stdio.h>
-#include "types.h" // Contains custom user-defined types like Status, etc.
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"  // Contains custom user-defined types like Status, etc.
+#include "header.h" // Versioned stego header
+#include "parallel.h" // Thread pool for -j
+#include "bmp.h"    // BMP header parser
+#include "stats.h"  // Per-stage timings
+#include "stream.h" // stdin/stdout streaming
+#include "archive.h" // Multi-file archives
+#include "shard.h"   // Secrets split over several covers
+#include "scatter.h" // Keyed payload order
+#include "cipher.h"  // ChaCha20 payload encryption
+
+/* Number of image bytes read and decoded per block */
+#define DECODE_CHUNK_SIZE (1024 * 1024)
 
 /*
  * Structure: DecodeInfo
@@ -17,14 +31,55 @@ typedef struct _DecodeInfo
     /* Stego Image Info */
     char *stego_image_fname;  // Name of the encoded BMP file (input)
     FILE *fptr_stego_image;   // File pointer to the stego image
+    BmpInfo bmp;              // Parsed BMP headers of the stego image
+    uint64_t carrier_pos;     // Next carrier (pixel) byte to decode
+    uint64_t pixel_pos;       // Next unread byte of the pixel array (stream mode)
 
     /* Secret File Info */
     char *secret_fname;        // Name of the decoded output file
+    char output_fname[256];    // Storage for the name with the decoded extension
     FILE *fptr_secret;         // File pointer to the output secret file
+    FILE *fptr_output;         // Output handed over already open (--serve), NULL to create secret_fname
     long ext_size;             // Size of the secret file extension
-    char extn_secret_file[5];  // Stores decoded extension (like .txt)
+    char extn_secret_file[STEG_MAX_EXTN + 1]; // Stores decoded extension (like .txt)
     char secret_data[100];     // Temporary buffer to store decoded data
-    long size_secret_file;     // Total size of the secret file
+    uint64_t size_secret_file; // Total size of the secret file
+    uint32_t payload_crc;      // CRC-32C of the decoded secret, updated as it is written
+
+    /* Header */
+    int version;               // 1 = original layout, STEG_VERSION = versioned header
+    StegHeader header;         // Parsed versioned header
+
+    /* Memory-mapped mode (--mmap) */
+    int use_mmap;              // Non-zero to decode straight from a read-only mapping
+    const char *image_map;     // Mapping of the whole stego image
+    size_t image_map_size;     // Size of the mapping in bytes
+
+    /* Parallel extraction (-j) */
+    int threads;               // Threads requested (0 or 1 = single-threaded)
+    ThreadPool *pool;          // Worker pool, NULL when single-threaded
+
+    /* Ranged extraction (--range offset:len) */
+    int has_range;             // Non-zero to extract only a slice of the payload
+    uint64_t range_offset;     // First payload byte of the slice
+    uint64_t range_len;        // Slice length in bytes (UINT64_MAX = up to the end)
+
+    /* Archives (STEG_FLAG_ARCHIVE) */
+    ArchiveInfo archive;       // Index read from the payload
+    int archive_list;          // --list: print the index, extract nothing
+    const char *archive_extract; // --extract name: only this entry (NULL = all)
+
+    /* Shards (STEG_FLAG_SHARD) */
+    ShardRecord shard;         // Record read from the start of the payload
+
+    /* Encrypted payloads (STEG_FLAG_CIPHER) */
+    const char *password;      // --password: password of an encrypted payload
+    CipherCtx cipher;          // Keystream state, set up from the cipher head
+
+    const char *key;           // --key: key of a scattered payload (STEG_FLAG_SCATTER)
+    int quiet;                 // Suppress step messages (batch jobs)
+    int stream;                // --stream: read the image without seeking
+    StegStats *stats;          // Per-stage timings (--stats), NULL when off
 } DecodeInfo;
 
 /* Decoding function prototype */
@@ -35,14 +90,32 @@ Status read_and_validate_decode_args(char *argv[], DecodeInfo *decInfo);
 /* Controls the full decoding process step by step */
 Status do_decoding(DecodeInfo *decInfo);
 
+/* Parses --range offset:len (len may be left out to read up to the end) */
+Status read_decode_range(const char *arg, DecodeInfo *decInfo);
+
 /* Opens the encoded BMP file for reading */
 Status open_decoded_files(DecodeInfo *decInfo);
 
-/* Skips the first 54 bytes (BMP header) to reach pixel data */
-Status skip_bmp_header(FILE *fptr_dest_image);
+/* Unmaps and closes the stego image */
+void close_decoded_files(DecodeInfo *decInfo);
+
+/* Parses the BMP headers and skips to the pixel data (bfOffBits) */
+Status skip_bmp_header(DecodeInfo *decInfo);
+
+/* Reads size carrier bytes from the stream or the mapping */
+const char *read_image_bytes(DecodeInfo *decInfo, char *buffer, size_t size);
+
+/* Decodes and verifies the magic string, detecting the header version */
+Status decode_magic_string(DecodeInfo *decInfo);
 
-/* Decodes and verifies the magic string to confirm valid encoding */
-Status decode_magic_string(const char *magic_string, DecodeInfo *decInfo);
+/* Decodes the versioned stego header (extension, 64-bit size, checksum) */
+Status decode_stego_header(DecodeInfo *decInfo);
+
+/* Decodes the original extension size / extension / size fields */
+Status decode_legacy_header(DecodeInfo *decInfo);
+
+/* Builds the output file name from the decoded extension */
+Status set_output_fname(DecodeInfo *decInfo, const char *extn);
 
 /* Reads and decodes the size of the secret file extension */
 Status decode_secret_file_extn_size(DecodeInfo *decInfo);
@@ -56,10 +129,37 @@ Status decode_secret_file_size(DecodeInfo *decInfo);
 /* Decodes the hidden secret file content and writes it to a file */
 Status decode_secret_file_data(DecodeInfo *decInfo);
 
+/* Decodes only the --range slice of a plain payload, seeking straight to it */
+Status decode_secret_file_range(DecodeInfo *decInfo);
+
+/* Decodes a payload written in the keyed, block-shuffled order (STEG_FLAG_SCATTER) */
+Status decode_secret_file_scatter(DecodeInfo *decInfo);
+
+/* Decodes the secret from the mapping into a memory-mapped output file */
+Status decode_secret_file_data_mmap(DecodeInfo *decInfo);
+
+/* Decode a payload made of length-prefixed frames (STEG_FLAG_STREAM, STEG_FLAG_LZ) */
+Status decode_secret_file_stream(DecodeInfo *decInfo);
+
+/* Reads the archive index, then lists it or extracts entries into a directory */
+Status decode_secret_file_archive(DecodeInfo *decInfo);
+
+/* Reads and checks the shard record at the start of the payload (STEG_FLAG_SHARD) */
+Status decode_shard_record(DecodeInfo *decInfo);
+
+/* Reads the cipher head and derives the key from --password (STEG_FLAG_CIPHER) */
+Status decode_cipher_head(DecodeInfo *decInfo);
+
+/* Decodes the slice of a shard into fptr_secret, already at the slice offset */
+Status decode_secret_file_shard(DecodeInfo *decInfo);
+
+/* Compares the payload CRC-32C with the one recorded by the encoder */
+Status verify_payload_crc(DecodeInfo *decInfo);
+
 /* Decodes a single byte from 8 pixels (using LSB method) */
 Status decode_byte_from_lsb(char *data, char *image_buffer);
 
-/* Decodes an integer value (like size) from 32 pixels */
+/* Decodes an integer value (like size) from 32 pixels (original layout) */
 Status decode_size_from_lsb(int *size, char *imageBuffer);
 
 /* Validates file extension during decoding */
@@ -1,45 +1,43 @@
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
 #include "encode.h"
 #include "types.h"
 #include "common.h"
+#include "lsb.h"
+#include "header.h"
+#include "bmp.h"
+#include "lz.h"
+#include "checksum.h"
 
 /* Function Definitions */
 
 /* Get image size
  * Input: Image file ptr
- * Output: width * height * bytes per pixel (3 in our case)
- * Description: In BMP Image, width is stored in offset 18,
- * and height after that. size is 4 bytes
+ * Output: number of real pixel bytes (row padding excluded)
+ * Description: The BMP headers are parsed by bmp_read_header, which
+ * honours bfOffBits, 24/32 bits per pixel and row padding
  */
-
-int extn_size;
-
-uint get_image_size_for_bmp(FILE *fptr_image)
+uint64_t get_image_size_for_bmp(FILE *fptr_image)
 {
-    uint width, height;
-    // Move to offset 18 where width is stored
-    fseek(fptr_image, 18, SEEK_SET);
-
-    // Read the width (integer - 4 bytes)
-    fread(&width, sizeof(int), 1, fptr_image);
-    // printf("           Width = %u\n", width);
-
-    // Read the height (integer - 4 bytes)
-    fread(&height, sizeof(int), 1, fptr_image);
-    // printf("           Height = %u\n", height);
-
-    // Return image capacity = width * height * 3 bytes
-    return width * height * 3;
+    BmpInfo bmp;
+    if (bmp_read_header(fptr_image, &bmp) != e_success)
+        return 0;
+    return bmp.capacity;
 }
 
-uint get_file_size(FILE *fptr)
+uint64_t get_file_size(FILE *fptr)
 {
     // Move to end of file to determine file size
-    fseek(fptr, 0, SEEK_END);
-    long size = ftell(fptr);
-    fseek(fptr, 0, SEEK_SET);
-    return size;
+    fseeko(fptr, 0, SEEK_END);
+    off_t size = ftello(fptr);
+    fseeko(fptr, 0, SEEK_SET);
+    return size < 0 ? 0 : size;
 }
 
 /*
@@ -75,15 +73,79 @@ Status validate_file_extension(const char *filename, char *valid_extns[], int ex
     return e_failure;
 }
 
+/*
+ * Payload bits per carrier byte (1 unless --lsb was given)
+ */
+static int encode_lsb_bits(const EncodeInfo *encInfo)
+{
+    return encInfo->lsb_bits >= 1 && encInfo->lsb_bits <= LSB_MAX_BITS ? encInfo->lsb_bits : 1;
+}
+
 /*
  * Read and validate input arguments for encoding
  * Ensures source, secret, and output files are correct
  */
 Status read_and_validate_encode_args(char *argv[], EncodeInfo *encInfo)
 {
-    // Validate source image (must be .bmp)
+    // k-LSB depth (0 means the default of 1 bit per pixel byte)
+    if (encInfo->lsb_bits < 0 || encInfo->lsb_bits > LSB_MAX_BITS)
+    {
+        fprintf(stderr, "Error: --lsb must be between 1 and %d.\n\n", LSB_MAX_BITS);
+        return e_failure;
+    }
+
+    // --key places every payload group itself, so the payload must be a
+    // plain one of known size
+    if (encInfo->key != NULL && (encInfo->stream || encInfo->compress || encInfo->archive != NULL))
+    {
+        fprintf(stderr, "Error: --key cannot be combined with --stream, --compress or --archive.\n\n");
+        return e_failure;
+    }
+    if (encInfo->key != NULL && encInfo->key[0] == '\0')
+    {
+        fprintf(stderr, "Error: --key must not be empty.\n\n");
+        return e_failure;
+    }
+
+    // --password encrypts the plain payload loop, chunk by chunk
+    if (encInfo->password != NULL &&
+        (encInfo->stream || encInfo->compress || encInfo->archive != NULL || encInfo->key != NULL))
+    {
+        fprintf(stderr, "Error: --password cannot be combined with --stream, --compress, --archive or --key.\n\n");
+        return e_failure;
+    }
+    if (encInfo->password != NULL && encInfo->password[0] == '\0')
+    {
+        fprintf(stderr, "Error: --password must not be empty.\n\n");
+        return e_failure;
+    }
+
+    // --archive: every argument after the cover is a file to pack; the
+    // output image comes with the option
     char *bmp_ext[] = {".bmp"};
-    if (validate_file_extension(argv[2], bmp_ext, 1) == e_success)
+    if (encInfo->archive != NULL)
+    {
+        if (encInfo->stream || encInfo->compress)
+        {
+            fprintf(stderr, "Error: --archive cannot be combined with --stream or --compress.\n\n");
+            return e_failure;
+        }
+        if (validate_file_extension(argv[2], bmp_ext, 1) != e_success ||
+            validate_file_extension(encInfo->stego_image_fname, bmp_ext, 1) != e_success)
+        {
+            fprintf(stderr, "Error: The cover and the --archive output must be .bmp files.\n\n");
+            return e_failure;
+        }
+        encInfo->src_image_fname = argv[2];
+        return archive_add_files(encInfo->archive, argv + 3, encode_lsb_bits(encInfo));
+    }
+
+    // Validate source image (must be .bmp, or "-" for stdin in --stream mode)
+    if (encInfo->stream && strcmp(argv[2], "-") == 0)
+    {
+        encInfo->src_image_fname = argv[2];
+    }
+    else if (validate_file_extension(argv[2], bmp_ext, 1) == e_success)
     {
         encInfo->src_image_fname = argv[2];
     }
@@ -94,8 +156,13 @@ Status read_and_validate_encode_args(char *argv[], EncodeInfo *encInfo)
     }
 
     // Validate secret file (allowed: .txt, .c, .h, .sh)
+    // In --stream mode the secret may be any pipe ("-" for stdin)
     char *secret_ext[] = {".txt", ".c", ".h", ".sh"};
-    if (validate_file_extension(argv[3], secret_ext, 4) == e_success)
+    if (encInfo->stream && !(strcmp(argv[3], "-") == 0 && strcmp(argv[2], "-") == 0))
+    {
+        encInfo->secret_fname = argv[3];
+    }
+    else if (validate_file_extension(argv[3], secret_ext, 4) == e_success)
     {
         encInfo->secret_fname = argv[3];
     }
@@ -108,7 +175,11 @@ Status read_and_validate_encode_args(char *argv[], EncodeInfo *encInfo)
     // Check for optional output filename
     if (argv[4] == NULL)
     {
-        encInfo->stego_image_fname = "destination.bmp"; // Default output name
+        encInfo->stego_image_fname = encInfo->stream ? "-" : "destination.bmp"; // Default output name
+    }
+    else if (encInfo->stream && strcmp(argv[4], "-") == 0)
+    {
+        encInfo->stego_image_fname = argv[4];
     }
     else
     {
@@ -131,8 +202,12 @@ Status read_and_validate_encode_args(char *argv[], EncodeInfo *encInfo)
  */
 Status open_files(EncodeInfo *encInfo)
 {
+    // Files handed over already open (--serve) are used as they are
+    if (encInfo->fptr_src_image != NULL && encInfo->fptr_secret != NULL && encInfo->fptr_stego_image != NULL)
+        return e_success;
+
     // Open source image in read-binary mode
-    encInfo->fptr_src_image = fopen(encInfo->src_image_fname, "rb");
+    encInfo->fptr_src_image = stream_open(encInfo->src_image_fname, "rb");
     if (encInfo->fptr_src_image == NULL)
     {
         perror("fopen");
@@ -140,9 +215,8 @@ Status open_files(EncodeInfo *encInfo)
         return e_failure;
     }
 
-    // Open secret file in read-binary mode
-    encInfo->fptr_secret = fopen(encInfo->secret_fname, "rb");
-    if (encInfo->fptr_secret == NULL)
+    // Open secret file in read-binary mode (archive files are opened while packing)
+    if (encInfo->archive == NULL && (encInfo->fptr_secret = stream_open(encInfo->secret_fname, "rb")) == NULL)
     {
         perror("fopen");
         fprintf(stderr, "ERROR: Unable to open file %s\n", encInfo->secret_fname);
@@ -150,7 +224,7 @@ Status open_files(EncodeInfo *encInfo)
     }
 
     // Open destination stego image in write-binary mode
-    encInfo->fptr_stego_image = fopen(encInfo->stego_image_fname, "wb");
+    encInfo->fptr_stego_image = stream_open(encInfo->stego_image_fname, "wb");
     if (encInfo->fptr_stego_image == NULL)
     {
         perror("fopen");
@@ -158,140 +232,1074 @@ Status open_files(EncodeInfo *encInfo)
         return e_failure;
     }
 
+    // Start the worker pool; each thread gets at least a default-sized block
+    if (encInfo->threads > 1)
+    {
+        encInfo->pool = pool_create(encInfo->threads);
+        if (encInfo->chunk_size == 0)
+            encInfo->chunk_size = (size_t)ENCODE_CHUNK_SIZE * pool_threads(encInfo->pool);
+    }
+
     return e_success;
 }
 
+/*
+ * Closes every file opened by open_files and frees the pixel buffer
+ */
+void close_files(EncodeInfo *encInfo)
+{
+    free(encInfo->image_buffer);
+    free(encInfo->carrier_buffer);
+    encInfo->image_buffer = encInfo->carrier_buffer = NULL;
+    pool_destroy(encInfo->pool);
+    encInfo->pool = NULL;
+    cover_cache_release(encInfo->cover_cache, encInfo->cover);
+    encInfo->cover = NULL;
+    if (encInfo->iopipe != NULL)
+        iopipe_close(encInfo->iopipe);
+    free(encInfo->iopipe);
+    encInfo->iopipe = NULL;
+
+    if (encInfo->fptr_src_image != NULL)
+        fclose(encInfo->fptr_src_image);
+    if (encInfo->fptr_secret != NULL)
+        fclose(encInfo->fptr_secret);
+    if (encInfo->fptr_stego_image != NULL)
+        fclose(encInfo->fptr_stego_image);
+    encInfo->fptr_src_image = encInfo->fptr_secret = encInfo->fptr_stego_image = NULL;
+}
+
 /*
  * Check if source image has enough capacity to hold secret data
  */
 Status check_capacity(EncodeInfo *encInfo)
 {
-    encInfo->image_capacity = get_image_size_for_bmp(encInfo->fptr_src_image);
-    encInfo->size_secret_file = get_file_size(encInfo->fptr_secret);
+    // Parse the cover headers: pixel offset, bit depth and row padding
+    // (a cached cover was parsed when it was read)
+    if (encInfo->cover_cache != NULL && encInfo->cover == NULL)
+        encInfo->cover = cover_cache_acquire(encInfo->cover_cache, fileno(encInfo->fptr_src_image));
+    if (encInfo->cover != NULL)
+    {
+        encInfo->bmp = encInfo->cover->bmp;
+    }
+    else if (bmp_read_header(encInfo->fptr_src_image, &encInfo->bmp) != e_success)
+    {
+        fprintf(stderr, "ERROR: %s is not an uncompressed 24/32-bit BMP\n", encInfo->src_image_fname);
+        return e_failure;
+    }
+    encInfo->image_capacity = encInfo->bmp.capacity;
+    encInfo->carrier_pos = 0;
+    encInfo->pixel_pos = 0;
+    if (encInfo->archive != NULL)
+    {
+        // Archive: the payload is the index followed by every file
+        encInfo->size_secret_file = encInfo->archive->index_size + encInfo->archive->data_size;
+        encInfo->extn_secret_file[0] = '\0';
+    }
+    else
+    {
+        encInfo->size_secret_file = get_file_size(encInfo->fptr_secret);
+
+        // Identify and store file extension of secret file
+        char *extn = strrchr(encInfo->secret_fname, '.');
+        if (extn == NULL || strlen(extn) >= sizeof(encInfo->extn_secret_file))
+            return e_failure;
+        strcpy(encInfo->extn_secret_file, extn); // Store extension
+
+        // Shard: the payload is the shard record and one slice of the secret
+        if (encInfo->shard != NULL)
+            encInfo->size_secret_file = SHARD_RECORD_SIZE + encInfo->shard->size;
+
+        // Encrypted: the cipher head comes before the ciphertext, and the
+        // keystream must not wrap
+        if (encInfo->password != NULL)
+        {
+            if (encInfo->size_secret_file > CIPHER_MAX_PAYLOAD)
+            {
+                fprintf(stderr, "ERROR: --password payloads are limited to %llu bytes\n",
+                        (unsigned long long)CIPHER_MAX_PAYLOAD);
+                return e_failure;
+            }
+            encInfo->size_secret_file += CIPHER_HEAD_SIZE;
+        }
+    }
 
-    // Identify and store file extension of secret file
-    char *extn;
-    if (strstr(encInfo->secret_fname, ".txt") != NULL)
-        extn = strstr(encInfo->secret_fname, ".txt");
-    else if (strstr(encInfo->secret_fname, ".c") != NULL)
-        extn = strstr(encInfo->secret_fname, ".c");
-    else if (strstr(encInfo->secret_fname, ".h") != NULL)
-        extn = strstr(encInfo->secret_fname, ".h");
-    else if (strstr(encInfo->secret_fname, ".sh") != NULL)
-        extn = strstr(encInfo->secret_fname, ".sh");
+    // Guard against the multiplication below wrapping for absurd sizes
+    if (encInfo->size_secret_file > UINT64_MAX / 16)
+        return e_failure;
+
+    // Calculate total pixel bytes needed for encoding (64-bit); the magic
+    // string and header always use 1 bit per byte, the data lsb_bits
+    int bits = encode_lsb_bits(encInfo);
+    uint64_t total_bytes = (strlen(MAGIC_STRING_V2) + STEG_HEADER_SIZE) * 8ULL +
+                           (encInfo->size_secret_file * 8 + bits - 1) / bits;
 
-    strcpy(encInfo->extn_secret_file, extn); // Store extension
-    extn_size = strlen(extn);
+    // Scattered payloads move whole 8-carrier groups
+    if (encInfo->key != NULL)
+        total_bytes = (strlen(MAGIC_STRING_V2) + STEG_HEADER_SIZE) * 8ULL +
+                      (encInfo->size_secret_file + bits - 1) / bits * 8;
 
-    // Calculate total bytes needed for encoding
-    int total_bytes = 54 + (strlen(MAGIC_STRING) * 8) + 32 +
-                      (extn_size * 8) + 32 + (encInfo->size_secret_file * 8);
+    // The compressed size is only known while embedding, where every
+    // frame is checked; here the end marker must fit at least
+    if (encInfo->compress)
+        total_bytes = (strlen(MAGIC_STRING_V2) + STEG_HEADER_SIZE) * 8ULL +
+                      lsb_carriers(STREAM_FRAME_LEN_SIZE, bits);
 
     // Compare available vs required capacity
-    if (encInfo->image_capacity > total_bytes)
+    if (encInfo->image_capacity >= total_bytes)
         return e_success;
     else
         return e_failure;
 }
 
 /*
- * Copy first 54 bytes (BMP header) from source to destination
+ * Copy everything before the pixel array (file header, info header,
+ * bit masks, palette) from source to destination
  */
-Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image)
+Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image, uint32_t header_size)
 {
-    char buffer[54];
+    char buffer[4096];
     rewind(fptr_src_image);
-    fread(buffer, 54, 1, fptr_src_image);
-    fwrite(buffer, 54, 1, fptr_dest_image);
-    if (ftell(fptr_src_image) == ftell(fptr_dest_image))
+    for (uint32_t done = 0; done < header_size;)
+    {
+        size_t len = header_size - done < sizeof(buffer) ? header_size - done : sizeof(buffer);
+        if (fread(buffer, 1, len, fptr_src_image) != len ||
+            fwrite(buffer, 1, len, fptr_dest_image) != len)
+            return e_failure;
+        done += len;
+    }
+    if (ftello(fptr_src_image) == ftello(fptr_dest_image))
         return e_success;
     else
         return e_failure;
 }
 
 /*
- * Encode the magic string into the LSBs of image data
+ * Cover bytes at a file offset: copied from the cached cover, or read
+ * from the file without moving its position
  */
-Status encode_magic_string(const char *magic_string, EncodeInfo *encInfo)
+static Status encode_pread_cover(EncodeInfo *encInfo, char *buffer, size_t len, off_t offset)
 {
-    char buffer[8];
-    for (size_t i = 0; i < strlen(magic_string); i++)
+    if (encInfo->cover != NULL)
     {
-        fread(buffer, 8, 1, encInfo->fptr_src_image);
-        encode_byte_to_lsb(magic_string[i], buffer);
-        fwrite(buffer, 8, 1, encInfo->fptr_stego_image);
+        if (offset < 0 || (uint64_t)offset + len > (uint64_t)encInfo->cover->size)
+            return e_failure;
+        memcpy(buffer, encInfo->cover->data + offset, len);
+        return e_success;
     }
-    return e_success;
+    return pread(fileno(encInfo->fptr_src_image), buffer, len, offset) == (ssize_t)len ? e_success : e_failure;
 }
 
 /*
- * Encode secret file extension size (32 bits)
+ * The next len pixel bytes of the cover (from pixel_pos on)
  */
-Status encode_secret_file_extn_size(int size, EncodeInfo *encInfo)
+static Status encode_read_pixels(EncodeInfo *encInfo, char *buffer, size_t len)
 {
-    char buffer[32];
-    fread(buffer, 32, 1, encInfo->fptr_src_image);
-    encode_size_to_lsb(size, buffer);
-    fwrite(buffer, 32, 1, encInfo->fptr_stego_image);
-    return e_success;
+    if (encInfo->cover != NULL)
+        return encode_pread_cover(encInfo, buffer, len, encInfo->bmp.data_offset + encInfo->pixel_pos);
+    return fread(buffer, 1, len, encInfo->fptr_src_image) == len ? e_success : e_failure;
+}
+
+/*
+ * Cover header into the stego image, from the cache when it holds the cover
+ */
+static Status encode_copy_header(EncodeInfo *encInfo)
+{
+    uint32_t len = encInfo->bmp.data_offset;
+    if (encInfo->cover == NULL)
+        return copy_bmp_header(encInfo->fptr_src_image, encInfo->fptr_stego_image, len);
+    return fwrite(encInfo->cover->data, 1, len, encInfo->fptr_stego_image) == len ? e_success : e_failure;
+}
+
+/*
+ * Pixel bytes per block, rounded down to whole payload bytes
+ */
+static size_t encode_chunk_size(const EncodeInfo *encInfo)
+{
+    size_t chunk = encInfo->chunk_size ? encInfo->chunk_size : ENCODE_CHUNK_SIZE;
+    chunk &= ~(size_t)7;
+    return chunk ? chunk : 8;
 }
 
 /*
- * Encode secret file extension characters into LSBs
+ * File bytes per block: a block of chunk carriers may also hold up to 3
+ * padding bytes per row it crosses
  */
-Status encode_secret_file_extn(const char *file_extn, EncodeInfo *encInfo)
+static size_t encode_block_size(const EncodeInfo *encInfo)
 {
-    char buffer[8];
-    for (size_t i = 0; i < strlen(file_extn); i++)
+    size_t chunk = encode_chunk_size(encInfo);
+    return chunk + (chunk / encInfo->bmp.row_bytes + 2) * 3;
+}
+
+/*
+ * Start the asynchronous pipeline at the payload, for at least
+ * ENCODE_ASYNC_MIN_BLOCKS blocks between two regular files. It only pays
+ * off when embedding and I/O run on different CPUs, so by default it
+ * needs more than one (--async-io forces it, --sync-io turns it off).
+ * Anything else (pipes, --stream, --key, which patches blocks in place,
+ * small payloads) stays synchronous, and so does a pipe that cannot start.
+ */
+static void encode_start_async(EncodeInfo *encInfo)
+{
+    struct stat in, out;
+    int bits = encode_lsb_bits(encInfo);
+    size_t chunk = encode_chunk_size(encInfo);
+    if (encInfo->sync_io || (!encInfo->async_io && sysconf(_SC_NPROCESSORS_ONLN) <= 1) ||
+        encInfo->stream || encInfo->key != NULL || encInfo->iopipe != NULL ||
+        lsb_carriers(encInfo->size_secret_file, bits) < (uint64_t)ENCODE_ASYNC_MIN_BLOCKS * chunk ||
+        fstat(fileno(encInfo->fptr_src_image), &in) != 0 || fstat(fileno(encInfo->fptr_stego_image), &out) != 0 ||
+        !S_ISREG(in.st_mode) || !S_ISREG(out.st_mode))
+        return;
+
+    // The pipe takes over both files at the current pixel position
+    if (encInfo->block_size == 0)
+        encInfo->block_size = encode_block_size(encInfo);
+    IoPipe *io = malloc(sizeof(IoPipe));
+    off_t pos = encInfo->bmp.data_offset + encInfo->pixel_pos;
+    off_t size = encInfo->cover != NULL ? (off_t)encInfo->cover->size : in.st_size;
+    if (io != NULL && fflush(encInfo->fptr_stego_image) == 0 &&
+        iopipe_open(io, encInfo->cover != NULL ? -1 : fileno(encInfo->fptr_src_image),
+                    fileno(encInfo->fptr_stego_image), size, pos, encInfo->block_size,
+                    encInfo->io_thread) == e_success)
     {
-        fread(buffer, 8, 1, encInfo->fptr_src_image);
-        encode_byte_to_lsb(file_extn[i], buffer);
-        fwrite(buffer, 8, 1, encInfo->fptr_stego_image);
+        encInfo->iopipe = io;
+        free(encInfo->image_buffer);
+        encInfo->image_buffer = NULL;
     }
-    return e_success;
+    else
+        free(io);
 }
 
 /*
- * Encode secret file size (4 bytes -> 32 bits)
+ * Write the used part of the open pipeline block; the next one starts
+ * at the pixel position reached
  */
-Status encode_secret_file_size(long file_size, EncodeInfo *encInfo)
+static Status encode_put_async(EncodeInfo *encInfo)
 {
-    char buffer[32];
-    fread(buffer, 32, 1, encInfo->fptr_src_image);
-    encode_size_to_lsb(file_size, buffer);
-    fwrite(buffer, 32, 1, encInfo->fptr_stego_image);
+    IoPipe *io = encInfo->iopipe;
+    if (io->data == NULL)
+        return e_success;
+    return iopipe_put(io, encInfo->bmp.data_offset + encInfo->pixel_pos - io->pos);
+}
+
+/*
+ * Wait for the pipeline, record its overlap and hand both files back to
+ * stdio at the pixel position reached. It ends with the payload: later
+ * fields (the CRC patch) are small, so the rest of the encode stays
+ * synchronous.
+ */
+static Status encode_finish_async(EncodeInfo *encInfo)
+{
+    IoPipe *io = encInfo->iopipe;
+    if (io == NULL)
+        return e_success;
+
+    Status ret = encode_put_async(encInfo);
+    if (iopipe_close(io) != e_success)
+        ret = e_failure;
+    if (encInfo->stats != NULL)
+    {
+        AsyncStats *async = &encInfo->stats->async;
+        async->engine = iopipe_engine_name(io->engine);
+        async->reads += io->reads;
+        async->writes += io->writes;
+        async->io_seconds += io->io_seconds;
+        async->wait_seconds += io->wait_seconds;
+        async->ring_read += io->ring_read;
+        async->ring_written += io->ring_written;
+        if (io->engine == e_io_uring)
+        {
+            async->ring_reads += io->reads;
+            async->ring_writes += io->writes;
+        }
+    }
+    free(io);
+    encInfo->iopipe = NULL;
+    encInfo->sync_io = 1;
+
+    off_t pos = encInfo->bmp.data_offset + encInfo->pixel_pos;
+    if (fseeko(encInfo->fptr_src_image, pos, SEEK_SET) != 0 || fseeko(encInfo->fptr_stego_image, pos, SEEK_SET) != 0)
+        ret = e_failure;
+    if (ret != e_success)
+        fprintf(stderr, "ERROR: Unable to write stego image\n");
+    return ret;
+}
+
+/*
+ * Everything after the last pixel byte read, from the cache with one
+ * write when it holds the cover
+ */
+static Status encode_copy_tail(EncodeInfo *encInfo)
+{
+    if (encode_finish_async(encInfo) != e_success)
+        return e_failure;
+    if (encInfo->cover == NULL)
+        return copy_remaining_img_data(encInfo->fptr_src_image, encInfo->fptr_stego_image,
+                                       &encInfo->tail_copy_method);
+
+    uint64_t start = encInfo->bmp.data_offset + encInfo->pixel_pos;
+    size_t len = encInfo->cover->size - start;
+    encInfo->tail_copy_method = e_copy_cache;
+    return fwrite(encInfo->cover->data + start, 1, len, encInfo->fptr_stego_image) == len ? e_success : e_failure;
+}
+
+/*
+ * Encode a block of data into the LSBs of image data
+ */
+Status encode_data_to_image(const char *data, size_t size, EncodeInfo *encInfo)
+{
+    return encode_data_to_image_bits(data, size, 1, encInfo);
+}
+
+/*
+ * Encode a block of data into the low bits bits of image data
+ * Each block covers chunk_size carrier bytes: the file bytes spanning
+ * them (row padding included) are read with one fread, the carriers are
+ * gathered, embedded in one pass, scattered back and written with a
+ * single fwrite. Without row padding the gather/scatter is skipped.
+ * Blocks hold whole groups of bits payload bytes, so only the last one
+ * can end in a short group.
+ * With the pipeline the file blocks come from the pipe instead and are
+ * shared by consecutive calls: data goes into the open block while its
+ * carriers fit, and only then is the block written and the next one
+ * taken.
+ */
+Status encode_data_to_image_bits(const char *data, size_t size, int bits, EncodeInfo *encInfo)
+{
+    const BmpInfo *bmp = &encInfo->bmp;
+    int contiguous = bmp_is_contiguous(bmp);
+    size_t chunk = encode_chunk_size(encInfo);
+    IoPipe *io = encInfo->iopipe;
+    uint64_t total = size;
+
+    // The block buffers are allocated once and reused by every stage
+    // (the pipeline has its own)
+    if (encInfo->block_size == 0)
+        encInfo->block_size = encode_block_size(encInfo);
+    if (!contiguous && encInfo->carrier_buffer == NULL && (encInfo->carrier_buffer = malloc(chunk)) == NULL)
+    {
+        fprintf(stderr, "ERROR: Unable to allocate %zu bytes for carrier buffer\n", chunk);
+        return e_failure;
+    }
+    if (io == NULL && encInfo->image_buffer == NULL &&
+        (encInfo->image_buffer = malloc(encInfo->block_size)) == NULL)
+    {
+        fprintf(stderr, "ERROR: Unable to allocate %zu bytes for image buffer\n", encInfo->block_size);
+        return e_failure;
+    }
+
+    char *buffer = encInfo->image_buffer;
+    uint64_t done = 0;
+    int fresh = 0; // The open block was just taken
+    while (done < total)
+    {
+        size_t bytes = (total - done) < chunk / 8 * bits ? (size_t)(total - done) : chunk / 8 * bits;
+        uint64_t first = encInfo->carrier_pos;
+        if (first + lsb_carriers(bytes, bits) > bmp->capacity)
+        {
+            fprintf(stderr, "ERROR: Source image has no pixel bytes left\n");
+            return e_failure;
+        }
+
+        if (io != NULL)
+        {
+            // Whole groups up to the end of the open block, if any fit
+            uint64_t block = io->pos - bmp->data_offset;
+            uint64_t avail = io->data != NULL ? bmp_carriers_before(bmp, block + io->len) - first : 0;
+            if (lsb_carriers(bytes, bits) > avail)
+                bytes = avail / 8 * bits;
+            if (bytes == 0)
+            {
+                // Write the block and take the next one (read while this
+                // one embedded)
+                if (!fresh && encode_put_async(encInfo) != e_success)
+                {
+                    fprintf(stderr, "ERROR: Unable to write stego image\n");
+                    return e_failure;
+                }
+                if (fresh || iopipe_next(io) == NULL ||
+                    (encInfo->cover != NULL && encode_read_pixels(encInfo, io->data, io->len) != e_success))
+                {
+                    fprintf(stderr, "ERROR: Unexpected end of source image\n");
+                    return e_failure;
+                }
+                fresh = 1;
+                continue;
+            }
+            fresh = 0;
+            buffer = io->data + (encInfo->pixel_pos - block);
+        }
+        size_t n = lsb_carriers(bytes, bits);
+
+        // Read every file byte up to the last carrier of this block
+        uint64_t end = bmp_carrier_offset(bmp, first + n - 1) + 1;
+        size_t len = end - encInfo->pixel_pos;
+        if (io == NULL && encode_read_pixels(encInfo, buffer, len) != e_success)
+        {
+            fprintf(stderr, "ERROR: Unexpected end of source image\n");
+            return e_failure;
+        }
+
+        // Embed every data byte of this block into 8 carrier bytes
+        char *carriers = buffer + (bmp_carrier_offset(bmp, first) - encInfo->pixel_pos);
+        if (!contiguous)
+        {
+            carriers = encInfo->carrier_buffer;
+            bmp_gather(bmp, buffer, encInfo->pixel_pos, first, n, carriers);
+        }
+        parallel_embed_bytes(encInfo->pool, carriers, data + done, bytes, bits);
+        if (!contiguous)
+            bmp_scatter(bmp, buffer, encInfo->pixel_pos, first, n, carriers);
+
+        // Write the modified block back in one call (the pipeline writes
+        // it once nothing more fits)
+        if (io == NULL && fwrite(buffer, 1, len, encInfo->fptr_stego_image) != len)
+        {
+            fprintf(stderr, "ERROR: Unable to write stego image\n");
+            return e_failure;
+        }
+        encInfo->pixel_pos = end;
+        encInfo->carrier_pos += n;
+        done += bytes;
+    }
     return e_success;
 }
 
+/*
+ * Encode the magic string into the LSBs of image data
+ */
+Status encode_magic_string(const char *magic_string, EncodeInfo *encInfo)
+{
+    return encode_data_to_image(magic_string, strlen(magic_string), encInfo);
+}
+
+/*
+ * Encode the versioned stego header (version, flags, extension,
+ * 64-bit secret size, header checksum)
+ */
+Status encode_stego_header(EncodeInfo *encInfo)
+{
+    unsigned char buffer[STEG_HEADER_SIZE];
+    StegHeader *header = &encInfo->header;
+
+    memset(header, 0, sizeof(*header));
+    header->version = STEG_VERSION;
+    header->flags = (encInfo->stream ? STEG_FLAG_STREAM : 0) | (encInfo->compress ? STEG_FLAG_LZ : 0) |
+                    (encInfo->archive != NULL ? STEG_FLAG_ARCHIVE : 0) |
+                    (encInfo->shard != NULL ? STEG_FLAG_SHARD : 0) |
+                    (encInfo->key != NULL ? STEG_FLAG_SCATTER : 0) |
+                    (encInfo->password != NULL ? STEG_FLAG_CIPHER : 0) | STEG_FLAG_CRC;
+    header->lsb_bits = encode_lsb_bits(encInfo);
+    header->extn_len = strlen(encInfo->extn_secret_file);
+    memcpy(header->extn, encInfo->extn_secret_file, header->extn_len);
+    header->payload_size = encInfo->size_secret_file;
+    if (encInfo->key != NULL)
+        header->key_check = scatter_key_check(scatter_key_seed(encInfo->key));
+
+    steg_header_pack(header, buffer);
+    return encode_data_to_image((const char *)buffer, STEG_HEADER_SIZE, encInfo);
+}
+
 /*
  * Encode the actual secret file data into LSBs
+ * The secret is streamed: each read fills exactly one pixel block, so
+ * peak memory is chunk_size + chunk_size / 8 whatever the secret size.
+ * A shard embeds its record first, then only its slice of the secret.
+ * With --password the cipher head goes first and every chunk is
+ * encrypted in place right after it is read, so it is still in the
+ * cache when it is checksummed and embedded.
  */
 Status encode_secret_file_data(EncodeInfo *encInfo)
 {
-    fread(encInfo->secret_data, encInfo->size_secret_file, 1, encInfo->fptr_secret);
-    char buffer[8];
-    for (size_t i = 0; i < encInfo->size_secret_file; i++)
+    // Large payloads are read and written behind the embedding
+    encode_start_async(encInfo);
+    int bits = encode_lsb_bits(encInfo);
+    size_t chunk = encode_chunk_size(encInfo) / 8 * bits;
+    char *secret = malloc(chunk);
+    if (secret == NULL)
     {
-        fread(buffer, 8, 1, encInfo->fptr_src_image);
-        encode_byte_to_lsb(encInfo->secret_data[i], buffer);
-        fwrite(buffer, 8, 1, encInfo->fptr_stego_image);
+        fprintf(stderr, "ERROR: Unable to allocate %zu bytes for secret buffer\n", chunk);
+        return e_failure;
+    }
+
+    Status ret = e_success;
+    uint64_t remaining = encInfo->size_secret_file;
+    off_t offset = 0;
+    if (encInfo->shard != NULL)
+    {
+        unsigned char record[SHARD_RECORD_SIZE];
+        shard_record_pack(encInfo->shard, record);
+        encInfo->header.payload_crc = crc32c(encInfo->header.payload_crc, record, SHARD_RECORD_SIZE);
+        ret = encode_data_to_image_bits((const char *)record, SHARD_RECORD_SIZE, bits, encInfo);
+        remaining = encInfo->shard->size;
+        offset = encInfo->shard->offset;
+    }
+    CipherCtx cipher = {0};
+    if (ret == e_success && encInfo->password != NULL)
+    {
+        unsigned char head[CIPHER_HEAD_SIZE];
+        if (cipher_init_encrypt(&cipher, encInfo->password, head) != e_success)
+        {
+            fprintf(stderr, "ERROR: Unable to draw a random salt for --password\n");
+            free(secret);
+            return e_failure;
+        }
+        encInfo->header.payload_crc = crc32c(encInfo->header.payload_crc, head, CIPHER_HEAD_SIZE);
+        ret = encode_data_to_image_bits((const char *)head, CIPHER_HEAD_SIZE, bits, encInfo);
+        remaining -= CIPHER_HEAD_SIZE;
+    }
+    // A shard that embedded the wrong slice would still pass its own CRC
+    if (ret == e_success && fseeko(encInfo->fptr_secret, offset, SEEK_SET) != 0)
+    {
+        fprintf(stderr, "ERROR: Unable to seek to offset %lld of secret file %s\n", (long long)offset,
+                encInfo->secret_fname);
+        ret = e_failure;
+    }
+    while (ret == e_success && remaining > 0)
+    {
+        size_t len = remaining < chunk ? (size_t)remaining : chunk;
+        if (fread(secret, 1, len, encInfo->fptr_secret) != len)
+        {
+            fprintf(stderr, "ERROR: Unexpected end of secret file %s\n", encInfo->secret_fname);
+            ret = e_failure;
+            break;
+        }
+        if (encInfo->password != NULL)
+            chacha20_xor(&cipher, secret, len);
+        encInfo->header.payload_crc = crc32c(encInfo->header.payload_crc, secret, len);
+        ret = encode_data_to_image_bits(secret, len, bits, encInfo);
+        remaining -= len;
+    }
+    encInfo->size_embedded = encInfo->size_secret_file;
+
+    free(secret);
+    return ret;
+}
+
+/*
+ * Name of the path used to copy the image tail
+ */
+const char *copy_method_name(CopyMethod method)
+{
+    switch (method)
+    {
+    case e_copy_file_range:
+        return "copy_file_range";
+    case e_copy_sendfile:
+        return "sendfile";
+    case e_copy_buffered:
+        return "buffered";
+    case e_copy_cache:
+        return "cover cache";
+    default:
+        return "none";
     }
-    return e_success;
 }
 
 /*
  * Copy any remaining image data to complete the stego file
+ * Tries copy_file_range first, then sendfile, and falls back to
+ * large buffered fread/fwrite when the kernel cannot do the copy
  */
-Status copy_remaining_img_data(FILE *fptr_src, FILE *fptr_dest)
+Status copy_remaining_img_data(FILE *fptr_src, FILE *fptr_dest, CopyMethod *method)
 {
-    char ch;
-    while (fread(&ch, 1, 1, fptr_src) == 1)
+    struct stat st;
+    off_t off_in = ftello(fptr_src);
+    *method = e_copy_none;
+
+    // Hand the data over to the kernel when both ends are regular files
+    if (fflush(fptr_dest) == 0 && fstat(fileno(fptr_src), &st) == 0 && S_ISREG(st.st_mode))
     {
-        fwrite(&ch, 1, 1, fptr_dest);
+        int fd_in = fileno(fptr_src);
+        int fd_out = fileno(fptr_dest);
+
+        // Step 1: In-kernel copy (reflink or splice inside the filesystem)
+        while (off_in < st.st_size)
+        {
+            ssize_t n = copy_file_range(fd_in, &off_in, fd_out, NULL, st.st_size - off_in, 0);
+            if (n <= 0)
+                break;
+            *method = e_copy_file_range;
+        }
+
+        // Step 2: sendfile for whatever copy_file_range could not move
+        while (off_in < st.st_size)
+        {
+            ssize_t n = sendfile(fd_out, fd_in, &off_in, st.st_size - off_in);
+            if (n <= 0)
+                break;
+            *method = e_copy_sendfile;
+        }
+
+        // Resync both streams with the file descriptor offsets
+        fseeko(fptr_src, off_in, SEEK_SET);
+        fseeko(fptr_dest, 0, SEEK_END);
+        if (off_in >= st.st_size)
+            return e_success;
     }
+
+    // Step 3: Buffered fallback for anything left
+    char *buffer = malloc(ENCODE_CHUNK_SIZE);
+    if (buffer == NULL)
+        return e_failure;
+
+    size_t n;
+    Status ret = e_success;
+    while ((n = fread(buffer, 1, ENCODE_CHUNK_SIZE, fptr_src)) > 0)
+    {
+        if (fwrite(buffer, 1, n, fptr_dest) != n)
+        {
+            ret = e_failure;
+            break;
+        }
+        *method = e_copy_buffered;
+    }
+    free(buffer);
+    return ret;
+}
+
+/*
+ * Embed one frame: the 32-bit length field, then len bytes of data
+ * The two are separate fields, so with k-LSB each starts on a fresh
+ * carrier byte. The frame and the fields after it (end marker, and the
+ * CRC in --stream mode) must still fit the cover.
+ */
+static Status encode_frame(EncodeInfo *encInfo, const char *data, size_t len, uint32_t field, int bits)
+{
+    unsigned char len_bytes[STREAM_FRAME_LEN_SIZE];
+    int fields = encInfo->stream ? 3 : 2; // --stream also needs room for the CRC field
+    uint64_t needed = fields * lsb_carriers(STREAM_FRAME_LEN_SIZE, bits) + lsb_carriers(len, bits);
+    if (len > 0 && encInfo->carrier_pos + needed > encInfo->bmp.capacity)
+    {
+        fprintf(stderr, "ERROR: Secret is larger than the capacity of %s\n", encInfo->src_image_fname);
+        return e_failure;
+    }
+
+    for (int i = 0; i < STREAM_FRAME_LEN_SIZE; i++)
+        len_bytes[i] = field >> (8 * i);
+    if (encode_data_to_image_bits((const char *)len_bytes, STREAM_FRAME_LEN_SIZE, bits, encInfo) != e_success ||
+        encode_data_to_image_bits(data, len, bits, encInfo) != e_success)
+        return e_failure;
+    encInfo->size_embedded += STREAM_FRAME_LEN_SIZE + len;
     return e_success;
 }
 
+/*
+ * Encode a secret of unknown length (--stream)
+ * Each read of up to one block of payload becomes one frame: a 32-bit
+ * length followed by the data. A zero length frame marks the end.
+ */
+Status encode_secret_file_stream(EncodeInfo *encInfo)
+{
+    int bits = encode_lsb_bits(encInfo);
+    size_t chunk = encode_chunk_size(encInfo) / 8 * bits;
+    char *frame = malloc(chunk);
+    if (frame == NULL)
+    {
+        fprintf(stderr, "ERROR: Unable to allocate %zu bytes for secret buffer\n", chunk);
+        return e_failure;
+    }
+
+    Status ret = e_success;
+    size_t len;
+    encInfo->size_secret_file = encInfo->size_embedded = 0;
+    do
+    {
+        len = fread(frame, 1, chunk, encInfo->fptr_secret);
+        if (len < chunk && ferror(encInfo->fptr_secret))
+        {
+            fprintf(stderr, "ERROR: Unable to read secret %s\n", encInfo->secret_fname);
+            ret = e_failure;
+            break;
+        }
+        encInfo->header.payload_crc = crc32c(encInfo->header.payload_crc, frame, len);
+        ret = encode_frame(encInfo, frame, len, len, bits);
+        encInfo->size_secret_file += len;
+    } while (ret == e_success && len > 0);
+
+    if (ret == e_success)
+        ret = encode_payload_crc(encInfo);
+    free(frame);
+    return ret;
+}
+
+/* LZ blocks compressed per thread between two embedding passes */
+#define ENCODE_LZ_BATCH 4
+
+/* One batch of blocks for compress_blocks */
+typedef struct _LzBatch
+{
+    const unsigned char *input; // Secret bytes, LZ_BLOCK_SIZE per block (the last may be short)
+    unsigned char *output;      // One LZ_BLOCK_SIZE slot per block
+    size_t input_size;          // Bytes in input
+    size_t *packed_size;        // Compressed size per block, 0 = store raw
+} LzBatch;
+
+/*
+ * pool_for task: compress blocks [begin, end) of a batch
+ * A block is kept compressed only if it shrinks
+ */
+static void compress_blocks(void *ctx, size_t begin, size_t end)
+{
+    LzBatch *batch = ctx;
+    for (size_t i = begin; i < end; i++)
+    {
+        size_t offset = i * LZ_BLOCK_SIZE;
+        size_t len = batch->input_size - offset < LZ_BLOCK_SIZE ? batch->input_size - offset : LZ_BLOCK_SIZE;
+        batch->packed_size[i] = lz_compress(batch->input + offset, len, batch->output + offset, len - 1);
+    }
+}
+
+/*
+ * Encode the secret LZ-compressed (--compress)
+ * The secret is read a batch of blocks at a time; the blocks are
+ * compressed in parallel on the -j pool and embedded in order as
+ * frames (see lz.h). Works for files and for --stream input alike.
+ */
+Status encode_secret_file_compressed(EncodeInfo *encInfo)
+{
+    // Large payloads are read and written behind the embedding
+    encode_start_async(encInfo);
+    int bits = encode_lsb_bits(encInfo);
+    size_t blocks = (size_t)ENCODE_LZ_BATCH * pool_threads(encInfo->pool);
+    size_t batch_size = blocks * LZ_BLOCK_SIZE;
+    unsigned char *input = malloc(batch_size);
+    unsigned char *output = malloc(batch_size);
+    size_t *packed_size = malloc(blocks * sizeof(size_t));
+    Status ret = e_success;
+    if (input == NULL || output == NULL || packed_size == NULL)
+    {
+        fprintf(stderr, "ERROR: Unable to allocate %zu bytes for compression buffers\n", 2 * batch_size);
+        ret = e_failure;
+    }
+
+    size_t len = 0;
+    uint64_t total = 0;
+    encInfo->size_embedded = 0;
+    if (!encInfo->stream)
+        fseek(encInfo->fptr_secret, 0, SEEK_SET);
+    while (ret == e_success)
+    {
+        len = fread(input, 1, batch_size, encInfo->fptr_secret);
+        if (len < batch_size && ferror(encInfo->fptr_secret))
+        {
+            fprintf(stderr, "ERROR: Unable to read secret %s\n", encInfo->secret_fname);
+            ret = e_failure;
+            break;
+        }
+
+        // Compress the whole batch, then embed the blocks in order
+        encInfo->header.payload_crc = crc32c(encInfo->header.payload_crc, input, len);
+        LzBatch batch = {input, output, len, packed_size};
+        size_t count = (len + LZ_BLOCK_SIZE - 1) / LZ_BLOCK_SIZE;
+        pool_for(encInfo->pool, count, 1, compress_blocks, &batch);
+        for (size_t i = 0; ret == e_success && i < count; i++)
+        {
+            size_t offset = i * LZ_BLOCK_SIZE;
+            size_t raw = len - offset < LZ_BLOCK_SIZE ? len - offset : LZ_BLOCK_SIZE;
+            if (packed_size[i] > 0)
+                ret = encode_frame(encInfo, (const char *)output + offset, packed_size[i], packed_size[i], bits);
+            else
+                ret = encode_frame(encInfo, (const char *)input + offset, raw, raw | LZ_FRAME_STORED, bits);
+        }
+        total += len;
+        if (len < batch_size)
+            break;
+    }
+
+    // A file must still hold the size recorded in the header
+    if (ret == e_success && !encInfo->stream && total != encInfo->size_secret_file)
+    {
+        fprintf(stderr, "ERROR: Secret file %s changed while encoding\n", encInfo->secret_fname);
+        ret = e_failure;
+    }
+    encInfo->size_secret_file = total;
+
+    // End marker (and the CRC field of a --stream image)
+    if (ret == e_success)
+        ret = encode_frame(encInfo, NULL, 0, 0, bits);
+    if (ret == e_success && encInfo->stream)
+        ret = encode_payload_crc(encInfo);
+
+    free(input);
+    free(output);
+    free(packed_size);
+    return ret;
+}
+
+/*
+ * Re-embed size bytes at carrier first of the stego image already
+ * written: the cover bytes are read back with pread, the data is
+ * embedded and the result written over the old bytes with pwrite, so
+ * neither stream position moves. Fields patched this way must fill
+ * whole groups of bits bytes.
+ */
+static Status encode_patch_carriers(EncodeInfo *encInfo, uint64_t first, const char *data, size_t size, int bits)
+{
+    const BmpInfo *bmp = &encInfo->bmp;
+    size_t n = lsb_carriers(size, bits);
+    uint64_t start = bmp_carrier_offset(bmp, first);
+    size_t len = bmp_carrier_offset(bmp, first + n - 1) + 1 - start;
+    char *buffer = malloc(len);
+    char *carriers = malloc(n);
+    off_t offset = bmp->data_offset + start;
+    Status ret = e_failure;
+
+    // Pending writes to the patched area must reach the file first
+    if (buffer != NULL && carriers != NULL && encode_finish_async(encInfo) == e_success &&
+        fflush(encInfo->fptr_stego_image) == 0 &&
+        encode_pread_cover(encInfo, buffer, len, offset) == e_success)
+    {
+        bmp_gather(bmp, buffer, start, first, n, carriers);
+        lsb_embed_bits(carriers, data, size, bits);
+        bmp_scatter(bmp, buffer, start, first, n, carriers);
+        if (pwrite(fileno(encInfo->fptr_stego_image), buffer, len, offset) == (ssize_t)len)
+            ret = e_success;
+    }
+    free(buffer);
+    free(carriers);
+    return ret;
+}
+
+/*
+ * Append len bytes to the staging buffer of encode_secret_file_archive,
+ * embedding it every time it fills up (a full buffer is a whole number
+ * of groups, so the payload stays contiguous across calls)
+ */
+static Status encode_staged(EncodeInfo *encInfo, char *stage, size_t *fill, size_t chunk,
+                            const char *data, size_t len, int bits)
+{
+    while (len > 0)
+    {
+        size_t part = chunk - *fill < len ? chunk - *fill : len;
+        memcpy(stage + *fill, data, part);
+        *fill += part;
+        data += part;
+        len -= part;
+        if (*fill == chunk)
+        {
+            if (encode_data_to_image_bits(stage, chunk, bits, encInfo) != e_success)
+                return e_failure;
+            *fill = 0;
+        }
+    }
+    return e_success;
+}
+
+/*
+ * Encode an archive (--archive): the index, then every file back to
+ * back, in one pass over the cover
+ * The entry checksums are only known once the files have been read, so
+ * the index is embedded with zero checksums and patched in place at the
+ * end. The payload CRC (index included) is then put together with
+ * crc32c_combine, without reading the files again.
+ */
+Status encode_secret_file_archive(EncodeInfo *encInfo)
+{
+    // Large payloads are read and written behind the embedding
+    encode_start_async(encInfo);
+    ArchiveInfo *archive = encInfo->archive;
+    int bits = encode_lsb_bits(encInfo);
+    size_t chunk = encode_chunk_size(encInfo) / 8 * bits;
+    uint64_t first = encInfo->carrier_pos;
+    char *stage = malloc(chunk);
+    unsigned char *index = malloc(archive->index_size);
+    Status ret = (stage != NULL && index != NULL) ? e_success : e_failure;
+    size_t fill = 0;
+    uint32_t data_crc = 0;
+
+    // Step 1: Index with placeholder checksums
+    if (ret == e_success)
+    {
+        archive_index_pack(archive, index);
+        ret = encode_staged(encInfo, stage, &fill, chunk, (const char *)index, archive->index_size, bits);
+    }
+
+    // Step 2: Every file, read through the staging buffer
+    for (uint32_t i = 0; ret == e_success && i < archive->entry_count; i++)
+    {
+        ArchiveEntry *entry = &archive->entries[i];
+        FILE *fptr = fopen(entry->fname, "rb");
+        if (fptr == NULL)
+        {
+            perror("fopen");
+            fprintf(stderr, "ERROR: Unable to open file %s\n", entry->fname);
+            ret = e_failure;
+            break;
+        }
+
+        entry->crc = 0;
+        for (uint64_t remaining = entry->size; ret == e_success && remaining > 0;)
+        {
+            size_t len = chunk - fill < remaining ? chunk - fill : (size_t)remaining;
+            if (fread(stage + fill, 1, len, fptr) != len)
+            {
+                fprintf(stderr, "ERROR: Unexpected end of file %s\n", entry->fname);
+                ret = e_failure;
+                break;
+            }
+            entry->crc = crc32c(entry->crc, stage + fill, len);
+            data_crc = crc32c(data_crc, stage + fill, len);
+            fill += len;
+            remaining -= len;
+            if (fill == chunk)
+            {
+                ret = encode_data_to_image_bits(stage, chunk, bits, encInfo);
+                fill = 0;
+            }
+        }
+        fclose(fptr);
+    }
+    if (ret == e_success && fill > 0)
+        ret = encode_data_to_image_bits(stage, fill, bits, encInfo);
+    encInfo->size_embedded = encInfo->size_secret_file;
+
+    // Step 3: Patch the index with the real checksums
+    if (ret == e_success)
+    {
+        archive_index_pack(archive, index);
+        ret = encode_patch_carriers(encInfo, first, (const char *)index, archive->index_size, bits);
+        encInfo->header.payload_crc = crc32c_combine(crc32c(0, index, archive->index_size), data_crc,
+                                                     archive->data_size);
+    }
+
+    free(stage);
+    free(index);
+    return ret;
+}
+
+/*
+ * Encode the secret in the keyed order of scatter.h (--key)
+ * The blocks land anywhere in the image, so the rest of the cover is
+ * copied first and each block is then patched in place: its file bytes
+ * are read from the cover with one pread, the groups it holds are
+ * permuted into payload order, embedded, put back and written with one
+ * pwrite. The secret is still read front to back, one block at a time.
+ */
+Status encode_secret_file_scatter(EncodeInfo *encInfo)
+{
+    const BmpInfo *bmp = &encInfo->bmp;
+    int bits = encode_lsb_bits(encInfo);
+    int contiguous = bmp_is_contiguous(bmp);
+    size_t carriers_len = (size_t)SCATTER_BLOCK_GROUPS * 8;
+    size_t span_len = carriers_len + (carriers_len / bmp->row_bytes + 2) * 3;
+    ScatterMap map = {0};
+
+    // Step 1: The cover tail goes out unchanged, the blocks are patched over it
+    if (scatter_map_init(&map, scatter_key_seed(encInfo->key), encInfo->carrier_pos, bmp->capacity) != e_success ||
+        encode_copy_tail(encInfo) != e_success ||
+        fflush(encInfo->fptr_stego_image) != 0)
+    {
+        free_scatter_map(&map);
+        return e_failure;
+    }
+
+    char *span = malloc(span_len);
+    char *carriers = contiguous ? NULL : malloc(carriers_len);
+    char *groups = malloc(carriers_len);
+    char *secret = malloc((size_t)SCATTER_BLOCK_GROUPS * bits);
+    uint32_t *perm = malloc(SCATTER_BLOCK_GROUPS * sizeof(uint32_t));
+    Status ret = (span != NULL && (contiguous || carriers != NULL) && groups != NULL && secret != NULL && perm != NULL)
+                     ? e_success
+                     : e_failure;
+
+    // Step 2: One logical block at a time, in payload order
+    uint64_t remaining = encInfo->size_secret_file;
+    fseeko(encInfo->fptr_secret, 0, SEEK_SET);
+    for (uint64_t block = 0; ret == e_success && remaining > 0; block++)
+    {
+        uint32_t n = scatter_block_groups(&map, block);
+        size_t bytes = remaining < (uint64_t)n * bits ? (size_t)remaining : (size_t)n * bits;
+        uint32_t used = (bytes + bits - 1) / bits;
+        uint64_t first = scatter_block_carrier(&map, block);
+        uint64_t start = bmp_carrier_offset(bmp, first);
+        size_t len = bmp_carrier_offset(bmp, first + (uint64_t)n * 8 - 1) + 1 - start;
+        off_t offset = bmp->data_offset + start;
+
+        if (fread(secret, 1, bytes, encInfo->fptr_secret) != bytes)
+        {
+            fprintf(stderr, "ERROR: Unexpected end of secret file %s\n", encInfo->secret_fname);
+            ret = e_failure;
+            break;
+        }
+        encInfo->header.payload_crc = crc32c(encInfo->header.payload_crc, secret, bytes);
+        if (encode_pread_cover(encInfo, span, len, offset) != e_success)
+        {
+            fprintf(stderr, "ERROR: Unexpected end of source image\n");
+            ret = e_failure;
+            break;
+        }
+
+        // Gather the block's groups into payload order, embed, put them back
+        char *block_carriers = contiguous ? span : carriers;
+        if (!contiguous)
+            bmp_gather(bmp, span, start, first, (uint64_t)n * 8, carriers);
+        scatter_block_perm(&map, block, perm, n);
+        scatter_gather_groups(groups, block_carriers, perm, used);
+        parallel_embed_bytes(encInfo->pool, groups, secret, bytes, bits);
+        scatter_put_groups(block_carriers, groups, perm, used);
+        if (!contiguous)
+            bmp_scatter(bmp, span, start, first, (uint64_t)n * 8, carriers);
+
+        if (pwrite(fileno(encInfo->fptr_stego_image), span, len, offset) != (ssize_t)len)
+        {
+            fprintf(stderr, "ERROR: Unable to write stego image\n");
+            ret = e_failure;
+            break;
+        }
+        remaining -= bytes;
+    }
+    encInfo->size_embedded = encInfo->size_secret_file;
+
+    free(span);
+    free(carriers);
+    free(groups);
+    free(secret);
+    free(perm);
+    free_scatter_map(&map);
+    return ret;
+}
+
+/*
+ * Store the CRC-32C of the secret, known only after the data pass
+ * In --stream mode it is embedded as a 32-bit field after the end
+ * marker. Otherwise the stego header, embedded before the data, is
+ * patched in place: its cover bytes are read back with pread, the
+ * header is re-embedded and written over the old one with pwrite, so
+ * neither stream position moves.
+ */
+Status encode_payload_crc(EncodeInfo *encInfo)
+{
+    int bits = encode_lsb_bits(encInfo);
+    unsigned char value[STREAM_FRAME_LEN_SIZE];
+    if (encInfo->stream)
+    {
+        for (int i = 0; i < STREAM_FRAME_LEN_SIZE; i++)
+            value[i] = encInfo->header.payload_crc >> (8 * i);
+        return encode_data_to_image_bits((const char *)value, STREAM_FRAME_LEN_SIZE, bits, encInfo);
+    }
+
+    unsigned char packed[STEG_HEADER_SIZE];
+    steg_header_pack(&encInfo->header, packed);
+    return encode_patch_carriers(encInfo, strlen(MAGIC_STRING_V2) * 8, (const char *)packed, STEG_HEADER_SIZE, 1);
+}
+
+/*
+ * Encode the payload in the form the options ask for. The pipeline
+ * ends with it, so its I/O is counted in the data stage (after a
+ * failure close_files takes it down).
+ */
+static Status encode_secret_payload(EncodeInfo *encInfo)
+{
+    Status ret = encInfo->archive != NULL ? encode_secret_file_archive(encInfo)
+                 : encInfo->compress      ? encode_secret_file_compressed(encInfo)
+                 : encInfo->key != NULL   ? encode_secret_file_scatter(encInfo)
+                                          : encode_secret_file_data(encInfo);
+    if (ret == e_success && encode_finish_async(encInfo) != e_success)
+        ret = e_failure;
+    return ret;
+}
+
 /*
  * Encode a single byte into the LSBs of 8 image bytes
  */
@@ -324,110 +1332,195 @@ Status encode_size_to_lsb(int size, char *imageBuffer)
  ******************************************************************************/
 Status do_encoding(EncodeInfo *encInfo)
 {
-    printf("\n========================================\n");
-    printf(" 🔐 Starting Encoding Process\n");
-    printf("========================================\n\n");
+    STEP_PRINT(encInfo, "\n========================================\n");
+    STEP_PRINT(encInfo, " 🔐 Starting Encoding Process\n");
+    STEP_PRINT(encInfo, "========================================\n\n");
 
     // Step 1: Open files
-    if (open_files(encInfo) == e_success)
+    if (STATS_STAGE(encInfo->stats, "open", open_files(encInfo)) == e_success)
     {
-        printf("-> Step 1: Opened required files successfully.\n");
+        STEP_PRINT(encInfo, "-> Step 1: Opened required files successfully.\n");
 
         // Step 2: Check capacity
-        if (check_capacity(encInfo) == e_success)
+        if (STATS_STAGE(encInfo->stats, "capacity", check_capacity(encInfo)) == e_success)
         {
-            printf("-> Step 2: Source image has sufficient capacity.\n");
+            STEP_PRINT(encInfo, "-> Step 2: Source image has sufficient capacity.\n");
 
             // Step 3: Copy BMP header
-            if (copy_bmp_header(encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_success)
+            if (STATS_STAGE(encInfo->stats, "header_copy", encode_copy_header(encInfo)) == e_success)
             {
-                printf("-> Step 3: BMP header copied successfully.\n");
+                STEP_PRINT(encInfo, "-> Step 3: BMP header copied successfully.\n");
 
                 // Step 4: Encode magic string
-                if (encode_magic_string(MAGIC_STRING, encInfo) == e_success)
+                if (STATS_STAGE(encInfo->stats, "magic", encode_magic_string(MAGIC_STRING_V2, encInfo)) == e_success)
                 {
-                    printf("-> Step 4: Magic string encoded successfully.\n");
+                    STEP_PRINT(encInfo, "-> Step 4: Magic string encoded successfully.\n");
 
-                    // Step 5: Encode secret file extension size
-                    if (encode_secret_file_extn_size(extn_size, encInfo) == e_success)
+                    // Step 5: Encode stego header (extension and 64-bit size)
+                    if (STATS_STAGE(encInfo->stats, "stego_header", encode_stego_header(encInfo)) == e_success)
                     {
-                        printf("-> Step 5: Secret file extension size encoded successfully.\n");
+                        if (encInfo->archive != NULL)
+                            STEP_PRINT(encInfo, "-> Step 5: Stego header (v%d, archive of %u files, %llu bytes, %d-bit LSB) encoded successfully.\n",
+                                   STEG_VERSION, encInfo->archive->entry_count,
+                                   (unsigned long long)encInfo->size_secret_file, encode_lsb_bits(encInfo));
+                        else
+                            STEP_PRINT(encInfo, "-> Step 5: Stego header (v%d, extension %s, %llu bytes, %d-bit LSB) encoded successfully.\n",
+                                   STEG_VERSION, encInfo->extn_secret_file,
+                                   (unsigned long long)encInfo->size_secret_file, encode_lsb_bits(encInfo));
 
-                        // Step 6: Encode secret file extension
-                        if (encode_secret_file_extn(encInfo->extn_secret_file, encInfo) == e_success)
+                        // Step 6: Encode secret file data (compressed with --compress, packed with --archive)
+                        if (STATS_STAGE(encInfo->stats, "data", encode_secret_payload(encInfo)) == e_success)
                         {
-                            printf("-> Step 6: Secret file extension encoded successfully.\n");
+                            if (encInfo->archive != NULL)
+                                STEP_PRINT(encInfo, "-> Step 6: Archive index (%u bytes) and %u files encoded successfully.\n",
+                                       encInfo->archive->index_size, encInfo->archive->entry_count);
+                            else if (encInfo->compress)
+                                STEP_PRINT(encInfo, "-> Step 6: Secret file data compressed to %llu bytes and encoded successfully.\n",
+                                       (unsigned long long)encInfo->size_embedded);
+                            else if (encInfo->key != NULL)
+                                STEP_PRINT(encInfo, "-> Step 6: Secret file data scattered in keyed order and encoded successfully.\n");
+                            else if (encInfo->password != NULL)
+                                STEP_PRINT(encInfo, "-> Step 6: Secret file data encrypted (ChaCha20) and encoded successfully.\n");
+                            else
+                                STEP_PRINT(encInfo, "-> Step 6: Secret file data encoded successfully.\n");
 
-                            // Step 7: Encode secret file size
-                            if (encode_secret_file_size(encInfo->size_secret_file, encInfo) == e_success)
+                            // Step 7: Copy remaining image data (--key copied it before patching the blocks)
+                            if (encInfo->key != NULL ||
+                                STATS_STAGE(encInfo->stats, "tail_copy", encode_copy_tail(encInfo)) == e_success)
                             {
-                                printf("-> Step 7: Secret file size encoded successfully.\n");
+                                STEP_PRINT(encInfo, "-> Step 7: Remaining image data copied successfully (%s).\n",
+                                       copy_method_name(encInfo->tail_copy_method));
 
-                                // Step 8: Encode secret file data
-                                if (encode_secret_file_data(encInfo) == e_success)
+                                // Step 8: Store the payload checksum in the stego header
+                                if (STATS_STAGE(encInfo->stats, "checksum", encode_payload_crc(encInfo)) == e_success)
                                 {
-                                    printf("-> Step 8: Secret file data encoded successfully.\n");
-
-                                    // Step 9: Copy remaining image data
-                                    if (copy_remaining_img_data(encInfo->fptr_src_image,
-                                                                encInfo->fptr_stego_image) == e_success)
-                                    {
-                                        printf("-> Step 9: Remaining image data copied successfully.\n");
-                                        return e_success;
-                                    }
-                                    else
-                                    {
-                                        printf("❌ ERROR: Copying remaining image data failed!\n");
-                                        return e_failure;
-                                    }
+                                    STEP_PRINT(encInfo, "-> Step 8: Payload checksum (CRC-32C 0x%08x) stored successfully.\n",
+                                           encInfo->header.payload_crc);
+                                    return e_success;
                                 }
                                 else
                                 {
-                                    printf("❌ ERROR: Encoding secret file data failed!\n");
+                                    STEP_PRINT(encInfo, "❌ ERROR: Storing payload checksum failed!\n");
                                     return e_failure;
                                 }
                             }
                             else
                             {
-                                printf("❌ ERROR: Encoding secret file size failed!\n");
+                                STEP_PRINT(encInfo, "❌ ERROR: Copying remaining image data failed!\n");
                                 return e_failure;
                             }
                         }
                         else
                         {
-                            printf("❌ ERROR: Encoding secret file extension failed!\n");
+                            STEP_PRINT(encInfo, "❌ ERROR: Encoding secret file data failed!\n");
                             return e_failure;
                         }
                     }
                     else
                     {
-                        printf("❌ ERROR: Encoding secret file extension size failed!\n");
+                        STEP_PRINT(encInfo, "❌ ERROR: Encoding stego header failed!\n");
                         return e_failure;
                     }
                 }
                 else
                 {
-                    printf("❌ ERROR: Encoding magic string failed!\n");
+                    STEP_PRINT(encInfo, "❌ ERROR: Encoding magic string failed!\n");
                     return e_failure;
                 }
             }
             else
             {
-                printf("❌ ERROR: Copying BMP header failed!\n");
+                STEP_PRINT(encInfo, "❌ ERROR: Copying BMP header failed!\n");
                 return e_failure;
             }
         }
         else
         {
-            printf("❌ ERROR: Source image does not have enough capacity to encode data.\n");
+            STEP_PRINT(encInfo, "❌ ERROR: Source image does not have enough capacity to encode data.\n");
             return e_failure;
         }
     }
     else
     {
-        printf("❌ ERROR: Opening files failed!\n");
+        STEP_PRINT(encInfo, "❌ ERROR: Opening files failed!\n");
         return e_failure;
     }
 
     return e_failure;
 }
+
+/******************************************************************************
+ * Function: do_stream_encoding
+ * Description:
+ *   Same steps as do_encoding for --stream mode: the cover, secret and
+ *   output are read or written front to back once, so stdin, stdout and
+ *   pipes work, and the secret is embedded as frames because its size
+ *   is not known up front.
+ ******************************************************************************/
+Status do_stream_encoding(EncodeInfo *encInfo)
+{
+    STEP_PRINT(encInfo, "\n========================================\n");
+    STEP_PRINT(encInfo, " 🔐 Starting Streaming Encoding Process\n");
+    STEP_PRINT(encInfo, "========================================\n\n");
+
+    // Step 1: Open files (or stdin/stdout)
+    if (STATS_STAGE(encInfo->stats, "open", open_files(encInfo)) != e_success)
+    {
+        STEP_PRINT(encInfo, "❌ ERROR: Opening files failed!\n");
+        return e_failure;
+    }
+    STEP_PRINT(encInfo, "-> Step 1: Opened required streams successfully.\n");
+
+    // Step 2: Pass the BMP header through while parsing it
+    encInfo->carrier_pos = encInfo->pixel_pos = 0;
+    if (STATS_STAGE(encInfo->stats, "header_copy",
+                    stream_copy_bmp_header(encInfo->fptr_src_image, encInfo->fptr_stego_image,
+                                           &encInfo->bmp)) != e_success)
+    {
+        STEP_PRINT(encInfo, "❌ ERROR: %s is not an uncompressed 24/32-bit BMP!\n", encInfo->src_image_fname);
+        return e_failure;
+    }
+    encInfo->image_capacity = encInfo->bmp.capacity;
+    STEP_PRINT(encInfo, "-> Step 2: BMP header copied successfully.\n");
+
+    // The extension is optional: a pipe usually has none
+    char *extn = strrchr(encInfo->secret_fname, '.');
+    encInfo->extn_secret_file[0] = '\0';
+    if (extn != NULL && strchr(extn, '/') == NULL && strlen(extn) < sizeof(encInfo->extn_secret_file))
+        strcpy(encInfo->extn_secret_file, extn);
+
+    // Step 3: Magic string and stego header (size 0, STEG_FLAG_STREAM)
+    encInfo->size_secret_file = 0;
+    if (STATS_STAGE(encInfo->stats, "magic", encode_magic_string(MAGIC_STRING_V2, encInfo)) != e_success ||
+        STATS_STAGE(encInfo->stats, "stego_header", encode_stego_header(encInfo)) != e_success)
+    {
+        STEP_PRINT(encInfo, "❌ ERROR: Encoding stego header failed!\n");
+        return e_failure;
+    }
+    STEP_PRINT(encInfo, "-> Step 3: Magic string and stream header encoded successfully.\n");
+
+    // Step 4: Secret frames (compressed with --compress)
+    if (STATS_STAGE(encInfo->stats, "data",
+                    encInfo->compress ? encode_secret_file_compressed(encInfo)
+                                      : encode_secret_file_stream(encInfo)) != e_success)
+    {
+        STEP_PRINT(encInfo, "❌ ERROR: Encoding secret stream failed!\n");
+        return e_failure;
+    }
+    STEP_PRINT(encInfo, "-> Step 4: Secret stream (%llu bytes, %llu embedded, CRC-32C 0x%08x) encoded successfully.\n",
+               (unsigned long long)encInfo->size_secret_file, (unsigned long long)encInfo->size_embedded,
+               encInfo->header.payload_crc);
+
+    // Step 5: Rest of the cover
+    if (STATS_STAGE(encInfo->stats, "tail_copy",
+                    copy_remaining_img_data(encInfo->fptr_src_image, encInfo->fptr_stego_image,
+                                            &encInfo->tail_copy_method)) != e_success ||
+        fflush(encInfo->fptr_stego_image) != 0)
+    {
+        STEP_PRINT(encInfo, "❌ ERROR: Copying remaining image data failed!\n");
+        return e_failure;
+    }
+    STEP_PRINT(encInfo, "-> Step 5: Remaining image data copied successfully (%s).\n",
+               copy_method_name(encInfo->tail_copy_method));
+    return e_success;
+}
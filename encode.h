@@ -1,8 +1,36 @@
 #ifndef ENCODE_H
 #define ENCODE_H
 #include <stdio.h>
-
-#include "types.h" // Contains user defined types
+#include <stdint.h>
+
+#include "types.h"  // Contains user defined types
+#include "header.h" // Versioned stego header
+#include "parallel.h" // Thread pool for -j
+#include "bmp.h"    // BMP header parser
+#include "stats.h"  // Per-stage timings
+#include "stream.h" // stdin/stdout streaming
+#include "archive.h" // Multi-file archives
+#include "shard.h"   // Secrets split over several covers
+#include "scatter.h" // Keyed payload order
+#include "cipher.h"  // ChaCha20 payload encryption
+#include "cache.h"   // Parsed covers kept in memory
+#include "iopipe.h"  // Asynchronous read/embed/write pipeline
+
+/* Default number of pixel bytes read, embedded and written per block */
+#define ENCODE_CHUNK_SIZE (1024 * 1024)
+
+/* Smallest payload, in blocks, that starts the asynchronous pipeline */
+#define ENCODE_ASYNC_MIN_BLOCKS 4
+
+/* Path taken to copy the image data after the payload */
+typedef enum
+{
+    e_copy_none,
+    e_copy_file_range,
+    e_copy_sendfile,
+    e_copy_buffered,
+    e_copy_cache
+} CopyMethod;
 
 /*
  * Structure to store information required for
@@ -16,18 +44,51 @@ typedef struct _EncodeInfo
     /* Source Image info */
     char *src_image_fname; // To store the src image name
     FILE *fptr_src_image;  // To store the address of the src image
-    uint image_capacity;   // To store the size of image
+    uint64_t image_capacity; // To store the size of image (carrier bytes)
+    BmpInfo bmp;             // Parsed BMP headers of the source image
+    CoverCache *cover_cache; // Covers kept in memory (--batch, --serve), NULL otherwise
+    const CoverEntry *cover; // Cached copy of this cover, NULL when read from the file
 
     /* Secret File Info */
     char *secret_fname;       // To store the secret file name
     FILE *fptr_secret;        // To store the secret file address
     char extn_secret_file[5]; // To store the Secret file extension
-    char secret_data[100000];    // To store the secret data
-    long size_secret_file;    // To store the size of the secret data
+    uint64_t size_secret_file; // To store the size of the secret data
+    uint64_t size_embedded;    // Payload bytes embedded (frames included)
 
     /* Stego Image Info */
     char *stego_image_fname; // To store the dest file name
     FILE *fptr_stego_image;  // To store the address of stego image
+    CopyMethod tail_copy_method; // Path used to copy the remaining image data
+
+    /* Stego header written after the magic string */
+    StegHeader header;
+
+    /* Block buffer */
+    size_t chunk_size;  // Carrier bytes per block (0 = ENCODE_CHUNK_SIZE)
+    char *image_buffer; // Reused file block buffer
+    size_t block_size;  // Size of image_buffer
+    char *carrier_buffer; // Carrier bytes gathered from a padded block
+    uint64_t carrier_pos; // Next carrier byte to embed into
+    uint64_t pixel_pos;   // Next unread byte of the pixel array
+    IoPipe *iopipe;       // Reads ahead / writes behind the block being embedded, NULL when off
+    int sync_io;          // --sync-io: read, embed and write one block at a time
+    int async_io;         // --async-io: use the pipeline even on a single CPU
+    int io_thread;        // Use the I/O thread even where io_uring works (benchmark)
+
+    /* Parallel embedding (-j) */
+    int threads;        // Threads requested (0 or 1 = single-threaded)
+    ThreadPool *pool;   // Worker pool, NULL when single-threaded
+
+    int quiet;          // Suppress step messages (batch jobs)
+    int lsb_bits;       // --lsb: payload bits per carrier byte (0 = 1)
+    int stream;         // --stream: no seeks, framed payload of unknown size
+    int compress;       // --compress: LZ-compress the payload (STEG_FLAG_LZ)
+    ArchiveInfo *archive; // --archive: files packed behind an index, NULL otherwise
+    const ShardRecord *shard; // --shard: slice of the secret for this cover, NULL otherwise
+    const char *key;    // --key: scatter the payload in a keyed order, NULL otherwise
+    const char *password; // --password: encrypt the payload with ChaCha20, NULL otherwise
+    StegStats *stats;   // Per-stage timings (--stats), NULL when off
 
 } EncodeInfo;
 
@@ -39,44 +100,68 @@ Status read_and_validate_encode_args(char *argv[], EncodeInfo *encInfo);
 /* Perform the encoding */
 Status do_encoding(EncodeInfo *encInfo);
 
+/* Encoding in --stream mode (stdin/stdout, secret of unknown size) */
+Status do_stream_encoding(EncodeInfo *encInfo);
+
 /* Get File pointers for i/p and o/p files */
 Status open_files(EncodeInfo *encInfo);
 
+/* Close files and release buffers */
+void close_files(EncodeInfo *encInfo);
+
 /* check capacity */
 Status check_capacity(EncodeInfo *encInfo);
 
 /* Get image size */
-uint get_image_size_for_bmp(FILE *fptr_image);
+uint64_t get_image_size_for_bmp(FILE *fptr_image);
 
 /* Get file size */
-uint get_file_size(FILE *fptr);
+uint64_t get_file_size(FILE *fptr);
 
-/* Copy bmp image header */
-Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image);
+/* Copy bmp image header (everything before the pixel array) */
+Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image, uint32_t header_size);
 
 /* Store Magic String */
 Status encode_magic_string(const char *magic_string, EncodeInfo *encInfo);
 
-/*Encode extension size*/
-Status encode_secret_file_extn_size(int size, EncodeInfo *encInfo);
-
-/* Encode secret file extenstion */
-Status encode_secret_file_extn(const char *file_extn, EncodeInfo *encInfo);
-
-/* Encode secret file size */
-Status encode_secret_file_size(long file_size, EncodeInfo *encInfo);
+/* Encode versioned stego header (extension, 64-bit size, checksum) */
+Status encode_stego_header(EncodeInfo *encInfo);
 
 /* Encode secret file data*/
 Status encode_secret_file_data(EncodeInfo *encInfo);
 
+/* Encode secret file data as length-prefixed frames (--stream) */
+Status encode_secret_file_stream(EncodeInfo *encInfo);
+
+/* Encode secret file data as LZ-compressed frames (--compress) */
+Status encode_secret_file_compressed(EncodeInfo *encInfo);
+
+/* Encode the archive index and every packed file as one payload (--archive) */
+Status encode_secret_file_archive(EncodeInfo *encInfo);
+
+/* Encode secret file data in the keyed, block-shuffled order (--key) */
+Status encode_secret_file_scatter(EncodeInfo *encInfo);
+
+/* Store the payload CRC-32C (header patch, or trailer field in --stream mode) */
+Status encode_payload_crc(EncodeInfo *encInfo);
+
+/* Encode a block of data into the image, one chunk at a time */
+Status encode_data_to_image(const char *data, size_t size, EncodeInfo *encInfo);
+
+/* Same with bits payload bits per carrier byte (k-LSB) */
+Status encode_data_to_image_bits(const char *data, size_t size, int bits, EncodeInfo *encInfo);
+
 /* Encode a byte into LSB of image data array */
 Status encode_byte_to_lsb(char data, char *image_buffer);
 
-// Encode a size to lsb
+// Encode a size to lsb (32-bit fields of the original layout)
 Status encode_size_to_lsb(int size, char *imageBuffer);
 
 /* Copy remaining image bytes from src to stego image after encoding */
-Status copy_remaining_img_data(FILE *fptr_src, FILE *fptr_dest);
+Status copy_remaining_img_data(FILE *fptr_src, FILE *fptr_dest, CopyMethod *method);
+
+/* Name of the tail copy path for reporting */
+const char *copy_method_name(CopyMethod method);
 
 Status validate_file_extension(const char *filename, char *valid_extns[], int extn_count);
 
@@ -0,0 +1,61 @@
+#include <string.h>
+#include "header.h"
+#include "checksum.h"
+
+/*
+ * Little-endian store/load helpers
+ */
+static void put_le(unsigned char *p, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        p[i] = value >> (8 * i);
+}
+
+static uint64_t get_le(const unsigned char *p, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= (uint64_t)p[i] << (8 * i);
+    return value;
+}
+
+/*
+ * Serialize the header into its on-image byte layout
+ */
+void steg_header_pack(const StegHeader *header, unsigned char out[STEG_HEADER_SIZE])
+{
+    memset(out, 0, STEG_HEADER_SIZE);
+    out[0] = header->version;
+    out[1] = header->flags;
+    out[2] = header->lsb_bits;
+    out[3] = header->extn_len;
+    memcpy(out + 4, header->extn, header->extn_len);
+    put_le(out + 12, header->payload_size, 8);
+    put_le(out + 20, header->payload_crc, 4);
+    put_le(out + 24, header->key_check, 4);
+    put_le(out + 28, crc32c(0, out, 28), 4);
+}
+
+/*
+ * Parse the on-image byte layout and validate it
+ */
+Status steg_header_unpack(const unsigned char in[STEG_HEADER_SIZE], StegHeader *header)
+{
+    // Reject corrupted headers before trusting any field
+    if (get_le(in + 28, 4) != crc32c(0, in, 28))
+        return e_failure;
+
+    header->version = in[0];
+    header->flags = in[1];
+    header->lsb_bits = in[2];
+    header->extn_len = in[3];
+    if (header->version != STEG_VERSION || header->extn_len > STEG_MAX_EXTN)
+        return e_failure;
+
+    memcpy(header->extn, in + 4, header->extn_len);
+    header->extn[header->extn_len] = '\0';
+    header->payload_size = get_le(in + 12, 8);
+    header->payload_crc = get_le(in + 20, 4);
+    header->key_check = get_le(in + 24, 4);
+    return e_success;
+}
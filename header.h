@@ -0,0 +1,77 @@
+#ifndef HEADER_H
+#define HEADER_H
+
+#include <stdint.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * Versioned stego header
+ * ----------------------
+ * Written right after MAGIC_STRING_V2, one bit per pixel byte.
+ * All fields are little-endian on the image:
+ *
+ *   offset size field
+ *   0      1    version       (STEG_VERSION)
+ *   1      1    flags         (STEG_FLAG_*)
+ *   2      1    lsb_bits      (bits per pixel byte in the payload region)
+ *   3      1    extn_len      (length of extn, including the '.')
+ *   4      8    extn          (secret file extension, not NUL terminated)
+ *   12     8    payload_size  (64-bit secret size in bytes)
+ *   20     4    payload_crc   (CRC-32C of the secret, with STEG_FLAG_CRC)
+ *   24     4    key_check     (recognises the --key, with STEG_FLAG_SCATTER)
+ *   28     4    header_crc    (CRC-32C of bytes 0..27)
+ */
+
+#define STEG_VERSION 2
+#define STEG_HEADER_SIZE 32
+#define STEG_MAX_EXTN 8
+
+/* Payload is a sequence of length-prefixed frames (see stream.h) */
+#define STEG_FLAG_STREAM 0x01
+
+/* Payload frames hold LZ-compressed blocks (see lz.h) */
+#define STEG_FLAG_LZ 0x02
+
+/*
+ * payload_crc holds the CRC-32C of the secret as decoded. The header is
+ * patched with it after the data pass; a --stream image cannot be
+ * patched, so there the CRC follows the end marker as a 32-bit field.
+ */
+#define STEG_FLAG_CRC 0x04
+
+/* Payload is an index followed by several files (see archive.h) */
+#define STEG_FLAG_ARCHIVE 0x08
+
+/* Payload is a shard record followed by one slice of a secret (see shard.h) */
+#define STEG_FLAG_SHARD 0x10
+
+/* Payload groups are spread over the image in a keyed order (see scatter.h) */
+#define STEG_FLAG_SCATTER 0x20
+
+/* Payload is a cipher head followed by the ChaCha20 ciphertext (see
+   cipher.h); payload_crc covers both, not the plaintext */
+#define STEG_FLAG_CIPHER 0x40
+
+/* Flags this version understands */
+#define STEG_FLAGS_KNOWN (STEG_FLAG_STREAM | STEG_FLAG_LZ | STEG_FLAG_CRC | STEG_FLAG_ARCHIVE | STEG_FLAG_SHARD | \
+                          STEG_FLAG_SCATTER | STEG_FLAG_CIPHER)
+
+typedef struct _StegHeader
+{
+    uint8_t version;
+    uint8_t flags;
+    uint8_t lsb_bits;
+    uint8_t extn_len;
+    char extn[STEG_MAX_EXTN + 1]; // NUL terminated copy of the extension
+    uint64_t payload_size;
+    uint32_t payload_crc;
+    uint32_t key_check;
+} StegHeader;
+
+/* Serialize a header (computes header_crc) */
+void steg_header_pack(const StegHeader *header, unsigned char out[STEG_HEADER_SIZE]);
+
+/* Parse a header, checking version and header_crc */
+Status steg_header_unpack(const unsigned char in[STEG_HEADER_SIZE], StegHeader *header);
+
+#endif
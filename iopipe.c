@@ -0,0 +1,476 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "iopipe.h"
+#include "stats.h"
+
+const char *iopipe_engine_name(IoEngine engine)
+{
+    return engine == e_io_uring ? "io_uring" : "I/O thread";
+}
+
+/*
+ * pread/pwrite until len bytes have moved (-1 on error or end of file)
+ */
+static ssize_t io_full(int fd, int write, char *buf, size_t len, off_t offset)
+{
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t n = write ? pwrite(fd, buf + done, len - done, offset + done)
+                          : pread(fd, buf + done, len - done, offset + done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return n < 0 ? -errno : -EIO;
+        done += n;
+    }
+    return done;
+}
+
+/*-------- io_uring engine (raw system calls) --------*/
+
+static int uring_enter(IoUring *ring, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static Status uring_setup(IoUring *ring)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = syscall(__NR_io_uring_setup, IOPIPE_RING_ENTRIES, &p);
+    if (ring->fd < 0)
+        return e_failure;
+
+    // Step 1: Map the submission and completion rings (one mapping on 5.4+)
+    ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        ring->sq_size = ring->cq_size = ring->sq_size > ring->cq_size ? ring->sq_size : ring->cq_size;
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_SQ_RING);
+    ring->cq_ptr = ring->sq_ptr;
+    if (ring->sq_ptr != MAP_FAILED && !(p.features & IORING_FEAT_SINGLE_MMAP))
+        ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                            IORING_OFF_CQ_RING);
+
+    // Step 2: Map the submission entries
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = MAP_FAILED;
+    if (ring->sq_ptr != MAP_FAILED && ring->cq_ptr != MAP_FAILED)
+        ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                          IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        if (ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr)
+            munmap(ring->cq_ptr, ring->cq_size);
+        if (ring->sq_ptr != MAP_FAILED)
+            munmap(ring->sq_ptr, ring->sq_size);
+        close(ring->fd);
+        return e_failure;
+    }
+
+    char *sq = ring->sq_ptr, *cq = ring->cq_ptr;
+    ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return e_success;
+}
+
+static void uring_teardown(IoUring *ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ptr != ring->sq_ptr)
+        munmap(ring->cq_ptr, ring->cq_size);
+    munmap(ring->sq_ptr, ring->sq_size);
+    close(ring->fd);
+}
+
+/*
+ * Queue one READV/WRITEV (5.1+) and hand every queued entry to the
+ * kernel; entries it did not take are handed over again on the next call.
+ * Fails when io_uring_enter does.
+ */
+static Status uring_submit(IoUring *ring, IoRequest *req)
+{
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = req->write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = req->fd;
+    sqe->addr = (uint64_t)(uintptr_t)&req->iov;
+    sqe->len = 1;
+    sqe->off = req->offset;
+    sqe->user_data = (uint64_t)(uintptr_t)req;
+    ring->sq_array[index] = index;
+    req->seq = tail;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    unsigned pending = tail + 1 - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    int ret;
+    while ((ret = uring_enter(ring, pending, 0, 0)) < 0 && errno == EINTR)
+        ;
+    return ret < 0 ? e_failure : e_success;
+}
+
+/*
+ * Mark every completion posted so far (never blocks)
+ */
+static void uring_reap(IoUring *ring)
+{
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail)
+        return;
+
+    double now = stats_now();
+    for (; head != tail; head++)
+    {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        IoRequest *req = (IoRequest *)(uintptr_t)cqe->user_data;
+        req->result = cqe->res;
+        req->completed = now;
+        req->done = 1;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/*
+ * Block until req completes; fails, with req still pending, when
+ * io_uring_enter does
+ */
+static Status uring_wait(IoUring *ring, IoRequest *req)
+{
+    uring_reap(ring);
+    while (!req->done)
+    {
+        unsigned pending = *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (uring_enter(ring, pending, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+            return e_failure;
+        uring_reap(ring);
+    }
+    return e_success;
+}
+
+/*-------- I/O thread engine --------*/
+
+static void *io_thread_main(void *arg)
+{
+    IoThread *worker = arg;
+
+    pthread_mutex_lock(&worker->lock);
+    for (;;)
+    {
+        while (worker->head == worker->tail && !worker->stopping)
+            pthread_cond_wait(&worker->work, &worker->lock);
+        if (worker->head == worker->tail)
+            break;
+        IoRequest *req = worker->queue[worker->head++ % IOPIPE_RING_ENTRIES];
+        pthread_mutex_unlock(&worker->lock);
+
+        ssize_t result = io_full(req->fd, req->write, req->iov.iov_base, req->iov.iov_len, req->offset);
+
+        pthread_mutex_lock(&worker->lock);
+        req->result = result;
+        req->completed = stats_now();
+        req->done = 1;
+        pthread_cond_broadcast(&worker->done);
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return NULL;
+}
+
+static Status io_thread_start(IoThread *worker)
+{
+    memset(worker, 0, sizeof(*worker));
+    pthread_mutex_init(&worker->lock, NULL);
+    pthread_cond_init(&worker->work, NULL);
+    pthread_cond_init(&worker->done, NULL);
+    if (pthread_create(&worker->thread, NULL, io_thread_main, worker) == 0)
+        return e_success;
+    pthread_mutex_destroy(&worker->lock);
+    pthread_cond_destroy(&worker->work);
+    pthread_cond_destroy(&worker->done);
+    return e_failure;
+}
+
+static void io_thread_stop(IoThread *worker)
+{
+    pthread_mutex_lock(&worker->lock);
+    worker->stopping = 1;
+    pthread_cond_signal(&worker->work);
+    pthread_mutex_unlock(&worker->lock);
+    pthread_join(worker->thread, NULL);
+    pthread_mutex_destroy(&worker->lock);
+    pthread_cond_destroy(&worker->work);
+    pthread_cond_destroy(&worker->done);
+}
+
+/*-------- Pipe --------*/
+
+/*
+ * The ring stopped working: fail the pipe, take back the entries the
+ * kernel has not consumed (it only reads them inside io_uring_enter, so
+ * they can never run) and wait for those it has. If that wait fails too
+ * the requests are stranded and their buffers must outlive the pipe.
+ */
+static void iopipe_uring_abort(IoPipe *io)
+{
+    IoUring *ring = &io->ring;
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned queued = *ring->sq_tail - head;
+
+    io->failed = 1;
+    for (int i = 0; i < IOPIPE_DEPTH; i++)
+    {
+        IoRequest *req = &io->requests[i];
+        if (req->busy && !req->done && req->seq - head < queued)
+        {
+            req->result = -ECANCELED;
+            req->completed = stats_now();
+            req->done = 1;
+        }
+    }
+    __atomic_store_n(ring->sq_tail, head, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < IOPIPE_DEPTH; i++)
+    {
+        IoRequest *req = &io->requests[i];
+        while (req->busy && !req->done)
+        {
+            if (uring_enter(ring, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+            {
+                io->stranded = 1;
+                return;
+            }
+            uring_reap(ring);
+        }
+    }
+}
+
+static void iopipe_submit(IoPipe *io, IoRequest *req, int fd, int write, char *buf, size_t len, off_t offset)
+{
+    req->fd = fd;
+    req->write = write;
+    req->iov.iov_base = buf;
+    req->iov.iov_len = len;
+    req->offset = offset;
+    req->busy = 1;
+    req->done = 0;
+    req->result = 0;
+    req->submitted = stats_now();
+
+    if (io->engine == e_io_uring)
+    {
+        if (uring_submit(&io->ring, req) != e_success)
+            iopipe_uring_abort(io);
+        return;
+    }
+    pthread_mutex_lock(&io->worker.lock);
+    io->worker.queue[io->worker.tail++ % IOPIPE_RING_ENTRIES] = req;
+    pthread_cond_signal(&io->worker.work);
+    pthread_mutex_unlock(&io->worker.lock);
+}
+
+/*
+ * Wait for a request and count it; a short or failed request is
+ * finished with pread/pwrite, and only fails if that fails too. Once
+ * the ring has failed nothing is finished behind its back.
+ */
+static Status iopipe_wait(IoPipe *io, IoRequest *req)
+{
+    if (!req->busy)
+        return e_success;
+
+    double start = stats_now();
+    if (io->engine == e_io_uring)
+    {
+        if (uring_wait(&io->ring, req) != e_success)
+            iopipe_uring_abort(io);
+    }
+    else
+    {
+        pthread_mutex_lock(&io->worker.lock);
+        while (!req->done)
+            pthread_cond_wait(&io->worker.done, &io->worker.lock);
+        pthread_mutex_unlock(&io->worker.lock);
+    }
+    io->wait_seconds += stats_now() - start;
+    if (!req->done)
+        return e_failure; // Stranded in the kernel
+    io->io_seconds += req->completed - req->submitted;
+    req->busy = 0;
+    if (req->write)
+        io->writes++;
+    else
+        io->reads++;
+
+    size_t done = req->result > 0 ? (size_t)req->result : 0;
+    if (io->engine == e_io_uring)
+        *(req->write ? &io->ring_written : &io->ring_read) += done;
+    if (done < req->iov.iov_len &&
+        (io->failed || io_full(req->fd, req->write, (char *)req->iov.iov_base + done, req->iov.iov_len - done,
+                req->offset + done) < 0))
+    {
+        io->failed = 1;
+        return e_failure;
+    }
+    return e_success;
+}
+
+/*
+ * Read the block_size cover bytes at read_pos into buffer b, after the
+ * room kept for carried bytes, never past the end of the cover
+ */
+static void iopipe_prefetch(IoPipe *io, unsigned b)
+{
+    off_t offset = io->read_pos;
+    if (offset >= io->in_size)
+        return;
+    size_t len = io->in_size - offset < (off_t)io->block_size ? (size_t)(io->in_size - offset) : io->block_size;
+    iopipe_submit(io, &io->requests[b], io->fd_in, 0, io->buffers[b] + IOPIPE_CARRY, len, offset);
+    io->read_pos = offset + len;
+}
+
+Status iopipe_open(IoPipe *io, int fd_in, int fd_out, off_t in_size, off_t pos, size_t block_size,
+                   int force_thread)
+{
+    memset(io, 0, sizeof(*io));
+    io->fd_in = fd_in;
+    io->fd_out = fd_out;
+    io->in_size = in_size;
+    io->pos = io->read_pos = pos;
+    io->block_size = block_size;
+
+    for (int i = 0; i < IOPIPE_DEPTH; i++)
+    {
+        io->buffers[i] = malloc(IOPIPE_CARRY + block_size);
+        if (io->buffers[i] == NULL)
+        {
+            for (int j = 0; j < i; j++)
+                free(io->buffers[j]);
+            return e_failure;
+        }
+    }
+
+    // io_uring when the kernel allows it (it may be missing, disabled by
+    // sysctl or blocked by seccomp), else the I/O thread
+    if (!force_thread && uring_setup(&io->ring) == e_success)
+        io->engine = e_io_uring;
+    else if (io_thread_start(&io->worker) == e_success)
+        io->engine = e_io_thread;
+    else
+    {
+        for (int i = 0; i < IOPIPE_DEPTH; i++)
+            free(io->buffers[i]);
+        return e_failure;
+    }
+
+    if (fd_in >= 0)
+        iopipe_prefetch(io, 0);
+    return e_success;
+}
+
+/*
+ * Hand out block k: its read was issued with block k-1, so usually it
+ * is already done, and the bytes block k-1 left over were copied in
+ * front of it. Then block k+1 is read into the buffer whose write
+ * (block k-2) is the oldest in flight.
+ */
+char *iopipe_next(IoPipe *io)
+{
+    unsigned b = io->block % IOPIPE_DEPTH;
+    IoRequest *req = &io->requests[b];
+    if (io->failed || iopipe_wait(io, req) != e_success)
+        return NULL;
+
+    size_t room = io->in_size - io->pos < (off_t)io->block_size ? (size_t)(io->in_size - io->pos) : io->block_size;
+    if (io->fd_in < 0)
+    {
+        io->data = io->buffers[b] + IOPIPE_CARRY;
+        io->len = room;
+    }
+    else if (!req->write && req->offset == io->pos + (off_t)io->carry && io->carry <= IOPIPE_CARRY)
+    {
+        io->data = io->buffers[b] + IOPIPE_CARRY - io->carry;
+        io->len = io->carry + req->iov.iov_len;
+    }
+    else
+    {
+        // Not what was prefetched (more left over than fits): read it now
+        io->data = io->buffers[b] + IOPIPE_CARRY;
+        io->len = room;
+        io->read_pos = io->pos + room;
+        if (io_full(io->fd_in, 0, io->data, room, io->pos) < 0)
+        {
+            io->failed = 1;
+            return NULL;
+        }
+    }
+
+    if (io->fd_in >= 0)
+    {
+        unsigned next = (io->block + 1) % IOPIPE_DEPTH;
+        if (iopipe_wait(io, &io->requests[next]) != e_success)
+            return NULL;
+        iopipe_prefetch(io, next);
+    }
+
+    // Note completions at every block boundary for the overlap figures
+    if (io->engine == e_io_uring)
+        uring_reap(&io->ring);
+    return io->data;
+}
+
+Status iopipe_put(IoPipe *io, size_t used)
+{
+    unsigned b = io->block % IOPIPE_DEPTH;
+    if (io->failed || io->data == NULL || used > io->len)
+        return e_failure;
+    if (used > 0)
+        iopipe_submit(io, &io->requests[b], io->fd_out, 1, io->data, used, io->pos);
+
+    // The next buffer only has its read in flight, after the carry room
+    io->carry = io->len - used;
+    if (io->fd_in >= 0 && io->carry <= IOPIPE_CARRY)
+        memcpy(io->buffers[(io->block + 1) % IOPIPE_DEPTH] + IOPIPE_CARRY - io->carry, io->data + used, io->carry);
+    io->pos += used;
+    io->data = NULL;
+    io->block++;
+    return io->failed ? e_failure : e_success;
+}
+
+Status iopipe_close(IoPipe *io)
+{
+    Status ret = io->failed ? e_failure : e_success;
+    for (int i = 0; i < IOPIPE_DEPTH; i++)
+    {
+        IoRequest *req = &io->requests[i];
+        // A read nobody asked for is not an error
+        if (iopipe_wait(io, req) != e_success && req->write)
+            ret = e_failure;
+    }
+
+    if (io->engine == e_io_uring)
+        uring_teardown(&io->ring);
+    else
+        io_thread_stop(&io->worker);
+    if (io->stranded)
+        return e_failure; // The kernel may still write into the buffers
+    for (int i = 0; i < IOPIPE_DEPTH; i++)
+        free(io->buffers[i]);
+    return ret;
+}
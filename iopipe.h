@@ -0,0 +1,160 @@
+#ifndef IOPIPE_H
+#define IOPIPE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * Asynchronous block pipeline
+ * ---------------------------
+ * The encoder reads a block of the cover, embeds into it and writes it
+ * to the same offset of the stego image, block after block. The pipe
+ * keeps the I/O of the neighbouring blocks in flight while one block is
+ * embedded, with three rotating buffers:
+ *
+ *   block k-1  write to the stego image in flight
+ *   block k    handed to the encoder (iopipe_next ... iopipe_put)
+ *   block k+1  read of the cover in flight
+ *
+ * A block is the block_size bytes of the cover that follow the previous
+ * one. The encoder embeds into it for as long as its carriers fit, then
+ * puts the bytes it used; the few it did not (at most IOPIPE_CARRY, less
+ * than one group of carriers) are carried to the front of the next
+ * block, whose read started at the end of this one. Blocks therefore
+ * follow the payload, not the calls that embed it: short fields share
+ * the block of the data around them.
+ *
+ * Requests go through io_uring (raw system calls, no liburing) when the
+ * kernel allows it, or else to one I/O thread doing pread/pwrite. Both
+ * use explicit offsets, so the stdio streams of the two files must be
+ * flushed before iopipe_open and repositioned after iopipe_close. A
+ * short or failed request is completed with pread/pwrite before it is
+ * reported as an error.
+ *
+ * If io_uring_enter itself fails, the pipe fails for good: entries the
+ * kernel has not consumed are taken back from the submission ring, the
+ * ones it has are waited for, and no request is ever finished with
+ * pread/pwrite while its entry may still run. Should even that wait
+ * fail, the buffers are left allocated rather than freed under the
+ * kernel.
+ *
+ * Overlap is measured per request: io_seconds adds up the time from
+ * submission to completion (as seen at the next block boundary or
+ * wait), wait_seconds the time the encoder was blocked on requests.
+ * What was not waited for was hidden behind the embedding.
+ */
+
+/* Buffers in rotation: one read, one embedded, one written */
+#define IOPIPE_DEPTH 3
+
+/* Submission ring size (at most IOPIPE_DEPTH requests are in flight) */
+#define IOPIPE_RING_ENTRIES 8
+
+/* Unused bytes at the end of a block that move to the next one */
+#define IOPIPE_CARRY 64
+
+typedef enum
+{
+    e_io_uring,
+    e_io_thread
+} IoEngine;
+
+typedef struct _IoRequest
+{
+    int fd;            // File the request reads or writes
+    int write;         // 1 = write, 0 = read
+    struct iovec iov;  // Buffer and length
+    off_t offset;      // File offset
+    int busy;          // Submitted and not yet waited for
+    int done;          // Completed (result is valid)
+    ssize_t result;    // Bytes moved, or -errno
+    double submitted;  // Time of submission
+    double completed;  // Time the completion was seen
+    unsigned seq;      // Submission ring position (io_uring)
+} IoRequest;
+
+typedef struct _IoUring
+{
+    int fd;                          // io_uring instance
+    void *sq_ptr, *cq_ptr;           // Mapped rings (the same with a single mmap)
+    size_t sq_size, cq_size;         // Sizes of the mappings
+    struct io_uring_sqe *sqes;       // Submission queue entries
+    size_t sqes_size;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+} IoUring;
+
+typedef struct _IoThread
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work;             // Signalled when a request is queued
+    pthread_cond_t done;             // Signalled when a request completes
+    IoRequest *queue[IOPIPE_RING_ENTRIES];
+    unsigned head, tail;             // Queued requests are queue[head..tail)
+    int stopping;
+} IoThread;
+
+typedef struct _IoPipe
+{
+    IoEngine engine;
+    IoUring ring;                    // e_io_uring
+    IoThread worker;                 // e_io_thread
+
+    int fd_in;                       // Cover (-1: the caller fills the blocks)
+    int fd_out;                      // Stego image
+    off_t in_size;                   // Blocks never go past the end of the cover
+    size_t block_size;               // Cover bytes read per block
+    char *buffers[IOPIPE_DEPTH];     // IOPIPE_CARRY + block_size bytes each
+    IoRequest requests[IOPIPE_DEPTH]; // Request of each buffer
+    unsigned block;                  // Blocks handed out so far
+    off_t read_pos;                  // Offset of the next read
+
+    /* Block handed out by iopipe_next, until iopipe_put */
+    char *data;                      // Cover bytes from offset pos, NULL when none
+    size_t len;                      // Bytes valid at data
+    off_t pos;                       // File offset of data[0]
+    size_t carry;                    // Bytes the last put left for the next block
+
+    int failed;                      // A request failed for good
+    int stranded;                    // Requests may still run in the kernel
+
+    /* Overlap counters */
+    uint64_t reads, writes;          // Requests completed
+    uint64_t ring_read, ring_written; // Bytes moved by io_uring itself
+    double io_seconds;               // Submission to completion, all requests
+    double wait_seconds;             // Time blocked waiting for requests
+} IoPipe;
+
+/*
+ * Start a pipe at offset pos of both files, for a cover of in_size
+ * bytes read block_size bytes at a time; the first read is issued here.
+ * io_uring is tried first unless force_thread is set.
+ */
+Status iopipe_open(IoPipe *io, int fd_in, int fd_out, off_t in_size, off_t pos, size_t block_size,
+                   int force_thread);
+
+/*
+ * Next block: io->len bytes of the cover from io->pos, the bytes carried
+ * over included (fewer at the end of the cover). With fd_in -1 the
+ * caller fills them. NULL on failure.
+ */
+char *iopipe_next(IoPipe *io);
+
+/* Write the first used bytes of the block to the stego image and carry
+   the rest to the next block */
+Status iopipe_put(IoPipe *io, size_t used);
+
+/* Wait for every request, release the pipe; fails if any write failed */
+Status iopipe_close(IoPipe *io);
+
+/* Name of the engine in use */
+const char *iopipe_engine_name(IoEngine engine);
+
+#endif
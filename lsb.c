@@ -0,0 +1,379 @@
+#include <stdint.h>
+#include <string.h>
+#include "lsb.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LSB_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * Portable scalar kernels
+ */
+static void embed_scalar(char *image_buffer, const char *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        unsigned char byte = data[i];
+        char *pixel = image_buffer + i * 8;
+        for (int bit = 0; bit < 8; bit++)
+            pixel[bit] = (pixel[bit] & ~1) | ((byte >> bit) & 1);
+    }
+}
+
+static void extract_scalar(char *data, const char *image_buffer, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        const char *pixel = image_buffer + i * 8;
+        unsigned char byte = 0;
+        for (int bit = 0; bit < 8; bit++)
+            byte |= (pixel[bit] & 1) << bit;
+        data[i] = byte;
+    }
+}
+
+#ifdef LSB_X86
+
+/*
+ * SSE2 kernels: 16 payload bytes (128 image bytes) per iteration
+ * Payload bytes are widened with unpack instructions until each byte
+ * fills 8 lanes, then compared against the per-lane bit mask.
+ */
+__attribute__((target("sse2")))
+static inline __m128i sse2_merge(__m128i pixels, __m128i spread, __m128i mask)
+{
+    __m128i bits = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(spread, mask), mask), _mm_set1_epi8(1));
+    return _mm_or_si128(_mm_and_si128(pixels, _mm_set1_epi8((char)0xFE)), bits);
+}
+
+__attribute__((target("sse2")))
+static void embed_sse2(char *image_buffer, const char *data, size_t size)
+{
+    const __m128i mask = _mm_set_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                      (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i spread[8];
+
+        // Widen 16 bytes -> 8 vectors holding 2 bytes repeated 8 times each
+        __m128i lo = _mm_unpacklo_epi8(x, x);
+        __m128i hi = _mm_unpackhi_epi8(x, x);
+        __m128i w0 = _mm_unpacklo_epi16(lo, lo);
+        __m128i w1 = _mm_unpackhi_epi16(lo, lo);
+        __m128i w2 = _mm_unpacklo_epi16(hi, hi);
+        __m128i w3 = _mm_unpackhi_epi16(hi, hi);
+        spread[0] = _mm_unpacklo_epi32(w0, w0);
+        spread[1] = _mm_unpackhi_epi32(w0, w0);
+        spread[2] = _mm_unpacklo_epi32(w1, w1);
+        spread[3] = _mm_unpackhi_epi32(w1, w1);
+        spread[4] = _mm_unpacklo_epi32(w2, w2);
+        spread[5] = _mm_unpackhi_epi32(w2, w2);
+        spread[6] = _mm_unpacklo_epi32(w3, w3);
+        spread[7] = _mm_unpackhi_epi32(w3, w3);
+
+        for (int k = 0; k < 8; k++)
+        {
+            __m128i *pixel = (__m128i *)(image_buffer + i * 8 + k * 16);
+            _mm_storeu_si128(pixel, sse2_merge(_mm_loadu_si128(pixel), spread[k], mask));
+        }
+    }
+    embed_scalar(image_buffer + i * 8, data + i, size - i);
+}
+
+__attribute__((target("sse2")))
+static void extract_sse2(char *data, const char *image_buffer, size_t size)
+{
+    size_t i = 0;
+    for (; i + 2 <= size; i += 2)
+    {
+        // Move every LSB into the sign bit, then collect 16 of them
+        __m128i pixel = _mm_loadu_si128((const __m128i *)(image_buffer + i * 8));
+        uint16_t bits = _mm_movemask_epi8(_mm_slli_epi16(pixel, 7));
+        memcpy(data + i, &bits, 2);
+    }
+    extract_scalar(data + i, image_buffer + i * 8, size - i);
+}
+
+/*
+ * AVX2 kernels: 32 payload bytes (256 image bytes) per iteration
+ * Each group of 4 payload bytes is broadcast and shuffled so that
+ * every byte covers 8 lanes of a 256-bit vector.
+ */
+__attribute__((target("avx2")))
+static void embed_avx2(char *image_buffer, const char *data, size_t size)
+{
+    const __m256i mask = _mm256_set1_epi64x(0x8040201008040201LL);
+    const __m256i shuffle = _mm256_set_epi64x(0x0303030303030303LL, 0x0202020202020202LL,
+                                              0x0101010101010101LL, 0x0000000000000000LL);
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i clear = _mm256_set1_epi8((char)0xFE);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        for (int k = 0; k < 8; k++)
+        {
+            int32_t group;
+            memcpy(&group, data + i + k * 4, 4);
+            __m256i spread = _mm256_shuffle_epi8(_mm256_set1_epi32(group), shuffle);
+            __m256i bits = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(spread, mask), mask), one);
+
+            __m256i *pixel = (__m256i *)(image_buffer + (i + k * 4) * 8);
+            __m256i merged = _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256(pixel), clear), bits);
+            _mm256_storeu_si256(pixel, merged);
+        }
+    }
+    embed_sse2(image_buffer + i * 8, data + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static void extract_avx2(char *data, const char *image_buffer, size_t size)
+{
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        __m256i pixel = _mm256_loadu_si256((const __m256i *)(image_buffer + i * 8));
+        uint32_t bits = _mm256_movemask_epi8(_mm256_slli_epi16(pixel, 7));
+        memcpy(data + i, &bits, 4);
+    }
+    extract_sse2(data + i, image_buffer + i * 8, size - i);
+}
+
+#endif /* LSB_X86 */
+
+/*
+ * Runtime CPU feature checks
+ */
+int lsb_kernel_supported(LsbKernel kernel)
+{
+    switch (kernel)
+    {
+    case e_lsb_scalar:
+        return 1;
+#ifdef LSB_X86
+    case e_lsb_sse2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case e_lsb_avx2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return 0;
+    }
+}
+
+LsbKernel lsb_best_kernel(void)
+{
+    if (lsb_kernel_supported(e_lsb_avx2))
+        return e_lsb_avx2;
+    if (lsb_kernel_supported(e_lsb_sse2))
+        return e_lsb_sse2;
+    return e_lsb_scalar;
+}
+
+const char *lsb_kernel_name(LsbKernel kernel)
+{
+    switch (kernel)
+    {
+    case e_lsb_sse2:
+        return "sse2";
+    case e_lsb_avx2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+void lsb_embed_bytes_with(LsbKernel kernel, char *image_buffer, const char *data, size_t size)
+{
+    switch (kernel)
+    {
+#ifdef LSB_X86
+    case e_lsb_avx2:
+        embed_avx2(image_buffer, data, size);
+        break;
+    case e_lsb_sse2:
+        embed_sse2(image_buffer, data, size);
+        break;
+#endif
+    default:
+        embed_scalar(image_buffer, data, size);
+        break;
+    }
+}
+
+void lsb_extract_bytes_with(LsbKernel kernel, char *data, const char *image_buffer, size_t size)
+{
+    switch (kernel)
+    {
+#ifdef LSB_X86
+    case e_lsb_avx2:
+        extract_avx2(data, image_buffer, size);
+        break;
+    case e_lsb_sse2:
+        extract_sse2(data, image_buffer, size);
+        break;
+#endif
+    default:
+        extract_scalar(data, image_buffer, size);
+        break;
+    }
+}
+
+void lsb_embed_bytes(char *image_buffer, const char *data, size_t size)
+{
+    lsb_embed_bytes_with(lsb_best_kernel(), image_buffer, data, size);
+}
+
+void lsb_extract_bytes(char *data, const char *image_buffer, size_t size)
+{
+    lsb_extract_bytes_with(lsb_best_kernel(), data, image_buffer, size);
+}
+
+/*
+ * k-LSB kernels
+ * A group of bits payload bytes, read as one little-endian value, is
+ * spread over 8 carriers: carrier i holds value bits [i * bits, i * bits + bits).
+ * With bits = 1 this is exactly the one byte per 8 carriers layout above.
+ * The callers pass a constant bits so each case is compiled separately.
+ */
+size_t lsb_carriers(size_t size, int bits)
+{
+    return (size * 8 + bits - 1) / bits;
+}
+
+/* Byte with the low bits bits set in each of the 8 lanes */
+#define LSB_LANES(bits) (0x0101010101010101ULL * ((1u << (bits)) - 1))
+
+/*
+ * Spread the 8 * bits low bits of x into the low bits of 8 byte lanes
+ * (lane i gets bits [i * bits, i * bits + bits)), halving the field
+ * width at each step, and the reverse
+ */
+static inline uint64_t spread_group(uint64_t x, const int bits)
+{
+    x = (x | x << (32 - 4 * bits)) & (0x0000000100000001ULL * ((1ULL << (4 * bits)) - 1));
+    x = (x | x << (16 - 2 * bits)) & (0x0001000100010001ULL * ((1ULL << (2 * bits)) - 1));
+    x = (x | x << (8 - bits)) & LSB_LANES(bits);
+    return x;
+}
+
+static inline uint64_t gather_group(uint64_t x, const int bits)
+{
+    x &= LSB_LANES(bits);
+    x = (x | x >> (8 - bits)) & (0x0001000100010001ULL * ((1ULL << (2 * bits)) - 1));
+    x = (x | x >> (16 - 2 * bits)) & (0x0000000100000001ULL * ((1ULL << (4 * bits)) - 1));
+    x = (x | x >> (32 - 4 * bits)) & ((1ULL << (8 * bits)) - 1);
+    return x;
+}
+
+static inline __attribute__((always_inline)) void embed_groups(char *image_buffer, const char *data,
+                                                               size_t size, const int bits)
+{
+    const unsigned mask = (1u << bits) - 1;
+    size_t done = 0;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Whole groups: 8 carriers are handled as one 64-bit word (the
+    // payload is read 8 bytes at a time while that stays in bounds)
+    for (; done + bits <= size; done += bits, image_buffer += 8)
+    {
+        uint64_t value = 0, pixels;
+        if (done + 8 <= size)
+        {
+            memcpy(&value, data + done, 8);
+            value &= (1ULL << (8 * bits)) - 1;
+        }
+        else
+        {
+            for (int j = 0; j < bits; j++)
+                value |= (uint64_t)(unsigned char)data[done + j] << (8 * j);
+        }
+        memcpy(&pixels, image_buffer, 8);
+        pixels = (pixels & ~LSB_LANES(bits)) | spread_group(value, bits);
+        memcpy(image_buffer, &pixels, 8);
+    }
+#endif
+
+    for (; done < size; done += bits, image_buffer += 8)
+    {
+        size_t n = size - done < (size_t)bits ? size - done : (size_t)bits;
+        uint32_t value = 0;
+        for (size_t j = 0; j < n; j++)
+            value |= (uint32_t)(unsigned char)data[done + j] << (8 * j);
+
+        // A short last group only uses the carriers its bits need
+        size_t carriers = n == (size_t)bits ? 8 : (n * 8 + bits - 1) / bits;
+        for (size_t i = 0; i < carriers; i++)
+            image_buffer[i] = (image_buffer[i] & ~mask) | ((value >> (i * bits)) & mask);
+    }
+}
+
+static inline __attribute__((always_inline)) void extract_groups(char *data, const char *image_buffer,
+                                                                 size_t size, const int bits)
+{
+    const unsigned mask = (1u << bits) - 1;
+    size_t done = 0;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; done + bits <= size; done += bits, image_buffer += 8)
+    {
+        uint64_t pixels;
+        memcpy(&pixels, image_buffer, 8);
+        uint64_t value = gather_group(pixels, bits);
+        memcpy(data + done, &value, bits);
+    }
+#endif
+
+    for (; done < size; done += bits, image_buffer += 8)
+    {
+        size_t n = size - done < (size_t)bits ? size - done : (size_t)bits;
+        size_t carriers = n == (size_t)bits ? 8 : (n * 8 + bits - 1) / bits;
+        uint32_t value = 0;
+        for (size_t i = 0; i < carriers; i++)
+            value |= (uint32_t)(image_buffer[i] & mask) << (i * bits);
+        for (size_t j = 0; j < n; j++)
+            data[done + j] = value >> (8 * j);
+    }
+}
+
+void lsb_embed_bits(char *image_buffer, const char *data, size_t size, int bits)
+{
+    switch (bits)
+    {
+    case 2:
+        embed_groups(image_buffer, data, size, 2);
+        break;
+    case 3:
+        embed_groups(image_buffer, data, size, 3);
+        break;
+    case 4:
+        embed_groups(image_buffer, data, size, 4);
+        break;
+    default:
+        lsb_embed_bytes(image_buffer, data, size);
+        break;
+    }
+}
+
+void lsb_extract_bits(char *data, const char *image_buffer, size_t size, int bits)
+{
+    switch (bits)
+    {
+    case 2:
+        extract_groups(data, image_buffer, size, 2);
+        break;
+    case 3:
+        extract_groups(data, image_buffer, size, 3);
+        break;
+    case 4:
+        extract_groups(data, image_buffer, size, 4);
+        break;
+    default:
+        lsb_extract_bytes(data, image_buffer, size);
+        break;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef LSB_H
+#define LSB_H
+
+#include <stddef.h>
+
+/*
+ * Bulk LSB kernels
+ * Each payload byte is spread over 8 consecutive image bytes, bit i of
+ * the payload byte going into the LSB of image byte i (the same layout
+ * as encode_byte_to_lsb / decode_byte_from_lsb).
+ */
+
+/* Kernel implementations available for dispatch */
+typedef enum
+{
+    e_lsb_scalar,
+    e_lsb_sse2,
+    e_lsb_avx2,
+    e_lsb_kernel_count
+} LsbKernel;
+
+/* Best kernel supported by the running CPU */
+LsbKernel lsb_best_kernel(void);
+
+/* Check whether the running CPU supports a kernel */
+int lsb_kernel_supported(LsbKernel kernel);
+
+/* Printable name of a kernel */
+const char *lsb_kernel_name(LsbKernel kernel);
+
+/* Embed size payload bytes into size * 8 image bytes */
+void lsb_embed_bytes(char *image_buffer, const char *data, size_t size);
+
+/* Extract size payload bytes from size * 8 image bytes */
+void lsb_extract_bytes(char *data, const char *image_buffer, size_t size);
+
+/*
+ * k-LSB: every group of bits payload bytes goes into 8 carriers, bits
+ * per carrier (bits = 1..4; 1 is the layout above). A short last group
+ * only touches lsb_carriers() of them.
+ */
+#define LSB_MAX_BITS 4
+
+/* Carriers needed for size payload bytes at bits per carrier */
+size_t lsb_carriers(size_t size, int bits);
+
+void lsb_embed_bits(char *image_buffer, const char *data, size_t size, int bits);
+void lsb_extract_bits(char *data, const char *image_buffer, size_t size, int bits);
+
+/* Same as above with an explicit kernel (used by the benchmark) */
+void lsb_embed_bytes_with(LsbKernel kernel, char *image_buffer, const char *data, size_t size);
+void lsb_extract_bytes_with(LsbKernel kernel, char *data, const char *image_buffer, size_t size);
+
+#endif
@@ -0,0 +1,243 @@
+#include <stdint.h>
+#include <string.h>
+#include "lz.h"
+
+/* Hash table size of the match finder (entries of 16-bit positions) */
+#define LZ_HASH_BITS 14
+
+/* Misses after which the match finder starts skipping ahead faster */
+#define LZ_SKIP_TRIGGER 6
+
+/* Chunk size of the decoder's over-copying loops */
+#define LZ_WILD_COPY 16
+
+static uint32_t lz_read32(const unsigned char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t lz_hash(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/*
+ * Number of equal bytes at a and b, stopping at end (b < end)
+ */
+static size_t lz_match_length(const unsigned char *a, const unsigned char *b, const unsigned char *end)
+{
+    const unsigned char *start = b;
+    while (b + 8 <= end)
+    {
+        uint64_t x, y;
+        memcpy(&x, a, 8);
+        memcpy(&y, b, 8);
+        if (x != y)
+            return b - start + (__builtin_ctzll(x ^ y) >> 3);
+        a += 8;
+        b += 8;
+    }
+    while (b < end && *a == *b)
+    {
+        a++;
+        b++;
+    }
+    return b - start;
+}
+
+/*
+ * Write a length continuation (255, 255, ..., remainder)
+ */
+static unsigned char *lz_put_length(unsigned char *op, size_t len)
+{
+    while (len >= 255)
+    {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+/*
+ * Emit one sequence: literals [anchor, anchor + lit) then a match of
+ * match_len bytes at offset (match_len 0 = last sequence, literals only)
+ * Returns NULL when dst has no room left
+ */
+static unsigned char *lz_put_sequence(unsigned char *op, unsigned char *oend, const unsigned char *anchor,
+                                      size_t lit, size_t offset, size_t match_len)
+{
+    // Worst case: token, both continuations, literals and the offset
+    if ((size_t)(oend - op) < 1 + lit / 255 + 1 + lit + 2 + match_len / 255 + 1)
+        return NULL;
+
+    unsigned char *token = op++;
+    *token = (lit < 15 ? lit : 15) << 4;
+    if (lit >= 15)
+        op = lz_put_length(op, lit - 15);
+    memcpy(op, anchor, lit);
+    op += lit;
+
+    if (match_len == 0)
+        return op;
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    match_len -= LZ_MIN_MATCH;
+    *token |= match_len < 15 ? match_len : 15;
+    if (match_len >= 15)
+        op = lz_put_length(op, match_len - 15);
+    return op;
+}
+
+/*
+ * Compress one block with a greedy single-probe match finder: every
+ * position's 4-byte prefix is looked up in a table holding the last
+ * position with the same hash. Long runs of misses (incompressible
+ * data) make the scan step grow, so such blocks cost little before
+ * being stored raw.
+ */
+size_t lz_compress(const unsigned char *src, size_t len, unsigned char *dst, size_t dst_cap)
+{
+    uint16_t table[1 << LZ_HASH_BITS];
+    const unsigned char *ip = src, *anchor = src, *end = src + len;
+    unsigned char *op = dst, *oend = dst + dst_cap;
+    size_t misses = 1 << LZ_SKIP_TRIGGER;
+
+    if (len > LZ_BLOCK_SIZE)
+        return 0;
+    memset(table, 0, sizeof(table));
+
+    while (len >= LZ_MIN_MATCH && ip + LZ_MIN_MATCH <= end)
+    {
+        uint32_t seq = lz_read32(ip);
+        uint32_t h = lz_hash(seq);
+        const unsigned char *match = src + table[h];
+        table[h] = ip - src;
+        if (match >= ip || lz_read32(match) != seq)
+        {
+            ip += misses++ >> LZ_SKIP_TRIGGER;
+            continue;
+        }
+
+        // Extend backwards over literals that also match, then forwards
+        while (ip > anchor && match > src && ip[-1] == match[-1])
+        {
+            ip--;
+            match--;
+        }
+        size_t match_len = LZ_MIN_MATCH + lz_match_length(match + LZ_MIN_MATCH, ip + LZ_MIN_MATCH, end);
+
+        op = lz_put_sequence(op, oend, anchor, ip - anchor, ip - match, match_len);
+        if (op == NULL)
+            return 0;
+        ip += match_len;
+        anchor = ip;
+        misses = 1 << LZ_SKIP_TRIGGER;
+
+        // Index a position inside the match so the next lookup has a fresh candidate
+        if (ip + 2 <= end)
+            table[lz_hash(lz_read32(ip - 2))] = ip - 2 - src;
+    }
+
+    // Last sequence: the remaining literals
+    op = lz_put_sequence(op, oend, anchor, end - anchor, 0, 0);
+    return op == NULL ? 0 : (size_t)(op - dst);
+}
+
+/*
+ * Copy len bytes in LZ_WILD_COPY chunks, writing up to LZ_WILD_COPY - 1
+ * bytes past dst + len (the caller checks there is room)
+ */
+static void lz_wild_copy(unsigned char *dst, const unsigned char *src, size_t len)
+{
+    for (size_t i = 0; i < len; i += LZ_WILD_COPY)
+        memcpy(dst + i, src + i, LZ_WILD_COPY);
+}
+
+/*
+ * Read a length continuation, failing past the end of the input
+ */
+static Status lz_get_length(const unsigned char **ip, const unsigned char *iend, size_t *len)
+{
+    unsigned char byte;
+    do
+    {
+        if (*ip >= iend)
+            return e_failure;
+        byte = *(*ip)++;
+        *len += byte;
+    } while (byte == 255);
+    return e_success;
+}
+
+/*
+ * Decompress one block; every length and offset is checked against
+ * both buffers, so a corrupted frame cannot read or write out of bounds
+ */
+Status lz_decompress(const unsigned char *src, size_t len, unsigned char *dst, size_t dst_cap, size_t *out_len)
+{
+    const unsigned char *ip = src, *iend = src + len;
+    unsigned char *op = dst, *oend = dst + dst_cap;
+
+    while (ip < iend)
+    {
+        // Literals
+        unsigned token = *ip++;
+        size_t lit = token >> 4;
+        if (lit < 15 && (size_t)(iend - ip) >= LZ_WILD_COPY + 2 && (size_t)(oend - op) >= 2 * LZ_WILD_COPY)
+        {
+            // Common case: one over-copy, and with at least 4 input bytes
+            // left after the literals this is not the last sequence
+            memcpy(op, ip, LZ_WILD_COPY);
+            op += lit;
+            ip += lit;
+        }
+        else
+        {
+            if (lit == 15 && lz_get_length(&ip, iend, &lit) != e_success)
+                return e_failure;
+            if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op))
+                return e_failure;
+            if (lit + LZ_WILD_COPY <= (size_t)(iend - ip) && lit + LZ_WILD_COPY <= (size_t)(oend - op))
+                lz_wild_copy(op, ip, lit);
+            else
+                memcpy(op, ip, lit);
+            op += lit;
+            ip += lit;
+            if (ip == iend)
+                break; // Last sequence
+        }
+
+        // Match
+        if (iend - ip < 2)
+            return e_failure;
+        size_t offset = ip[0] | ip[1] << 8;
+        ip += 2;
+        size_t match_len = token & 15;
+        if (match_len == 15 && lz_get_length(&ip, iend, &match_len) != e_success)
+            return e_failure;
+        match_len += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - dst) || match_len > (size_t)(oend - op))
+            return e_failure;
+
+        // Chunked copies no longer than the distance also handle
+        // overlapping matches: every chunk reads bytes already written
+        const unsigned char *match = op - offset;
+        if (offset >= LZ_WILD_COPY && match_len + LZ_WILD_COPY <= (size_t)(oend - op))
+            lz_wild_copy(op, match, match_len);
+        else if (offset >= 8 && match_len + 8 <= (size_t)(oend - op))
+            for (size_t i = 0; i < match_len; i += 8)
+                memcpy(op + i, match + i, 8);
+        else if (offset >= match_len)
+            memcpy(op, match, match_len);
+        else
+            for (size_t i = 0; i < match_len; i++)
+                op[i] = match[i]; // Short-distance runs
+        op += match_len;
+    }
+
+    *out_len = op - dst;
+    return e_success;
+}
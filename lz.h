@@ -0,0 +1,37 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <stddef.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * Payload compression (--compress)
+ * --------------------------------
+ * A small LZ77 codec in the LZ4 block style: each sequence is a token
+ * (4-bit literal count, 4-bit match length - LZ_MIN_MATCH), optional
+ * 255-continued length bytes, the literals, then a 16-bit little-endian
+ * offset back into the block. The last sequence has literals only.
+ *
+ * The secret is cut into blocks of LZ_BLOCK_SIZE bytes compressed on
+ * their own, so blocks can be packed in parallel and memory stays
+ * bounded. On the image they are stored as the frames of stream.h and
+ * the stego header carries STEG_FLAG_LZ. A block that does not shrink
+ * is stored as is, with LZ_FRAME_STORED set in its frame length.
+ */
+
+/* Uncompressed bytes per block (offsets are 16-bit) */
+#define LZ_BLOCK_SIZE (64 * 1024)
+
+/* Shortest match worth encoding */
+#define LZ_MIN_MATCH 4
+
+/* Frame length bit marking a block stored without compression */
+#define LZ_FRAME_STORED 0x80000000u
+
+/* Compress one block of at most LZ_BLOCK_SIZE bytes into dst; returns 0 if it does not fit dst_cap */
+size_t lz_compress(const unsigned char *src, size_t len, unsigned char *dst, size_t dst_cap);
+
+/* Decompress one block, failing on malformed input or more than dst_cap bytes of output */
+Status lz_decompress(const unsigned char *src, size_t len, unsigned char *dst, size_t dst_cap, size_t *out_len);
+
+#endif
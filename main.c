@@ -34,10 +34,8 @@ The system supports multiple file types (e.g .txt, .c, .h, .sh) and performs ful
 3. Check Capacity — Ensure image can hold the secret data.
 4. Copy BMP Header (first 54 bytes unchanged)
 5. Encode the following sequentially:
-   * Magic string (e.g., "#*")
-   * Secret file extension size
-   * Secret file extension (e.g., .txt)
-   * Secret file size
+   * Magic string (e.g., "#@")
+   * Versioned stego header (version, flags, extension, 64-bit size, CRC-32C)
    * Secret file data (actual contents)
 6. Copy Remaining Image Data after encoding.
 7. Output: Stego image ('destination.bmp') containing the hidden data.
@@ -46,11 +44,9 @@ The system supports multiple file types (e.g .txt, .c, .h, .sh) and performs ful
 
 1. Validate and Open Stego Image
 2. Skip BMP Header (54 bytes)
-3. Read and Verify Magic String
-4. Decode Extension Size
-5. Decode Extension Name
-6. Decode Secret File Size
-7. Extract Secret File Data and write to decoded file.
+3. Read and Verify Magic String ("#@" versioned header, "#*" original layout)
+4. Decode Header (extension and secret file size)
+5. Extract Secret File Data and write to decoded file.
 
 ⚠️ Error Handling
 
@@ -67,28 +63,294 @@ The system supports multiple file types (e.g .txt, .c, .h, .sh) and performs ful
 
 🧭 Command Format
 
-./a.out -e <source_image.bmp> <secret_file.txt> [output_image.bmp]
-./a.out -d <stego_image.bmp> [output_file_name]
+./a.out -e <source_image.bmp> <secret_file.txt> [output_image.bmp] [--chunk KB] [-j N] [--lsb K] [--compress] [--key password] [--password password] [--async-io | --sync-io] [--stats] [--stats-json file]
+./a.out -e <source_image.bmp> <file>... --archive <output_image.bmp> [--lsb K] [-j N]
+./a.out -d <stego_image.bmp> [output_file_name] [--mmap] [-j N] [--range offset:len] [--key password] [--password password] [--stats] [--stats-json file]
+./a.out -d <archive_image.bmp> [output_directory] [--list] [--extract name] [--mmap] [-j N]
+./a.out -e <secret_file.txt> <cover.bmp>... --shard <output_prefix> [--lsb K] [-j N]
+./a.out -d <shard.bmp>... --shard <output_file_name> [-j N]
+./a.out -e <- | source_image.bmp> <- | secret> [- | output_image.bmp] --stream [--compress]
+./a.out -d <- | stego_image.bmp> <- | output_file_name> --stream
+./a.out -b [payload_kb]
+./a.out -b --suite [max_mp] [--results file.csv] [-j N] [--mmap] [--key password] [--password password]
+./a.out --batch <manifest.txt> [-j N] [--inflight N] [--lsb K] [--compress] [--cache-mb MB]
+./a.out -p <image.bmp | directory>... [-j N]
+./a.out --serve <socket> [-j N] [--cache-mb MB]
+./a.out -e <source_image.bmp> <secret_file.txt> [output_image.bmp] --connect <socket> [--lsb K] [--compress] [--key password] [--password password]
+./a.out -d <stego_image.bmp> [output_file_name] --connect <socket> [--mmap] [--key password] [--password password]
 
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "encode.h"
 #include "types.h"
 #include "decode.h"
 #include "common.h"
+#include "bench.h"
+#include "batch.h"
+#include "probe.h"
+#include "shard.h"
+#include "serve.h"
 
 OperationType check_operation_type(char *);
+int extract_flag(int *argc, char *argv[], const char *flag);
+char *extract_option(int *argc, char *argv[], const char *option);
+void report_stats(const StegStats *stats, const char *operation, int show, const char *json_fname);
 
 int main(int argc, char *argv[])
 {
+    // Pull optional flags out of argv so positional arguments stay in place
+    int use_mmap = extract_flag(&argc, argv, "--mmap");
+    int suite = extract_flag(&argc, argv, "--suite");
+    int stream = extract_flag(&argc, argv, "--stream");
+    int compress = extract_flag(&argc, argv, "--compress");
+    int sync_io = extract_flag(&argc, argv, "--sync-io");
+    int async_io = extract_flag(&argc, argv, "--async-io");
+    char *results = extract_option(&argc, argv, "--results");
+    char *chunk_kb = extract_option(&argc, argv, "--chunk");
+    char *jobs = extract_option(&argc, argv, "-j");
+    char *inflight = extract_option(&argc, argv, "--inflight");
+    int show_stats = extract_flag(&argc, argv, "--stats");
+    char *stats_json = extract_option(&argc, argv, "--stats-json");
+    char *range = extract_option(&argc, argv, "--range");
+    char *archive = extract_option(&argc, argv, "--archive");
+    int archive_list = extract_flag(&argc, argv, "--list");
+    char *archive_extract = extract_option(&argc, argv, "--extract");
+    char *shard = extract_option(&argc, argv, "--shard");
+    char *key = extract_option(&argc, argv, "--key");
+    char *password = extract_option(&argc, argv, "--password");
+    char *connect = extract_option(&argc, argv, "--connect");
+    char *cache_mb = extract_option(&argc, argv, "--cache-mb");
+    int cover_cache_mb = COVER_CACHE_DEFAULT_MB;
+    if (cache_mb != NULL)
+    {
+        char *end;
+        long mb = strtol(cache_mb, &end, 10);
+        cover_cache_mb = (int)mb;
+        if (end == cache_mb || *end != '\0' || mb < 0 || mb > INT_MAX)
+            cover_cache_mb = -1; // Rejected by the batch and serve sections
+    }
+    char *lsb = extract_option(&argc, argv, "--lsb");
+    int lsb_bits = lsb != NULL ? atoi(lsb) : 0;
+    if (lsb != NULL && lsb_bits == 0)
+        lsb_bits = -1; // Rejected by the encode validator
+    int threads = jobs != NULL ? atoi(jobs) : 1;
+
+    // Per-stage timings are only collected when asked for
+    StegStats stats = {0};
+    StegStats *stats_ptr = (show_stats || stats_json != NULL) ? &stats : NULL;
+
+    // In --stream mode stdout may carry image or secret data
+    if (stream)
+        stream_redirect_console();
+
     printf("\n========================================\n");
     printf(" 🔐  Steganography using LSB Technique\n");
     printf("========================================\n\n");
 
-    // Step 1: Check for minimum argument count
-    if (argc >= 4)
+    /*------- BENCHMARK SECTION -------*/
+
+    if (argc >= 2 && check_operation_type(argv[1]) == e_bench)
+    {
+        printf("⏱️  Selected Benchmark Operation\n\n");
+
+        Status ret;
+        if (suite)
+        {
+            // Full encode/decode suite over synthetic covers
+            BenchOptions opts = {0};
+            opts.max_mp = BENCH_DEFAULT_MAX_MP;
+            opts.results_fname = BENCH_DEFAULT_RESULTS;
+            opts.threads = threads;
+            opts.use_mmap = use_mmap;
+            if (argc >= 3)
+                opts.max_mp = strtoul(argv[2], NULL, 10);
+            if (results != NULL)
+                opts.results_fname = results;
+            opts.key = key;
+            opts.password = password;
+            ret = run_bench_suite(&opts);
+        }
+        else
+        {
+            // Engine and kernel microbenchmarks
+            size_t payload_kb = BENCH_DEFAULT_PAYLOAD_KB;
+            if (argc >= 3)
+                payload_kb = strtoul(argv[2], NULL, 10);
+            ret = payload_kb > 0 && run_encode_benchmark(payload_kb) == e_success &&
+                          run_kernel_benchmark() == e_success &&
+                          run_library_benchmark(payload_kb) == e_success &&
+                          run_compression_benchmark(payload_kb) == e_success &&
+                          run_scatter_benchmark(payload_kb) == e_success &&
+                          run_cipher_benchmark(payload_kb) == e_success &&
+                          run_serve_benchmark(payload_kb) == e_success &&
+                          run_cache_benchmark(payload_kb) == e_success &&
+                          run_pipeline_benchmark(payload_kb) == e_success
+                      ? e_success
+                      : e_failure;
+        }
+
+        if (ret == e_success)
+            printf("\n✅ Benchmark completed successfully!\n");
+        else
+            printf("\n❌ ERROR: Benchmark failed.\n");
+    }
+
+    /*------- BATCH SECTION -------*/
+
+    else if (argc >= 3 && check_operation_type(argv[1]) == e_batch)
+    {
+        printf("📦 Selected Batch Operation\n\n");
+
+        BatchInfo batch_info = {0};
+        batch_info.manifest_fname = argv[2];
+        batch_info.threads = jobs != NULL ? threads : 0;
+        batch_info.max_inflight = inflight != NULL ? atoi(inflight) : 0;
+        batch_info.lsb_bits = lsb_bits;
+        batch_info.compress = compress;
+        batch_info.cache_mb = cover_cache_mb;
+
+        if (cover_cache_mb < 0)
+        {
+            printf("❌ ERROR: Invalid --cache-mb, expected a size in MB (0 turns the cache off).\n");
+        }
+        else if (read_batch_manifest(&batch_info) == e_success)
+        {
+            if (do_batch(&batch_info) == e_success)
+                printf("\n✅ Batch completed successfully!\n");
+            else
+                printf("\n❌ ERROR: Some batch jobs failed.\n");
+        }
+        else
+        {
+            printf("❌ ERROR: Invalid batch manifest.\n");
+        }
+        free_batch(&batch_info);
+    }
+
+    /*------- PROBE SECTION -------*/
+
+    else if (argc >= 3 && check_operation_type(argv[1]) == e_probe)
+    {
+        printf("🔍 Selected Probe Operation\n\n");
+
+        ProbeInfo probe_info = {0};
+        probe_info.paths = argv + 2;
+        probe_info.path_count = argc - 2;
+        probe_info.threads = jobs != NULL ? threads : 0;
+
+        if (read_probe_paths(&probe_info) == e_success)
+        {
+            if (do_probe(&probe_info) == e_success)
+                printf("\n✅ Probe completed successfully!\n");
+            else
+                printf("\n❌ ERROR: Some images could not be read.\n");
+        }
+        else
+        {
+            printf("❌ ERROR: No images to probe.\n");
+        }
+        free_probe(&probe_info);
+    }
+
+    /*------- SERVE SECTION -------*/
+
+    else if (argc >= 3 && check_operation_type(argv[1]) == e_serve)
+    {
+        printf("🛰️  Selected Daemon Operation\n\n");
+
+        ServeInfo serve_info = {0};
+        serve_info.socket_path = argv[2];
+        serve_info.threads = jobs != NULL ? threads : 0;
+        serve_info.cache_mb = cover_cache_mb;
+
+        if (cover_cache_mb < 0)
+            printf("❌ ERROR: Invalid --cache-mb, expected a size in MB (0 turns the cache off).\n");
+        else if (do_serve(&serve_info) == e_success)
+            printf("\n✅ Daemon stopped cleanly.\n");
+        else
+            printf("\n❌ ERROR: Unable to start the daemon.\n");
+    }
+
+    /*------- CONNECT SECTION -------*/
+
+    else if (connect != NULL && (argc >= 4 || (argc == 3 && check_operation_type(argv[1]) == e_decode)) &&
+             (check_operation_type(argv[1]) == e_encode || check_operation_type(argv[1]) == e_decode))
+    {
+        ServeInfo serve_info = {0};
+        serve_info.socket_path = connect;
+        serve_info.op = check_operation_type(argv[1]);
+        serve_info.lsb_bits = lsb_bits;
+        serve_info.compress = compress;
+        serve_info.use_mmap = use_mmap;
+        serve_info.key = key;
+        serve_info.password = password;
+
+        if (serve_info.op == e_encode)
+            printf("🔒 Selected Encoding Operation (daemon %s)\n\n", connect);
+        else
+            printf("🔓 Selected decoding operation (daemon %s).\n\n", connect);
+
+        // The daemon works on already open regular files, one payload each
+        if (stream || archive != NULL || range != NULL || shard != NULL)
+        {
+            printf("❌ ERROR: --connect cannot be combined with --stream, --archive, --range or --shard.\n");
+        }
+        else if (do_serve_client(&serve_info, argv) == e_success)
+        {
+            printf("\n✅ %s completed successfully!\n", serve_info.op == e_encode ? "Encoding" : "Decoding");
+            printf("📁 Output file generated: %s\n", serve_info.output_fname);
+        }
+        else
+        {
+            printf("\n❌ ERROR: %s failed.\n", serve_info.op == e_encode ? "Encoding" : "Decoding");
+        }
+    }
+
+    /*------- SHARD SECTION -------*/
+
+    else if (shard != NULL && argc >= 3 &&
+             (check_operation_type(argv[1]) == e_encode || check_operation_type(argv[1]) == e_decode))
+    {
+        ShardInfo shard_info = {0};
+        shard_info.op = check_operation_type(argv[1]);
+        shard_info.name = shard;
+        shard_info.lsb_bits = lsb_bits;
+        shard_info.threads = jobs != NULL ? threads : 0;
+
+        if (shard_info.op == e_encode)
+            printf("🔒 Selected Sharded Encoding Operation\n\n");
+        else
+            printf("🔓 Selected sharded decoding operation.\n\n");
+
+        // Every shard is a plain payload at a fixed size
+        if (stream || compress || archive != NULL || range != NULL || key != NULL || password != NULL)
+        {
+            printf("❌ ERROR: --shard cannot be combined with --stream, --compress, --archive, --range, --key or --password.\n");
+        }
+        else if (read_shard_args(argv, argc, &shard_info) == e_success)
+        {
+            Status ret = shard_info.op == e_encode ? do_shard_encoding(&shard_info) : do_shard_decoding(&shard_info);
+            if (ret == e_success && shard_info.op == e_encode)
+                printf("\n✅ Encoding completed successfully!\n📁 Output files generated: %s_1.bmp .. %s_%u.bmp\n",
+                       shard_info.name, shard_info.name, shard_info.file_count);
+            else if (ret == e_success)
+                printf("\n✅ Decoding completed successfully!\n📁 Output file generated: %s\n", shard_info.output_fname);
+            else
+                printf("\n❌ ERROR: %s failed.\n", shard_info.op == e_encode ? "Encoding" : "Decoding");
+        }
+        else
+        {
+            printf("❌ ERROR: Invalid shard arguments.\n");
+        }
+        free_shard(&shard_info);
+    }
+
+    // Step 1: Check for minimum argument count (the decode output name is optional)
+    else if (argc >= 4 || (argc == 3 && check_operation_type(argv[1]) == e_decode))
     {
         // Step 2: Check whether encode or decode
         OperationType op_type = check_operation_type(argv[1]);
@@ -100,7 +362,24 @@ int main(int argc, char *argv[])
             printf("🔒 Selected Encoding Operation\n\n");
 
             // Step 3: Declare structure variable EncodeInfo
-            EncodeInfo enc_info;
+            EncodeInfo enc_info = {0};
+            if (chunk_kb != NULL)
+                enc_info.chunk_size = strtoul(chunk_kb, NULL, 10) * 1024;
+            enc_info.threads = threads;
+            enc_info.stats = stats_ptr;
+            enc_info.stream = stream;
+            enc_info.lsb_bits = lsb_bits;
+            enc_info.compress = compress;
+            enc_info.key = key;
+            enc_info.password = password;
+            enc_info.sync_io = sync_io;
+            enc_info.async_io = async_io;
+            ArchiveInfo archive_info = {0};
+            if (archive != NULL)
+            {
+                enc_info.archive = &archive_info;
+                enc_info.stego_image_fname = archive;
+            }
 
             // Step 4: Validate and read encode arguments
             if (read_and_validate_encode_args(argv, &enc_info) == e_success)
@@ -108,7 +387,7 @@ int main(int argc, char *argv[])
                 printf("-> Encode arguments validated successfully.\n");
 
                 // Step 5: Call do_encoding
-                if (do_encoding(&enc_info) == e_success)
+                if ((stream ? do_stream_encoding(&enc_info) : do_encoding(&enc_info)) == e_success)
                 {
                     printf("\n✅ Encoding completed successfully!\n");
                     printf("📁 Output file generated: %s\n", enc_info.stego_image_fname);
@@ -117,11 +396,15 @@ int main(int argc, char *argv[])
                 {
                     printf("\n❌ ERROR: Encoding failed.\n");
                 }
+                close_files(&enc_info);
+                if (stats_ptr != NULL)
+                    report_stats(stats_ptr, "encode", show_stats, stats_json);
             }
             else
             {
                 printf("❌ ERROR: Invalid encode arguments.\n");
             }
+            free_archive(&archive_info);
         }
 
         /*------- DECODING SECTION -------*/
@@ -131,27 +414,39 @@ int main(int argc, char *argv[])
             printf("🔓 Selected decoding operation.\n\n");
 
             // Step 3: Declare structure variable DecodeInfo
-            DecodeInfo dec_info;
+            DecodeInfo dec_info = {0};
+            dec_info.use_mmap = use_mmap;
+            dec_info.threads = threads;
+            dec_info.stats = stats_ptr;
+            dec_info.stream = stream;
+            dec_info.archive_list = archive_list;
+            dec_info.archive_extract = archive_extract;
+            dec_info.key = key;
+            dec_info.password = password;
 
             // Step 4: Validate and read decode arguments
-            if (read_and_validate_decode_args(argv, &dec_info) == e_success)
+            if (range != NULL && read_decode_range(range, &dec_info) != e_success)
+            {
+                printf("❌ ERROR: Invalid --range, expected offset:len in bytes.\n");
+            }
+            else if (read_and_validate_decode_args(argv, &dec_info) == e_success)
             {
                 printf("-> Decode arguments validated successfully.\n");
 
                 // Step 5: Open stego image file
-                if (open_decoded_files(&dec_info) == e_success)
+                if (STATS_STAGE(stats_ptr, "open", open_decoded_files(&dec_info)) == e_success)
                 {
-                    // Step 6: Skip BMP header (first 54 bytes)
-                    skip_bmp_header(dec_info.fptr_stego_image);
-
+                    // Step 6: Parse the BMP header and skip to the pixel data
                     // Step 7: Verify magic string
-                    if (decode_magic_string(MAGIC_STRING, &dec_info) == e_success)
+                    if (STATS_STAGE(stats_ptr, "bmp_header", skip_bmp_header(&dec_info)) == e_success &&
+                        STATS_STAGE(stats_ptr, "magic", decode_magic_string(&dec_info)) == e_success)
                     {
                         // Step 8: Perform decoding process
                         if (do_decoding(&dec_info) == e_success)
                         {
                             printf("\n✅ Decoding completed successfully!\n");
-                            printf("📁 Output file generated: %s\n", dec_info.secret_fname);
+                            if (!dec_info.archive_list)
+                                printf("📁 Output file generated: %s\n", dec_info.secret_fname);
 
                         }
                         else
@@ -163,7 +458,10 @@ int main(int argc, char *argv[])
                     {
                         printf("❌ ERROR: Provided image is not an encoded file.\n");
                     }
+                    close_decoded_files(&dec_info);
                 }
+                if (stats_ptr != NULL)
+                    report_stats(stats_ptr, "decode", show_stats, stats_json);
             }
             else
             {
@@ -175,8 +473,12 @@ int main(int argc, char *argv[])
             printf("❌ ERROR: Unsupported operation type.\n\n");
             printf("Use -e for encode or -d for decode.\n\n");
             printf("Usage:\n");
-            printf(" 🔎 To Encode: %s -e <source_image.bmp> <secret_file.txt> [output_image.bmp]\n", argv[0]);
-            printf(" 🔎 To Decode: %s -d <stego_image.bmp> [output_file_name]\n", argv[0]);
+            printf(" 🔎 To Encode: %s -e <source_image.bmp> <secret_file.txt> [output_image.bmp] [--chunk KB] [-j N] [--lsb K] [--compress] [--key password] [--password password] [--async-io | --sync-io] [--stats] [--stats-json file] [--stream]\n", argv[0]);
+            printf(" 🔎 To Pack an Archive: %s -e <source_image.bmp> <file>... --archive <output_image.bmp>\n", argv[0]);
+            printf(" 🔎 To Decode: %s -d <stego_image.bmp> [output_file_name] [--mmap] [-j N] [--range offset:len] [--key password] [--password password] [--stats] [--stats-json file] [--stream]\n", argv[0]);
+            printf(" 🔎 To Unpack an Archive: %s -d <archive_image.bmp> [output_directory] [--list] [--extract name]\n", argv[0]);
+            printf(" 🔎 To Shard: %s -e <secret_file.txt> <cover.bmp>... --shard <output_prefix> | -d <shard.bmp>... --shard <output_file_name>\n", argv[0]);
+            printf(" 🔎 Through a Daemon: %s -e|-d <arguments> --connect <socket>\n", argv[0]);
         }
     }
 
@@ -185,8 +487,12 @@ int main(int argc, char *argv[])
     {
         printf("❌ ERROR: Invalid number of arguments.\n\n");
         printf("Usage:\n");
-        printf(" 🔎 To Encode: %s -e <source_image.bmp> <secret_file.txt> [output_image.bmp]\n", argv[0]);
-        printf(" 🔎 To Decode: %s -d <stego_image.bmp> [output_file_name]\n", argv[0]);
+        printf(" 🔎 To Encode: %s -e <source_image.bmp> <secret_file.txt> [output_image.bmp] [--chunk KB] [-j N]\n", argv[0]);
+        printf(" 🔎 To Decode: %s -d <stego_image.bmp> [output_file_name] [--mmap] [-j N] [--range offset:len]\n", argv[0]);
+        printf(" 🔎 To Benchmark: %s -b [payload_kb] | -b --suite [max_mp] [--results file.csv]\n", argv[0]);
+        printf(" 🔎 To Run a Batch: %s --batch <manifest.txt> [-j N] [--inflight N] [--cache-mb MB]\n", argv[0]);
+        printf(" 🔎 To Probe: %s -p <image.bmp | directory>... [-j N]\n", argv[0]);
+        printf(" 🔎 To Serve: %s --serve <socket> [-j N] [--cache-mb MB]\n", argv[0]);
     }
     printf("========================================\n\n");
 
@@ -207,7 +513,84 @@ OperationType check_operation_type(char *symbol)
     else if (strcmp(symbol, "-d") == 0)
         return e_decode;
 
-    // Step 3: Otherwise, return unsupported
+    // Step 3: Check whether the symbol is -b or not
+    else if (strcmp(symbol, "-b") == 0)
+        return e_bench;
+
+    // Step 4: Check whether the symbol is --batch or not
+    else if (strcmp(symbol, "--batch") == 0)
+        return e_batch;
+
+    // Step 5: Check whether the symbol is -p / --probe or not
+    else if (strcmp(symbol, "-p") == 0 || strcmp(symbol, "--probe") == 0)
+        return e_probe;
+
+    // Step 6: Check whether the symbol is --serve or not
+    else if (strcmp(symbol, "--serve") == 0)
+        return e_serve;
+
+    // Step 7: Otherwise, return unsupported
     else
         return e_unsupported;
 }
+
+
+//  * Function: extract_flag
+//  * Description: Removes an optional flag from argv and reports whether it was given.
+
+int extract_flag(int *argc, char *argv[], const char *flag)
+{
+    for (int i = 1; i < *argc; i++)
+    {
+        if (strcmp(argv[i], flag) == 0)
+        {
+            // Shift the rest of argv (including the NULL terminator) down
+            for (int j = i; j < *argc; j++)
+                argv[j] = argv[j + 1];
+            (*argc)--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//  * Function: extract_option
+//  * Description: Removes an option and its value from argv and returns the value (NULL if absent).
+
+char *extract_option(int *argc, char *argv[], const char *option)
+{
+    for (int i = 1; i + 1 < *argc; i++)
+    {
+        if (strcmp(argv[i], option) == 0)
+        {
+            char *value = argv[i + 1];
+            for (int j = i; j + 1 < *argc; j++)
+                argv[j] = argv[j + 2];
+            *argc -= 2;
+            return value;
+        }
+    }
+    return NULL;
+}
+
+//  * Function: report_stats
+//  * Description: Prints the per-stage table (--stats) and/or writes it as JSON (--stats-json file, "-" for stdout).
+
+void report_stats(const StegStats *stats, const char *operation, int show, const char *json_fname)
+{
+    if (show)
+        stats_print(stats, operation, stdout);
+
+    if (json_fname != NULL)
+    {
+        FILE *fptr = strcmp(json_fname, "-") == 0 ? stdout : fopen(json_fname, "w");
+        if (fptr == NULL)
+        {
+            perror("fopen");
+            return;
+        }
+        stats_print_json(stats, operation, fptr);
+        if (fptr != stdout)
+            fclose(fptr);
+    }
+}
@@ -0,0 +1,206 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "parallel.h"
+#include "lsb.h"
+
+/* Payload bytes below which a slice is not worth handing to a thread */
+#define PARALLEL_MIN_GRAIN (16 * 1024)
+
+struct _ThreadPool
+{
+    pthread_t *workers;
+    int count;              // Worker threads (the caller is one more)
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;   // Signalled when a new job is posted
+    pthread_cond_t done;    // Signalled when the last slice finishes
+    unsigned long job;      // Job generation counter
+    int stop;
+
+    /* Current job */
+    PoolTask task;
+    void *ctx;
+    size_t total;
+    size_t slice;
+    size_t next;            // Next index to hand out
+    size_t finished;        // Indices completed so far
+};
+
+/*
+ * Take slices of the current job until none are left
+ */
+static void pool_drain(ThreadPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->next < pool->total)
+    {
+        size_t begin = pool->next;
+        size_t end = begin + pool->slice < pool->total ? begin + pool->slice : pool->total;
+        pool->next = end;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->task(pool->ctx, begin, end);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->finished += end - begin;
+        if (pool->finished == pool->total)
+            pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void *pool_worker(void *arg)
+{
+    ThreadPool *pool = arg;
+    unsigned long seen = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->stop && pool->job == seen)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if (pool->stop)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->job;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool_drain(pool);
+    }
+}
+
+ThreadPool *pool_create(int threads)
+{
+    if (threads <= 1)
+        return NULL;
+    if (threads > POOL_MAX_THREADS)
+        threads = POOL_MAX_THREADS;
+
+    ThreadPool *pool = calloc(1, sizeof(*pool));
+    if (pool == NULL)
+        return NULL;
+    pool->workers = calloc(threads - 1, sizeof(pthread_t));
+    if (pool->workers == NULL)
+    {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    // The calling thread works too, so start threads - 1 workers
+    for (int i = 0; i < threads - 1; i++)
+    {
+        if (pthread_create(&pool->workers[i], NULL, pool_worker, pool) != 0)
+            break;
+        pool->count++;
+    }
+    return pool;
+}
+
+void pool_destroy(ThreadPool *pool)
+{
+    if (pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->count; i++)
+        pthread_join(pool->workers[i], NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->workers);
+    free(pool);
+}
+
+int pool_threads(const ThreadPool *pool)
+{
+    return pool == NULL ? 1 : pool->count + 1;
+}
+
+void pool_for(ThreadPool *pool, size_t count, size_t grain, PoolTask task, void *ctx)
+{
+    if (count == 0)
+        return;
+
+    // Small jobs or no workers: run inline
+    if (pool == NULL || pool->count == 0 || count <= grain)
+    {
+        task(ctx, 0, count);
+        return;
+    }
+
+    // One slice per thread, never smaller than grain
+    size_t threads = pool->count + 1;
+    size_t slice = (count + threads - 1) / threads;
+    if (slice < grain)
+        slice = grain;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->total = count;
+    pool->slice = slice;
+    pool->next = 0;
+    pool->finished = 0;
+    pool->job++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    pool_drain(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->finished < pool->total)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Bulk LSB kernels split over the pool
+ * Payload group g (bits bytes) only touches image bytes [8g, 8g + 8), so
+ * slices of whole groups are independent and the result is identical to
+ * the single-threaded one
+ */
+typedef struct
+{
+    char *image;
+    char *data;
+    size_t size;
+    int bits;
+} LsbJob;
+
+static void embed_task(void *ctx, size_t begin, size_t end)
+{
+    LsbJob *job = ctx;
+    size_t first = begin * job->bits;
+    size_t last = end * job->bits < job->size ? end * job->bits : job->size;
+    lsb_embed_bits(job->image + begin * 8, job->data + first, last - first, job->bits);
+}
+
+static void extract_task(void *ctx, size_t begin, size_t end)
+{
+    LsbJob *job = ctx;
+    size_t first = begin * job->bits;
+    size_t last = end * job->bits < job->size ? end * job->bits : job->size;
+    lsb_extract_bits(job->data + first, job->image + begin * 8, last - first, job->bits);
+}
+
+void parallel_embed_bytes(ThreadPool *pool, char *image_buffer, const char *data, size_t size, int bits)
+{
+    LsbJob job = {image_buffer, (char *)data, size, bits};
+    pool_for(pool, (size + bits - 1) / bits, PARALLEL_MIN_GRAIN / bits, embed_task, &job);
+}
+
+void parallel_extract_bytes(ThreadPool *pool, char *data, const char *image_buffer, size_t size, int bits)
+{
+    LsbJob job = {(char *)image_buffer, data, size, bits};
+    pool_for(pool, (size + bits - 1) / bits, PARALLEL_MIN_GRAIN / bits, extract_task, &job);
+}
@@ -0,0 +1,37 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+/*
+ * Fork-join thread pool
+ * Workers stay alive for the whole run; pool_for() splits an index
+ * range into slices, runs them on the workers and the calling thread,
+ * and returns once every slice is done.
+ */
+
+/* Maximum number of worker threads accepted by -j */
+#define POOL_MAX_THREADS 256
+
+typedef struct _ThreadPool ThreadPool;
+
+/* Work on the index range [begin, end) */
+typedef void (*PoolTask)(void *ctx, size_t begin, size_t end);
+
+/* Create a pool running on threads threads in total (NULL if threads <= 1) */
+ThreadPool *pool_create(int threads);
+
+/* Stop and free the pool */
+void pool_destroy(ThreadPool *pool);
+
+/* Number of threads taking part in pool_for (1 for a NULL pool) */
+int pool_threads(const ThreadPool *pool);
+
+/* Run task over [0, count) in slices of at least grain indices */
+void pool_for(ThreadPool *pool, size_t count, size_t grain, PoolTask task, void *ctx);
+
+/* Parallel versions of lsb_embed_bits / lsb_extract_bits */
+void parallel_embed_bytes(ThreadPool *pool, char *image_buffer, const char *data, size_t size, int bits);
+void parallel_extract_bytes(ThreadPool *pool, char *data, const char *image_buffer, size_t size, int bits);
+
+#endif
@@ -0,0 +1,337 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "probe.h"
+#include "decode.h"
+#include "stats.h"
+#include "parallel.h"
+
+/*
+ * Append one image to the file list
+ */
+static Status add_probe_file(ProbeInfo *probeInfo, const char *fname)
+{
+    if (probeInfo->file_count == probeInfo->file_cap)
+    {
+        size_t cap = probeInfo->file_cap ? probeInfo->file_cap * 2 : 64;
+        ProbeFile *files = realloc(probeInfo->files, cap * sizeof(ProbeFile));
+        if (files == NULL)
+            return e_failure;
+        probeInfo->files = files;
+        probeInfo->file_cap = cap;
+    }
+
+    ProbeFile *file = &probeInfo->files[probeInfo->file_count];
+    memset(file, 0, sizeof(*file));
+    if ((file->fname = strdup(fname)) == NULL)
+        return e_failure;
+    probeInfo->file_count++;
+    return e_success;
+}
+
+static int compare_probe_files(const void *a, const void *b)
+{
+    return strcmp(((const ProbeFile *)a)->fname, ((const ProbeFile *)b)->fname);
+}
+
+/*
+ * Add the *.bmp files of a directory (not recursive), sorted by name
+ */
+static Status add_probe_directory(ProbeInfo *probeInfo, const char *dirname)
+{
+    DIR *dir = opendir(dirname);
+    if (dir == NULL)
+    {
+        perror("opendir");
+        fprintf(stderr, "ERROR: Unable to open directory %s\n", dirname);
+        return e_failure;
+    }
+
+    size_t first = probeInfo->file_count;
+    size_t dir_len = strlen(dirname);
+    int slash = dir_len > 0 && dirname[dir_len - 1] == '/';
+    char path[4096];
+    struct dirent *entry;
+    Status ret = e_success;
+
+    while (ret == e_success && (entry = readdir(dir)) != NULL)
+    {
+        size_t len = strlen(entry->d_name);
+        if (len <= 4 || strcasecmp(entry->d_name + len - 4, ".bmp") != 0)
+            continue;
+        if (snprintf(path, sizeof(path), "%s%s%s", dirname, slash ? "" : "/", entry->d_name) >= (int)sizeof(path))
+            continue;
+        ret = add_probe_file(probeInfo, path);
+    }
+    closedir(dir);
+
+    qsort(probeInfo->files + first, probeInfo->file_count - first, sizeof(ProbeFile), compare_probe_files);
+    return ret;
+}
+
+/*
+ * Expand the command-line paths: directories to their *.bmp files,
+ * anything else is probed as given
+ */
+Status read_probe_paths(ProbeInfo *probeInfo)
+{
+    for (int i = 0; i < probeInfo->path_count; i++)
+    {
+        struct stat st;
+        const char *path = probeInfo->paths[i];
+
+        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+        {
+            if (add_probe_directory(probeInfo, path) != e_success)
+                return e_failure;
+        }
+        else if (add_probe_file(probeInfo, path) != e_success)
+        {
+            return e_failure;
+        }
+    }
+    return probeInfo->file_count > 0 ? e_success : e_failure;
+}
+
+void free_probe(ProbeInfo *probeInfo)
+{
+    for (size_t i = 0; i < probeInfo->file_count; i++)
+        free(probeInfo->files[i].fname);
+    free(probeInfo->files);
+    probeInfo->files = NULL;
+    probeInfo->file_count = 0;
+    probeInfo->file_cap = 0;
+}
+
+/*
+ * End of the header region (file offset): the carrier bytes of the
+ * magic string and versioned header, skipping row padding. The original
+ * layout reads fewer bytes straight through the padding, so it is
+ * covered too. Never past the pixel array.
+ */
+static uint64_t probe_region_end(const BmpInfo *bmp)
+{
+    uint64_t end = PROBE_CARRIER_BYTES;
+    if (bmp->capacity >= PROBE_CARRIER_BYTES && bmp_carrier_offset(bmp, PROBE_CARRIER_BYTES - 1) + 1 > end)
+        end = bmp_carrier_offset(bmp, PROBE_CARRIER_BYTES - 1) + 1;
+
+    uint64_t pixels = (uint64_t)bmp->stride * bmp->rows;
+    if (end > pixels)
+        end = pixels;
+    return bmp->data_offset + end;
+}
+
+/*
+ * Decode the magic string and header from the start of the image,
+ * which is handed to the decoder as if it were a mapping of the file
+ */
+static void probe_decode(ProbeFile *file, const unsigned char *image, size_t len, const BmpInfo *bmp)
+{
+    DecodeInfo dec_info = {0};
+    dec_info.stego_image_fname = file->fname;
+    dec_info.secret_fname = "-"; // Only record the extension, no output name
+    dec_info.quiet = 1;
+    dec_info.bmp = *bmp;
+    dec_info.image_map = (const char *)image;
+    dec_info.image_map_size = len;
+
+    // Step 1: Look for the magic string
+    file->result = e_probe_clean;
+    if (decode_magic_string(&dec_info) != e_success)
+        return;
+    file->version = dec_info.version;
+
+    // Step 2: Decode the header the magic string announces
+    file->result = e_probe_corrupt;
+    if (dec_info.version == STEG_VERSION)
+    {
+        if (decode_stego_header(&dec_info) != e_success)
+            return;
+        file->header = dec_info.header;
+    }
+    else
+    {
+        // The original layout has no checksum: at least the secret must fit
+        if (decode_legacy_header(&dec_info) != e_success ||
+            dec_info.size_secret_file > dec_info.bmp.capacity / 8)
+            return;
+        file->header.extn_len = dec_info.ext_size;
+        strcpy(file->header.extn, dec_info.extn_secret_file);
+        file->header.payload_size = dec_info.size_secret_file;
+        file->header.lsb_bits = 1;
+    }
+    file->result = e_probe_found;
+}
+
+/*
+ * Read the header region of an open image and decode it
+ */
+static Status probe_fd(ProbeFile *file, int fd, uint64_t file_size)
+{
+    unsigned char head[PROBE_READ_SIZE];
+    BmpInfo bmp;
+
+    // Step 1: One read covers the BMP headers and, usually, the header region
+    ssize_t got = pread(fd, head, sizeof(head), 0);
+    file->reads++;
+    if (got < 0)
+        return e_failure;
+    file->bytes_read += got;
+
+    file->result = e_probe_not_bmp;
+    if (bmp_parse_header(head, got, file_size, &bmp) != e_success)
+        return e_failure;
+    file->capacity = bmp.capacity;
+
+    uint64_t end = probe_region_end(&bmp);
+    if (end <= (uint64_t)got)
+    {
+        probe_decode(file, head, got, &bmp);
+        return e_success;
+    }
+
+    // Step 2: Large bfOffBits or narrow padded rows: read the rest of the region
+    unsigned char *image = malloc(end);
+    if (image == NULL)
+        return e_failure;
+    memcpy(image, head, got);
+    ssize_t more = pread(fd, image + got, end - got, got);
+    file->reads++;
+    if (more != (ssize_t)(end - got))
+    {
+        free(image);
+        file->result = e_probe_unreadable;
+        return e_failure;
+    }
+    file->bytes_read += more;
+
+    probe_decode(file, image, end, &bmp);
+    free(image);
+    return e_success;
+}
+
+/*
+ * Probe one image: open, read the header region, decode, close
+ */
+Status probe_image(ProbeFile *file)
+{
+    struct stat st;
+    Status ret = e_failure;
+
+    file->result = e_probe_unreadable;
+    file->reads = 0;
+    file->bytes_read = 0;
+
+    int fd = open(file->fname, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return e_failure;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+        ret = probe_fd(file, fd, st.st_size);
+    close(fd);
+    return ret;
+}
+
+static void probe_task(void *ctx, size_t begin, size_t end)
+{
+    ProbeInfo *probeInfo = ctx;
+    for (size_t i = begin; i < end; i++)
+        probe_image(&probeInfo->files[i]);
+}
+
+/*
+ * Print the result line of one image
+ */
+static void print_probe_file(const ProbeFile *file)
+{
+    const StegHeader *header = &file->header;
+
+    switch (file->result)
+    {
+    case e_probe_found:
+        if (file->version == STEG_VERSION)
+        {
+            printf("✅ %-40s v2, ", file->fname);
+            if (header->flags & STEG_FLAG_ARCHIVE)
+                printf("archive, ");
+            else
+                printf("extension %s, ", header->extn_len ? header->extn : "(none)");
+            // --stream images only learn the size (and CRC) at the end marker
+            if (header->flags & STEG_FLAG_STREAM)
+                printf("streamed (size not in header)");
+            else
+                printf("%llu bytes", (unsigned long long)header->payload_size);
+            printf(", %d-bit LSB%s%s%s%s", header->lsb_bits, header->flags & STEG_FLAG_LZ ? ", compressed" : "",
+                   header->flags & STEG_FLAG_SHARD ? ", shard" : "", header->flags & STEG_FLAG_SCATTER ? ", scattered" : "",
+                   header->flags & STEG_FLAG_CIPHER ? ", encrypted" : "");
+            if ((header->flags & STEG_FLAG_CRC) && !(header->flags & STEG_FLAG_STREAM))
+                printf(", CRC-32C 0x%08x", header->payload_crc);
+            printf("\n");
+        }
+        else
+        {
+            printf("✅ %-40s v1 (original layout), extension %s, %llu bytes\n",
+                   file->fname, header->extn, (unsigned long long)header->payload_size);
+        }
+        break;
+    case e_probe_clean:
+        printf("➖ %-40s no hidden data\n", file->fname);
+        break;
+    case e_probe_corrupt:
+        printf("⚠️  %-40s magic string found, but the header is corrupted\n", file->fname);
+        break;
+    case e_probe_not_bmp:
+        printf("❌ %-40s not an uncompressed 24/32-bit BMP\n", file->fname);
+        break;
+    default:
+        printf("❌ %-40s unable to read file\n", file->fname);
+        break;
+    }
+}
+
+/*
+ * Probe every image on the thread pool, then print the results in
+ * order and a summary
+ */
+Status do_probe(ProbeInfo *probeInfo)
+{
+    int workers = probeInfo->threads > 0 ? probeInfo->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers < 1)
+        workers = 1;
+    if ((size_t)workers > probeInfo->file_count)
+        workers = probeInfo->file_count;
+
+    printf("-> %zu images, %d workers\n\n", probeInfo->file_count, workers);
+
+    ThreadPool *pool = pool_create(workers);
+    double start = stats_now();
+    pool_for(pool, probeInfo->file_count, 1, probe_task, probeInfo);
+    double elapsed = stats_now() - start;
+    pool_destroy(pool);
+
+    size_t counts[e_probe_found + 1] = {0};
+    uint64_t reads = 0, bytes = 0;
+    for (size_t i = 0; i < probeInfo->file_count; i++)
+    {
+        const ProbeFile *file = &probeInfo->files[i];
+        print_probe_file(file);
+        counts[file->result]++;
+        reads += file->reads;
+        bytes += file->bytes_read;
+    }
+
+    printf("\n-> Images      : %zu with hidden data, %zu without, %zu corrupted, %zu not BMP, %zu unreadable\n",
+           counts[e_probe_found], counts[e_probe_clean], counts[e_probe_corrupt],
+           counts[e_probe_not_bmp], counts[e_probe_unreadable]);
+    printf("-> Reads       : %llu (%.2f per image), %.1f KB\n", (unsigned long long)reads,
+           (double)reads / probeInfo->file_count, bytes / 1024.0);
+    printf("-> Wall time   : %.3f s\n", elapsed);
+    if (elapsed > 0)
+        printf("-> Throughput  : %.1f images/s\n", probeInfo->file_count / elapsed);
+
+    return counts[e_probe_unreadable] == 0 ? e_success : e_failure;
+}
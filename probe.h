@@ -0,0 +1,71 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"  // Contains user defined types
+#include "header.h" // Versioned stego header
+
+/*
+ * Probe mode (-p / --probe)
+ * -------------------------
+ * Tells which images carry hidden data without decoding them: only the
+ * header region (magic string plus the stego header, or the original
+ * extension/size fields) is read and decoded, with the same functions
+ * as -d. No output file is opened and no payload is extracted.
+ *
+ * Each image costs one pread of its first PROBE_READ_SIZE bytes; a
+ * second read is only needed when bfOffBits or row padding push the
+ * header region past them. Directories are scanned for *.bmp files and
+ * the images are probed on the thread pool.
+ */
+
+/* Bytes read from the start of every image */
+#define PROBE_READ_SIZE 4096
+
+/* Carrier bytes holding the magic string and the versioned header */
+#define PROBE_CARRIER_BYTES ((2 + STEG_HEADER_SIZE) * 8)
+
+typedef enum
+{
+    e_probe_unreadable, // Could not be opened or read
+    e_probe_not_bmp,    // Not an uncompressed 24/32-bit BMP
+    e_probe_clean,      // No magic string
+    e_probe_corrupt,    // Magic string, but the header does not check out
+    e_probe_found       // Hidden data
+} ProbeResult;
+
+typedef struct _ProbeFile
+{
+    char *fname;           // Image path (owned)
+    ProbeResult result;    // Outcome of the probe
+    int version;           // 1 = original layout, STEG_VERSION = versioned header
+    StegHeader header;     // Decoded header (extn and payload_size for version 1)
+    uint64_t capacity;     // Carrier bytes in the image
+    uint reads;            // pread calls made
+    uint64_t bytes_read;   // Bytes read from the image
+} ProbeFile;
+
+typedef struct _ProbeInfo
+{
+    char **paths;          // Images and directories from the command line
+    int path_count;        // Number of paths
+    ProbeFile *files;      // Images to probe
+    size_t file_count;     // Number of images
+    size_t file_cap;       // Allocated entries of files
+    int threads;           // Worker threads (0 = one per online CPU)
+} ProbeInfo;
+
+/* Expand the command-line paths (directories to their *.bmp files) */
+Status read_probe_paths(ProbeInfo *probeInfo);
+
+/* Read and decode the header region of one image */
+Status probe_image(ProbeFile *file);
+
+/* Probe every image in parallel and print one line each plus a summary */
+Status do_probe(ProbeInfo *probeInfo);
+
+/* Release the file list */
+void free_probe(ProbeInfo *probeInfo);
+
+#endif
@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <string.h>
+#include "scatter.h"
+
+/*
+ * splitmix64 step, used to expand seeds into generator states
+ */
+static uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * xoshiro256** generator
+ */
+typedef struct
+{
+    uint64_t s[4];
+} ScatterRng;
+
+static void scatter_rng_seed(ScatterRng *rng, uint64_t seed)
+{
+    for (int i = 0; i < 4; i++)
+        rng->s[i] = splitmix64(&seed);
+}
+
+static uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t scatter_rng_next(ScatterRng *rng)
+{
+    uint64_t *s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+/*
+ * Fisher-Yates shuffle of 0..n-1 (the index is drawn with a multiply
+ * instead of a division)
+ */
+static void scatter_shuffle(ScatterRng *rng, uint32_t *perm, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+        perm[i] = i;
+    for (uint32_t i = n; i > 1; i--)
+    {
+        uint32_t j = (uint32_t)(((scatter_rng_next(rng) >> 32) * i) >> 32);
+        uint32_t tmp = perm[i - 1];
+        perm[i - 1] = perm[j];
+        perm[j] = tmp;
+    }
+}
+
+/*
+ * FNV-1a over the key, mixed once more so similar keys give unrelated seeds
+ */
+uint64_t scatter_key_seed(const char *key)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (const unsigned char *p = (const unsigned char *)key; *p != '\0'; p++)
+        hash = (hash ^ *p) * 0x100000001B3ULL;
+    return splitmix64(&hash);
+}
+
+uint32_t scatter_key_check(uint64_t seed)
+{
+    uint64_t state = seed ^ 0x5CA77E5C0FFEE000ULL;
+    return splitmix64(&state) >> 32;
+}
+
+/*
+ * Whole groups after first, then the full blocks shuffled among
+ * themselves; a short last block keeps its place at the end
+ */
+Status scatter_map_init(ScatterMap *map, uint64_t seed, uint64_t first, uint64_t capacity)
+{
+    ScatterRng rng;
+
+    map->seed = seed;
+    map->first = first;
+    map->group_count = capacity > first ? (capacity - first) / 8 : 0;
+    map->block_count = (map->group_count + SCATTER_BLOCK_GROUPS - 1) / SCATTER_BLOCK_GROUPS;
+    if (map->block_count > UINT32_MAX)
+        return e_failure;
+    map->block_order = malloc((map->block_count ? map->block_count : 1) * sizeof(uint32_t));
+    if (map->block_order == NULL)
+        return e_failure;
+
+    uint32_t full = map->group_count / SCATTER_BLOCK_GROUPS;
+    scatter_rng_seed(&rng, seed);
+    scatter_shuffle(&rng, map->block_order, full);
+    if (full < map->block_count)
+        map->block_order[full] = full;
+    return e_success;
+}
+
+uint32_t scatter_block_groups(const ScatterMap *map, uint64_t block)
+{
+    uint64_t start = (uint64_t)map->block_order[block] * SCATTER_BLOCK_GROUPS;
+    uint64_t left = map->group_count - start;
+    return left < SCATTER_BLOCK_GROUPS ? (uint32_t)left : SCATTER_BLOCK_GROUPS;
+}
+
+uint64_t scatter_block_carrier(const ScatterMap *map, uint64_t block)
+{
+    return map->first + (uint64_t)map->block_order[block] * SCATTER_BLOCK_GROUPS * 8;
+}
+
+/*
+ * Every block has its own generator, so blocks can be visited in any
+ * order (or in parallel) without replaying the ones before
+ */
+void scatter_block_perm(const ScatterMap *map, uint64_t block, uint32_t *perm, uint32_t n)
+{
+    ScatterRng rng;
+    uint64_t state = map->seed ^ (block + 1) * 0xD1B54A32D192ED03ULL;
+    scatter_rng_seed(&rng, splitmix64(&state));
+    scatter_shuffle(&rng, perm, n);
+}
+
+void scatter_gather_groups(char *groups, const char *carriers, const uint32_t *perm, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+        memcpy(groups + (size_t)i * 8, carriers + (size_t)perm[i] * 8, 8);
+}
+
+void scatter_put_groups(char *carriers, const char *groups, const uint32_t *perm, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+        memcpy(carriers + (size_t)perm[i] * 8, groups + (size_t)i * 8, 8);
+}
+
+void free_scatter_map(ScatterMap *map)
+{
+    free(map->block_order);
+    map->block_order = NULL;
+}
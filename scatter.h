@@ -0,0 +1,69 @@
+#ifndef SCATTER_H
+#define SCATTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * Keyed scattering (--key)
+ * ------------------------
+ * Without a key the payload fills the carriers right after the stego
+ * header, in order. With --key the payload region (every carrier after
+ * the header) is cut into groups of 8 carriers, each holding lsb_bits
+ * payload bytes, and the groups into blocks of SCATTER_BLOCK_GROUPS.
+ * The full blocks are shuffled across the image and the groups inside
+ * every block are shuffled again, both from a xoshiro256** generator
+ * seeded with the key, so the payload is spread over the whole image
+ * and only the same key finds it.
+ *
+ * The two-level order keeps memory access near-sequential: a block of
+ * carriers is read once, its groups are permuted while they sit in the
+ * cache, and it is written once. A global shuffle would touch a new
+ * cache line (and, on files, a new disk block) for every group.
+ *
+ * The magic string and stego header stay in place; header key_check
+ * tells a wrong key from a corrupted image. Scattering hides where the
+ * payload lies, it does not encrypt it.
+ */
+
+/* 8-carrier groups per block: 32 KB of carriers, about an L1 data cache */
+#define SCATTER_BLOCK_GROUPS 4096
+
+typedef struct _ScatterMap
+{
+    uint64_t seed;          // Generator seed derived from the key
+    uint64_t first;         // First carrier of the payload region
+    uint64_t group_count;   // Whole groups in the payload region
+    uint64_t block_count;   // Blocks (the last one may be short)
+    uint32_t *block_order;  // Physical block holding each logical block
+} ScatterMap;
+
+/* Generator seed for a key */
+uint64_t scatter_key_seed(const char *key);
+
+/* Check value stored in the header to recognise the key */
+uint32_t scatter_key_check(uint64_t seed);
+
+/* Build the block order for the carriers [first, capacity) */
+Status scatter_map_init(ScatterMap *map, uint64_t seed, uint64_t first, uint64_t capacity);
+
+/* Groups in logical block block */
+uint32_t scatter_block_groups(const ScatterMap *map, uint64_t block);
+
+/* First carrier of the physical block holding logical block block */
+uint64_t scatter_block_carrier(const ScatterMap *map, uint64_t block);
+
+/* Order of the groups inside logical block block (n = scatter_block_groups) */
+void scatter_block_perm(const ScatterMap *map, uint64_t block, uint32_t *perm, uint32_t n);
+
+/* Copy groups perm[0..n) of carriers, in that order, to groups */
+void scatter_gather_groups(char *groups, const char *carriers, const uint32_t *perm, uint32_t n);
+
+/* Copy groups back to groups perm[0..n) of carriers */
+void scatter_put_groups(char *carriers, const char *groups, const uint32_t *perm, uint32_t n);
+
+/* Release the block order */
+void free_scatter_map(ScatterMap *map);
+
+#endif
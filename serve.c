@@ -0,0 +1,568 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "serve.h"
+#include "encode.h"
+#include "decode.h"
+#include "stats.h"
+
+/*
+ * Fill a sockaddr_un with the socket path (fails when it is too long)
+ */
+static Status serve_address(const char *socket_path, struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr->sun_path))
+        return e_failure;
+    strcpy(addr->sun_path, socket_path);
+    return e_success;
+}
+
+static void serve_close_fds(int *fds, int count)
+{
+    for (int i = 0; i < count; i++)
+        if (fds[i] >= 0)
+            close(fds[i]);
+}
+
+/*
+ * Receive one request and its descriptors. SOCK_SEQPACKET keeps the
+ * message whole, so anything but a complete ServeRequest is an error.
+ * Returns e_failure when the client has gone (or sent garbage).
+ */
+static Status serve_receive(int conn, ServeRequest *request, int *fds, int *fd_count)
+{
+    char control[CMSG_SPACE(sizeof(int) * SERVE_MAX_FDS)];
+    struct iovec iov = {request, sizeof(*request)};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    *fd_count = 0;
+    ssize_t got = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+        int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (int i = 0; i < count; i++)
+        {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            if (*fd_count < SERVE_MAX_FDS)
+                fds[(*fd_count)++] = fd;
+            else
+                close(fd);
+        }
+    }
+
+    if (got != (ssize_t)sizeof(*request) || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) ||
+        request->magic != SERVE_MAGIC)
+    {
+        serve_close_fds(fds, *fd_count);
+        *fd_count = 0;
+        return e_failure;
+    }
+
+    // Strings come from another process: make sure they end
+    for (int i = 0; i < SERVE_MAX_FDS; i++)
+        request->names[i][SERVE_NAME_MAX - 1] = '\0';
+    request->key[SERVE_NAME_MAX - 1] = '\0';
+    request->password[SERVE_NAME_MAX - 1] = '\0';
+    return e_success;
+}
+
+/*
+ * Hand a received descriptor to stdio (the FILE owns it from then on)
+ */
+static FILE *serve_fdopen(int *fd, const char *mode)
+{
+    FILE *fptr = fdopen(*fd, mode);
+    if (fptr != NULL)
+        *fd = -1;
+    return fptr;
+}
+
+/*
+ * Run one encode with the normal pipeline on the descriptors: the file
+ * names only go through the CLI validators and into messages
+ */
+static void serve_encode(ServeServer *server, ServeRequest *request, int *fds, ServeReply *reply)
+{
+    EncodeInfo enc_info = {0};
+    char *argv[] = {"--serve", "-e", request->names[0], request->names[1], request->names[2], NULL};
+    enc_info.quiet = 1;
+    enc_info.lsb_bits = request->lsb_bits;
+    enc_info.compress = (request->flags & SERVE_FLAG_COMPRESS) != 0;
+    enc_info.key = request->key[0] ? request->key : NULL;
+    enc_info.password = request->password[0] ? request->password : NULL;
+    enc_info.cover_cache = server->cache;
+
+    if (read_and_validate_encode_args(argv, &enc_info) == e_success &&
+        (enc_info.fptr_src_image = serve_fdopen(&fds[0], "rb")) != NULL &&
+        (enc_info.fptr_secret = serve_fdopen(&fds[1], "rb")) != NULL &&
+        (enc_info.fptr_stego_image = serve_fdopen(&fds[2], "wb")) != NULL)
+    {
+        reply->status = do_encoding(&enc_info);
+        reply->payload_bytes = enc_info.size_secret_file;
+    }
+    close_files(&enc_info);
+}
+
+/*
+ * Run one decode into the output descriptor; the client names the file
+ * after the extension returned in the reply
+ */
+static void serve_decode(ServeRequest *request, int *fds, ServeReply *reply)
+{
+    DecodeInfo dec_info = {0};
+    char *argv[] = {"--serve", "-d", request->names[0], request->names[1], NULL};
+    dec_info.quiet = 1;
+    dec_info.use_mmap = (request->flags & SERVE_FLAG_MMAP) != 0;
+    dec_info.key = request->key[0] ? request->key : NULL;
+    dec_info.password = request->password[0] ? request->password : NULL;
+
+    if (read_and_validate_decode_args(argv, &dec_info) == e_success &&
+        (dec_info.fptr_stego_image = serve_fdopen(&fds[0], "rb")) != NULL &&
+        (dec_info.fptr_output = serve_fdopen(&fds[1], "wb")) != NULL && open_decoded_files(&dec_info) == e_success &&
+        skip_bmp_header(&dec_info) == e_success && decode_magic_string(&dec_info) == e_success)
+    {
+        reply->status = do_decoding(&dec_info);
+        reply->payload_bytes = dec_info.size_secret_file;
+        strcpy(reply->extn, dec_info.extn_secret_file);
+    }
+    close_decoded_files(&dec_info);
+}
+
+/*
+ * Answer one request and log it
+ */
+static void serve_run(ServeServer *server, ServeRequest *request, int *fds, int fd_count, ServeReply *reply)
+{
+    double start = stats_now();
+    memset(reply, 0, sizeof(*reply));
+    reply->magic = SERVE_MAGIC;
+    reply->status = e_failure;
+
+    if (request->op == SERVE_OP_ENCODE && fd_count == 3)
+        serve_encode(server, request, fds, reply);
+    else if (request->op == SERVE_OP_DECODE && fd_count == 2)
+        serve_decode(request, fds, reply);
+    serve_close_fds(fds, fd_count);
+    reply->seconds = stats_now() - start;
+
+    pthread_mutex_lock(&server->lock);
+    server->requests++;
+    server->failures += reply->status != e_success;
+    server->busy_seconds += reply->seconds;
+    if (!server->quiet)
+    {
+        printf("[%6llu] %s %s %-28s -> %-28s %10llu B %9.3f ms\n", (unsigned long long)server->requests,
+               reply->status == e_success ? "✅" : "❌", request->op == SERVE_OP_ENCODE ? "enc" : "dec",
+               request->names[0], request->op == SERVE_OP_ENCODE ? request->names[2] : request->names[1],
+               (unsigned long long)reply->payload_bytes, reply->seconds * 1000);
+        fflush(stdout);
+    }
+    pthread_mutex_unlock(&server->lock);
+}
+
+/*
+ * Worker: accept a connection, answer its requests until the client
+ * hangs up, repeat. Connections from other users are dropped.
+ */
+static void *serve_worker(void *arg)
+{
+    ServeWorker *worker = arg;
+    ServeServer *server = worker->server;
+    ServeRequest request;
+    ServeReply reply;
+    int fds[SERVE_MAX_FDS], fd_count;
+
+    for (;;)
+    {
+        int conn = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        pthread_mutex_lock(&server->lock);
+        int stopping = server->stopping;
+        if (conn >= 0 && !stopping)
+            worker->conn = conn;
+        pthread_mutex_unlock(&server->lock);
+        if (stopping)
+        {
+            if (conn >= 0)
+                close(conn);
+            break;
+        }
+        if (conn < 0)
+            continue;
+
+        struct ucred cred;
+        socklen_t len = sizeof(cred);
+        if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && cred.uid == geteuid())
+        {
+            while (serve_receive(conn, &request, fds, &fd_count) == e_success)
+            {
+                serve_run(server, &request, fds, fd_count, &reply);
+                if (send(conn, &reply, sizeof(reply), MSG_NOSIGNAL) != (ssize_t)sizeof(reply))
+                    break;
+            }
+        }
+
+        pthread_mutex_lock(&server->lock);
+        worker->conn = -1;
+        pthread_mutex_unlock(&server->lock);
+        close(conn);
+    }
+    return NULL;
+}
+
+/*
+ * Bind the socket (replacing a stale one left by a crashed daemon,
+ * never a regular file) and start the workers
+ */
+Status serve_open(ServeServer *server, const char *socket_path, int workers, CoverCache *cache, int quiet)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+
+    memset(server, 0, sizeof(*server));
+    server->socket_path = socket_path;
+    server->quiet = quiet;
+    server->cache = cache;
+    server->listen_fd = -1;
+    if (serve_address(socket_path, &addr) != e_success)
+    {
+        fprintf(stderr, "ERROR: Socket path %s is too long\n", socket_path);
+        return e_failure;
+    }
+
+    // Step 1: A socket file nobody answers on is stale
+    if (lstat(socket_path, &st) == 0)
+    {
+        int probe = serve_connect(socket_path);
+        if (probe >= 0)
+        {
+            close(probe);
+            fprintf(stderr, "ERROR: A daemon is already serving %s\n", socket_path);
+            return e_failure;
+        }
+        if (!S_ISSOCK(st.st_mode) || unlink(socket_path) != 0)
+        {
+            fprintf(stderr, "ERROR: %s exists and is not a stale socket\n", socket_path);
+            return e_failure;
+        }
+    }
+
+    // Step 2: Bind with no access for other users, then listen
+    server->listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (server->listen_fd < 0)
+    {
+        perror("socket");
+        return e_failure;
+    }
+    mode_t mask = umask(0077);
+    int bound = bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(mask);
+    if (bound != 0 || listen(server->listen_fd, 64) != 0)
+    {
+        perror("bind");
+        fprintf(stderr, "ERROR: Unable to listen on %s\n", socket_path);
+        close(server->listen_fd);
+        return e_failure;
+    }
+
+    // Step 3: Start the workers; they live until serve_close
+    pthread_mutex_init(&server->lock, NULL);
+    server->workers = calloc(workers, sizeof(ServeWorker));
+    if (server->workers == NULL)
+    {
+        serve_close(server);
+        return e_failure;
+    }
+    for (int i = 0; i < workers; i++)
+    {
+        server->workers[i].server = server;
+        server->workers[i].conn = -1;
+        if (pthread_create(&server->workers[i].thread, NULL, serve_worker, &server->workers[i]) != 0)
+        {
+            serve_close(server);
+            return e_failure;
+        }
+        server->worker_count++;
+    }
+    return e_success;
+}
+
+/*
+ * Requests in progress finish; idle connections are shut down for
+ * reading so their workers see end of file, and one connection per
+ * worker wakes those blocked in accept
+ */
+void serve_close(ServeServer *server)
+{
+    pthread_mutex_lock(&server->lock);
+    server->stopping = 1;
+    for (int i = 0; i < server->worker_count; i++)
+        if (server->workers[i].conn >= 0)
+            shutdown(server->workers[i].conn, SHUT_RD);
+    pthread_mutex_unlock(&server->lock);
+
+    int *wake = calloc(server->worker_count ? server->worker_count : 1, sizeof(int));
+    for (int i = 0; i < server->worker_count; i++)
+        if (wake != NULL)
+            wake[i] = serve_connect(server->socket_path);
+    for (int i = 0; i < server->worker_count; i++)
+        pthread_join(server->workers[i].thread, NULL);
+    if (wake != NULL)
+        serve_close_fds(wake, server->worker_count);
+    free(wake);
+
+    if (server->listen_fd >= 0)
+    {
+        close(server->listen_fd);
+        unlink(server->socket_path);
+    }
+    server->listen_fd = -1;
+    free(server->workers);
+    server->workers = NULL;
+    server->worker_count = 0;
+    pthread_mutex_destroy(&server->lock);
+}
+
+/*
+ * Daemon main loop: the workers run on their own, this thread only
+ * waits for SIGINT or SIGTERM
+ */
+Status do_serve(ServeInfo *serveInfo)
+{
+    ServeServer server;
+    CoverCache cache;
+    int workers = serveInfo->threads > 0 ? serveInfo->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers < 1)
+        workers = 1;
+
+    // Workers inherit the mask, so the signals reach sigwait below
+    sigset_t stop;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Covers stay cached for every request (--cache-mb 0 turns it off)
+    cover_cache_init(&cache, (size_t)serveInfo->cache_mb * 1024 * 1024);
+    if (serve_open(&server, serveInfo->socket_path, workers, serveInfo->cache_mb > 0 ? &cache : NULL, 0) !=
+        e_success)
+    {
+        cover_cache_free(&cache);
+        return e_failure;
+    }
+    printf("-> Serving on %s with %d worker%s", serveInfo->socket_path, workers, workers == 1 ? "" : "s");
+    if (serveInfo->cache_mb > 0)
+        printf(" and a %d MB cover cache", serveInfo->cache_mb);
+    printf(" (Ctrl-C to stop)\n\n");
+    fflush(stdout);
+
+    int sig;
+    double start = stats_now();
+    sigwait(&stop, &sig);
+    double elapsed = stats_now() - start;
+
+    printf("\n-> Stopping (%s), waiting for requests in progress\n", sig == SIGINT ? "SIGINT" : "SIGTERM");
+    serve_close(&server);
+
+    printf("-> Requests    : %llu answered, %llu failed\n", (unsigned long long)server.requests,
+           (unsigned long long)server.failures);
+    printf("-> Up time     : %.3f s (%.3f s inside requests)\n", elapsed, server.busy_seconds);
+    if (server.requests > 0)
+        printf("-> Per request : %.3f ms on average\n", server.busy_seconds * 1000 / server.requests);
+    if (serveInfo->cache_mb > 0)
+        cover_cache_print(&cache, "-> Cover cache : ");
+    cover_cache_free(&cache);
+    return e_success;
+}
+
+int serve_connect(const char *socket_path)
+{
+    struct sockaddr_un addr;
+    if (serve_address(socket_path, &addr) != e_success)
+        return -1;
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+        return -1;
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+Status serve_request(int sock, const ServeRequest *request, const int *fds, ServeReply *reply)
+{
+    char control[CMSG_SPACE(sizeof(int) * SERVE_MAX_FDS)];
+    struct iovec iov = {(void *)request, sizeof(*request)};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    // Step 1: The request, with the descriptors as SCM_RIGHTS
+    if (request->fd_count > SERVE_MAX_FDS)
+        return e_failure;
+    if (request->fd_count > 0)
+    {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * request->fd_count);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * request->fd_count);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * request->fd_count);
+    }
+    if (sendmsg(sock, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(*request))
+        return e_failure;
+
+    // Step 2: The reply
+    ssize_t got;
+    do
+        got = recv(sock, reply, sizeof(*reply), 0);
+    while (got < 0 && errno == EINTR);
+    if (got != (ssize_t)sizeof(*reply) || reply->magic != SERVE_MAGIC)
+        return e_failure;
+    reply->extn[STEG_MAX_EXTN] = '\0';
+    return e_success;
+}
+
+/*
+ * Client (--connect): the arguments go through the same validators as
+ * a local run, the files are opened here and handed to the daemon. A
+ * decoded file is created under the output name and renamed once the
+ * reply brings the extension.
+ */
+Status do_serve_client(ServeInfo *serveInfo, char *argv[])
+{
+    ServeRequest request;
+    ServeReply reply;
+    int fds[SERVE_MAX_FDS] = {-1, -1, -1};
+    const char *output = NULL;
+    Status ret = e_failure;
+
+    memset(&request, 0, sizeof(request));
+    request.magic = SERVE_MAGIC;
+    request.lsb_bits = serveInfo->lsb_bits;
+    request.flags = (serveInfo->compress ? SERVE_FLAG_COMPRESS : 0) | (serveInfo->use_mmap ? SERVE_FLAG_MMAP : 0);
+    if (serveInfo->key != NULL)
+        snprintf(request.key, sizeof(request.key), "%s", serveInfo->key);
+    if (serveInfo->password != NULL)
+        snprintf(request.password, sizeof(request.password), "%s", serveInfo->password);
+    if ((serveInfo->key != NULL && strlen(serveInfo->key) >= SERVE_NAME_MAX) ||
+        (serveInfo->password != NULL && strlen(serveInfo->password) >= SERVE_NAME_MAX))
+    {
+        fprintf(stderr, "ERROR: --key and --password are limited to %d bytes with --connect\n", SERVE_NAME_MAX - 1);
+        return e_failure;
+    }
+
+    // Step 1: Validate like the CLI and open the files
+    if (serveInfo->op == e_encode)
+    {
+        EncodeInfo enc_info = {0};
+        enc_info.lsb_bits = serveInfo->lsb_bits;
+        enc_info.compress = serveInfo->compress;
+        enc_info.key = serveInfo->key;
+        enc_info.password = serveInfo->password;
+        if (read_and_validate_encode_args(argv, &enc_info) != e_success)
+            return e_failure;
+        request.op = SERVE_OP_ENCODE;
+        request.fd_count = 3;
+        snprintf(request.names[0], SERVE_NAME_MAX, "%s", enc_info.src_image_fname);
+        snprintf(request.names[1], SERVE_NAME_MAX, "%s", enc_info.secret_fname);
+        snprintf(request.names[2], SERVE_NAME_MAX, "%s", enc_info.stego_image_fname);
+        fds[0] = open(request.names[0], O_RDONLY | O_CLOEXEC);
+        fds[1] = open(request.names[1], O_RDONLY | O_CLOEXEC);
+        fds[2] = open(request.names[2], O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        output = request.names[2];
+    }
+    else
+    {
+        DecodeInfo dec_info = {0};
+        if (read_and_validate_decode_args(argv, &dec_info) != e_success)
+            return e_failure;
+        request.op = SERVE_OP_DECODE;
+        request.fd_count = 2;
+        snprintf(request.names[0], SERVE_NAME_MAX, "%s", dec_info.stego_image_fname);
+        snprintf(request.names[1], SERVE_NAME_MAX, "%s", dec_info.secret_fname);
+        fds[0] = open(request.names[0], O_RDONLY | O_CLOEXEC);
+        fds[1] = open(request.names[1], O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        output = request.names[1];
+    }
+    for (int i = 0; i < request.fd_count; i++)
+    {
+        if (fds[i] < 0)
+        {
+            perror("open");
+            fprintf(stderr, "ERROR: Unable to open file %s\n", request.names[i]);
+            serve_close_fds(fds, request.fd_count);
+            if (fds[request.fd_count - 1] >= 0)
+                unlink(output);
+            return e_failure;
+        }
+    }
+
+    // Step 2: One round trip to the daemon
+    double start = stats_now();
+    int sock = serve_connect(serveInfo->socket_path);
+    if (sock < 0)
+    {
+        perror("connect");
+        fprintf(stderr, "ERROR: No daemon is serving %s\n", serveInfo->socket_path);
+    }
+    else if (serve_request(sock, &request, fds, &reply) != e_success)
+    {
+        fprintf(stderr, "ERROR: The daemon on %s did not answer\n", serveInfo->socket_path);
+    }
+    else
+    {
+        ret = reply.status == e_success ? e_success : e_failure;
+    }
+    double elapsed = stats_now() - start;
+    if (sock >= 0)
+        close(sock);
+    serve_close_fds(fds, request.fd_count);
+
+    // Step 3: Name the decoded file after its extension
+    if (ret == e_success && request.op == SERVE_OP_DECODE && reply.extn[0] != '\0')
+    {
+        if (strchr(reply.extn, '/') != NULL ||
+            snprintf(serveInfo->output_fname, sizeof(serveInfo->output_fname), "%s%s", output, reply.extn) >=
+                (int)sizeof(serveInfo->output_fname) ||
+            rename(output, serveInfo->output_fname) != 0)
+            ret = e_failure;
+    }
+    else
+    {
+        snprintf(serveInfo->output_fname, sizeof(serveInfo->output_fname), "%s", output);
+    }
+    if (ret != e_success)
+    {
+        unlink(output);
+        if (sock >= 0)
+            fprintf(stderr, "ERROR: The daemon could not %s %s (see its log)\n",
+                    request.op == SERVE_OP_ENCODE ? "encode into" : "decode", request.names[0]);
+        return e_failure;
+    }
+
+    printf("-> Daemon time : %.3f ms\n", reply.seconds * 1000);
+    printf("-> Round trip  : %.3f ms (%llu bytes)\n", elapsed * 1000, (unsigned long long)reply.payload_bytes);
+    return e_success;
+}
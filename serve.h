@@ -0,0 +1,122 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "types.h"  // Contains user defined types
+#include "header.h" // Versioned stego header
+#include "cache.h"  // Parsed covers kept in memory
+
+/*
+ * Daemon mode (--serve)
+ * ---------------------
+ * A long-running process listens on a Unix domain socket and runs
+ * encode/decode requests on threads that stay alive between requests,
+ * so a request costs the embed itself instead of a fork/exec, argument
+ * parsing and a cold start.
+ *
+ * The client opens the files itself and hands the descriptors over
+ * with SCM_RIGHTS, together with one fixed-size ServeRequest:
+ *
+ *   encode: cover (read), secret (read), stego image (write)
+ *   decode: stego image (read), output (write)
+ *
+ * The daemon answers every request with a ServeReply on the same
+ * connection; a connection may carry any number of requests. Both
+ * structures are sent as they are in memory, so the client and daemon
+ * must be the same build (SERVE_MAGIC changes with the layout). Only
+ * processes of the daemon's own user are served, and the socket is
+ * created with mode 0600.
+ */
+
+#define SERVE_MAGIC 0x31565253 /* "SRV1" */
+#define SERVE_NAME_MAX 256
+#define SERVE_MAX_FDS 3
+
+/* Request operations */
+#define SERVE_OP_ENCODE 1
+#define SERVE_OP_DECODE 2
+
+/* Request flags */
+#define SERVE_FLAG_COMPRESS 0x01 // Encode with --compress
+#define SERVE_FLAG_MMAP 0x02     // Decode with --mmap
+
+typedef struct _ServeRequest
+{
+    uint32_t magic;        // SERVE_MAGIC
+    uint8_t op;            // SERVE_OP_*
+    uint8_t lsb_bits;      // --lsb (0 = 1)
+    uint8_t flags;         // SERVE_FLAG_*
+    uint8_t fd_count;      // Descriptors attached (3 encode, 2 decode)
+    char names[SERVE_MAX_FDS][SERVE_NAME_MAX]; // File names, for validation and messages
+    char key[SERVE_NAME_MAX];      // --key ("" = none)
+    char password[SERVE_NAME_MAX]; // --password ("" = none)
+} ServeRequest;
+
+typedef struct _ServeReply
+{
+    uint32_t magic;        // SERVE_MAGIC
+    int32_t status;        // e_success or e_failure
+    uint64_t payload_bytes; // Secret bytes embedded or extracted
+    double seconds;        // Time spent on the request inside the daemon
+    char extn[STEG_MAX_EXTN + 1]; // Decode: extension recorded in the image
+} ServeReply;
+
+typedef struct _ServeWorker
+{
+    struct _ServeServer *server;
+    pthread_t thread;
+    int conn;              // Connection being served (-1 = none)
+} ServeWorker;
+
+typedef struct _ServeServer
+{
+    const char *socket_path; // Path the socket is bound to
+    int listen_fd;           // Listening socket
+    int stopping;            // Set once serve_close has begun
+    int quiet;               // Do not log every request
+    CoverCache *cache;       // Covers shared by the encode requests, NULL when off
+    ServeWorker *workers;    // One thread per worker
+    int worker_count;        // Number of workers
+    pthread_mutex_t lock;    // Guards the counters and worker connections
+    uint64_t requests;       // Requests answered
+    uint64_t failures;       // Requests that failed
+    double busy_seconds;     // Total time spent inside requests
+} ServeServer;
+
+typedef struct _ServeInfo
+{
+    const char *socket_path; // --serve or --connect socket
+    int threads;             // Worker threads (0 = one per online CPU)
+    int cache_mb;            // --cache-mb: cover cache budget (0 = no cache)
+
+    /* Client (--connect) */
+    OperationType op;        // e_encode or e_decode
+    int lsb_bits;            // --lsb (0 = 1)
+    int compress;            // --compress
+    int use_mmap;            // --mmap
+    const char *key;         // --key, NULL otherwise
+    const char *password;    // --password, NULL otherwise
+    char output_fname[256];  // File written (decode: with the extension)
+} ServeInfo;
+
+/* Bind the socket and start the workers (cache: cover cache owned by
+   the caller or NULL, quiet: no per-request log) */
+Status serve_open(ServeServer *server, const char *socket_path, int workers, CoverCache *cache, int quiet);
+
+/* Stop accepting, wake idle workers, join them and remove the socket */
+void serve_close(ServeServer *server);
+
+/* Run the daemon until SIGINT or SIGTERM, then print a summary */
+Status do_serve(ServeInfo *serveInfo);
+
+/* Send an encode or decode to a daemon (--connect), argv as for -e / -d */
+Status do_serve_client(ServeInfo *serveInfo, char *argv[]);
+
+/* Connect to a daemon socket (returns the descriptor, -1 on failure) */
+int serve_connect(const char *socket_path);
+
+/* Send one request with its descriptors and wait for the reply */
+Status serve_request(int sock, const ServeRequest *request, const int *fds, ServeReply *reply);
+
+#endif
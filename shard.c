@@ -0,0 +1,524 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include "shard.h"
+#include "encode.h"
+#include "decode.h"
+#include "common.h"
+#include "checksum.h"
+#include "lsb.h"
+#include "stats.h"
+#include "parallel.h"
+
+/*
+ * Little-endian store/load helpers
+ */
+static void put_le(unsigned char *p, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        p[i] = value >> (8 * i);
+}
+
+static uint64_t get_le(const unsigned char *p, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= (uint64_t)p[i] << (8 * i);
+    return value;
+}
+
+/*
+ * Serialize a shard record into its on-image byte layout
+ */
+void shard_record_pack(const ShardRecord *record, unsigned char out[SHARD_RECORD_SIZE])
+{
+    put_le(out, record->payload_id, 8);
+    put_le(out + 8, record->index, 4);
+    put_le(out + 12, record->count, 4);
+    put_le(out + 16, record->total_size, 8);
+    put_le(out + 24, record->offset, 8);
+    put_le(out + 32, crc32c(0, out, 32), 4);
+}
+
+/*
+ * Parse a shard record; the checksum must match and the slice
+ * (payload_size minus the record) must lie inside the secret
+ */
+Status shard_record_unpack(const unsigned char in[SHARD_RECORD_SIZE], uint64_t payload_size, ShardRecord *record)
+{
+    if (get_le(in + 32, 4) != crc32c(0, in, 32) || payload_size < SHARD_RECORD_SIZE)
+        return e_failure;
+
+    record->payload_id = get_le(in, 8);
+    record->index = get_le(in + 8, 4);
+    record->count = get_le(in + 12, 4);
+    record->total_size = get_le(in + 16, 8);
+    record->offset = get_le(in + 24, 8);
+    record->size = payload_size - SHARD_RECORD_SIZE;
+    if (record->index >= record->count || record->offset > record->total_size ||
+        record->size > record->total_size - record->offset)
+        return e_failure;
+    return e_success;
+}
+
+/*
+ * Collect the files from argv
+ * Encode: argv[2] is the secret, every later argument a cover
+ * Decode: every argument from argv[2] is a shard image
+ */
+Status read_shard_args(char *argv[], int argc, ShardInfo *shardInfo)
+{
+    char *bmp_ext[] = {".bmp"};
+    char *secret_ext[] = {".txt", ".c", ".h", ".sh"};
+    int first = 2;
+
+    if (shardInfo->lsb_bits < 0 || shardInfo->lsb_bits > LSB_MAX_BITS)
+    {
+        fprintf(stderr, "Error: --lsb must be between 1 and %d.\n\n", LSB_MAX_BITS);
+        return e_failure;
+    }
+    if (shardInfo->name == NULL || shardInfo->name[0] == '\0')
+    {
+        fprintf(stderr, "Error: --shard needs an output name.\n\n");
+        return e_failure;
+    }
+
+    // Validate secret file (allowed: .txt, .c, .h, .sh)
+    if (shardInfo->op == e_encode)
+    {
+        if (validate_file_extension(argv[2], secret_ext, 4) != e_success)
+        {
+            fprintf(stderr, "Error: Invalid secret file '%s'. Must be .txt, .c, .h, or .sh.\n\n", argv[2]);
+            return e_failure;
+        }
+        shardInfo->secret_fname = argv[2];
+        first = 3;
+    }
+    else
+    {
+        // Remove any extension from the provided output name
+        char *save;
+        shardInfo->name = strtok_r(shardInfo->name, ".", &save);
+        if (shardInfo->name == NULL)
+            return e_failure;
+    }
+
+    if (argc <= first)
+    {
+        fprintf(stderr, "Error: --shard needs at least one %s.\n\n", shardInfo->op == e_encode ? "cover" : "shard image");
+        return e_failure;
+    }
+    shardInfo->file_count = argc - first;
+    shardInfo->files = calloc(shardInfo->file_count, sizeof(ShardFile));
+    if (shardInfo->files == NULL)
+        return e_failure;
+
+    for (uint32_t i = 0; i < shardInfo->file_count; i++)
+    {
+        if (validate_file_extension(argv[first + i], bmp_ext, 1) != e_success)
+        {
+            fprintf(stderr, "Error: Invalid image '%s'. Must be a .bmp file.\n\n", argv[first + i]);
+            return e_failure;
+        }
+        shardInfo->files[i].fname = argv[first + i];
+    }
+    return e_success;
+}
+
+void free_shard(ShardInfo *shardInfo)
+{
+    free(shardInfo->files);
+    shardInfo->files = NULL;
+    shardInfo->file_count = 0;
+}
+
+/*
+ * Workers for the shard jobs: one per CPU unless -j says otherwise,
+ * never more than there are shards
+ */
+static ThreadPool *shard_pool(const ShardInfo *shardInfo, int *workers)
+{
+    *workers = shardInfo->threads > 0 ? shardInfo->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (*workers < 1)
+        *workers = 1;
+    if ((uint32_t)*workers > shardInfo->file_count)
+        *workers = shardInfo->file_count;
+    return pool_create(*workers);
+}
+
+/*
+ * Random identifier shared by the shards of one secret, so shards of
+ * different secrets are never mixed up
+ */
+static uint64_t shard_payload_id(void)
+{
+    uint64_t id;
+    if (getrandom(&id, sizeof(id), 0) == (ssize_t)sizeof(id))
+        return id;
+    return ((uint64_t)time(NULL) << 32) ^ ((uint64_t)getpid() << 16) ^ (uint64_t)clock();
+}
+
+/*
+ * Payload bytes a cover holds after the magic string, the stego header
+ * and the shard record (0 when it cannot even hold those)
+ */
+static Status shard_room(const char *fname, int bits, uint64_t *room)
+{
+    BmpInfo bmp;
+    FILE *fptr = fopen(fname, "rb");
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", fname);
+        return e_failure;
+    }
+    Status ret = bmp_read_header(fptr, &bmp);
+    fclose(fptr);
+    if (ret != e_success)
+    {
+        fprintf(stderr, "ERROR: %s is not an uncompressed 24/32-bit BMP\n", fname);
+        return e_failure;
+    }
+
+    uint64_t fixed = (strlen(MAGIC_STRING_V2) + STEG_HEADER_SIZE) * 8ULL;
+    uint64_t payload = bmp.capacity > fixed ? (bmp.capacity - fixed) * bits / 8 : 0;
+    *room = payload > SHARD_RECORD_SIZE ? payload - SHARD_RECORD_SIZE : 0;
+    return e_success;
+}
+
+/*
+ * Cut the secret into one slice per cover, in proportion to the cover
+ * capacities, so every shard job has about the same amount of work.
+ * Each slice is rounded up and the last ones take what is left, which
+ * never exceeds a cover because the secret fits in the total.
+ */
+static Status shard_plan(ShardInfo *shardInfo)
+{
+    int bits = shardInfo->lsb_bits ? shardInfo->lsb_bits : 1;
+    uint64_t *room = calloc(shardInfo->file_count, sizeof(uint64_t));
+    uint64_t total_room = 0;
+    struct stat st;
+
+    if (room == NULL)
+        return e_failure;
+    if (stat(shardInfo->secret_fname, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        fprintf(stderr, "ERROR: Unable to open file %s\n", shardInfo->secret_fname);
+        free(room);
+        return e_failure;
+    }
+    shardInfo->total_size = st.st_size;
+
+    // Step 1: Capacity of every cover
+    for (uint32_t i = 0; i < shardInfo->file_count; i++)
+    {
+        if (shard_room(shardInfo->files[i].fname, bits, &room[i]) != e_success)
+        {
+            free(room);
+            return e_failure;
+        }
+        total_room += room[i];
+    }
+    if (shardInfo->total_size > total_room)
+    {
+        fprintf(stderr, "ERROR: The secret needs %llu bytes, the covers hold %llu at %d-bit LSB\n",
+                (unsigned long long)shardInfo->total_size, (unsigned long long)total_room, bits);
+        free(room);
+        return e_failure;
+    }
+
+    // Step 2: Slices in proportion to the capacities
+    uint64_t payload_id = shard_payload_id();
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < shardInfo->file_count; i++)
+    {
+        ShardRecord *record = &shardInfo->files[i].record;
+        uint64_t left = shardInfo->total_size - offset;
+        uint64_t size = total_room ? (uint64_t)(((unsigned __int128)shardInfo->total_size * room[i] +
+                                                 total_room - 1) / total_room)
+                                   : 0;
+
+        record->payload_id = payload_id;
+        record->index = i;
+        record->count = shardInfo->file_count;
+        record->total_size = shardInfo->total_size;
+        record->offset = offset;
+        record->size = size < left ? size : left;
+        offset += record->size;
+    }
+    free(room);
+
+    // Step 3: Output names, which must not overwrite a cover
+    for (uint32_t i = 0; i < shardInfo->file_count; i++)
+    {
+        ShardFile *file = &shardInfo->files[i];
+        if (snprintf(file->output, sizeof(file->output), "%s_%u.bmp", shardInfo->name, i + 1) >=
+            (int)sizeof(file->output))
+            return e_failure;
+        for (uint32_t j = 0; j < shardInfo->file_count; j++)
+        {
+            if (strcmp(file->output, shardInfo->files[j].fname) == 0)
+            {
+                fprintf(stderr, "ERROR: Shard %s would overwrite a cover\n", file->output);
+                return e_failure;
+            }
+        }
+    }
+    return e_success;
+}
+
+/*
+ * Encode shards [begin, end) with the normal pipeline, quietly and
+ * single-threaded (the parallelism is across shards)
+ */
+static void shard_encode_task(void *ctx, size_t begin, size_t end)
+{
+    ShardInfo *shardInfo = ctx;
+    for (size_t i = begin; i < end; i++)
+    {
+        ShardFile *file = &shardInfo->files[i];
+        EncodeInfo enc_info = {0};
+        double start = stats_now();
+
+        enc_info.quiet = 1;
+        enc_info.src_image_fname = file->fname;
+        enc_info.secret_fname = shardInfo->secret_fname;
+        enc_info.stego_image_fname = file->output;
+        enc_info.lsb_bits = shardInfo->lsb_bits;
+        enc_info.shard = &file->record;
+        file->status = do_encoding(&enc_info);
+        close_files(&enc_info);
+        file->seconds = stats_now() - start;
+    }
+}
+
+/*
+ * Print the per-shard lines in shard order and the summary
+ */
+static Status report_shards(const ShardInfo *shardInfo, double elapsed)
+{
+    uint32_t ok = 0;
+    double job_time = 0;
+
+    for (uint32_t i = 0; i < shardInfo->file_count; i++)
+    {
+        const ShardFile *file = &shardInfo->files[i];
+        if (file->status == e_success)
+            ok++;
+        job_time += file->seconds;
+        printf("[%3u/%u] %s %-28s %s %-28s %12llu B @ %-12llu %9.2f ms\n",
+               file->record.index + 1, file->record.count, file->status == e_success ? "✅" : "❌",
+               file->fname, shardInfo->op == e_encode ? "->" : "<-",
+               shardInfo->op == e_encode ? file->output : shardInfo->output_fname,
+               (unsigned long long)file->record.size, (unsigned long long)file->record.offset,
+               file->seconds * 1000);
+    }
+
+    printf("\n-> Shards      : %u succeeded, %u failed\n", ok, shardInfo->file_count - ok);
+    printf("-> Wall time   : %.3f s (%.3f s of shard time)\n", elapsed, job_time);
+    if (elapsed > 0)
+        printf("-> Throughput  : %.2f MB/s payload\n", shardInfo->total_size / (1024.0 * 1024.0) / elapsed);
+    return ok == shardInfo->file_count ? e_success : e_failure;
+}
+
+/*
+ * Split the secret over the covers and encode every shard on the pool
+ */
+Status do_shard_encoding(ShardInfo *shardInfo)
+{
+    int workers;
+
+    // Step 1: Size the slices from the cover capacities
+    if (shard_plan(shardInfo) != e_success)
+        return e_failure;
+    printf("-> Step 1: Secret of %llu bytes split into %u shards.\n",
+           (unsigned long long)shardInfo->total_size, shardInfo->file_count);
+
+    // Step 2: Encode the shards in parallel
+    ThreadPool *pool = shard_pool(shardInfo, &workers);
+    printf("-> Step 2: Encoding %u shards on %d workers.\n\n", shardInfo->file_count, workers);
+    double start = stats_now();
+    pool_for(pool, shardInfo->file_count, 1, shard_encode_task, shardInfo);
+    double elapsed = stats_now() - start;
+    pool_destroy(pool);
+
+    return report_shards(shardInfo, elapsed);
+}
+
+/*
+ * Open a shard image and decode its stego header and shard record
+ */
+static Status shard_open(DecodeInfo *dec_info, ShardFile *file)
+{
+    dec_info->quiet = 1;
+    dec_info->stego_image_fname = file->fname;
+    dec_info->secret_fname = "-"; // Only record the extension, no output name
+
+    if (open_decoded_files(dec_info) != e_success || skip_bmp_header(dec_info) != e_success ||
+        decode_magic_string(dec_info) != e_success || dec_info->version != STEG_VERSION ||
+        decode_stego_header(dec_info) != e_success || decode_shard_record(dec_info) != e_success)
+        return e_failure;
+    file->header = dec_info->header;
+    return e_success;
+}
+
+static void shard_read_task(void *ctx, size_t begin, size_t end)
+{
+    ShardInfo *shardInfo = ctx;
+    for (size_t i = begin; i < end; i++)
+    {
+        ShardFile *file = &shardInfo->files[i];
+        DecodeInfo dec_info = {0};
+        file->status = shard_open(&dec_info, file);
+        file->record = dec_info.shard;
+        close_decoded_files(&dec_info);
+    }
+}
+
+static int compare_shard_files(const void *a, const void *b)
+{
+    uint32_t x = ((const ShardFile *)a)->record.index, y = ((const ShardFile *)b)->record.index;
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * The shards must come from one secret and cover it exactly: same
+ * identifier, count, size and extension, every index once, and each
+ * slice starting where the one before it ends
+ */
+static Status shard_check_set(ShardInfo *shardInfo)
+{
+    for (uint32_t i = 0; i < shardInfo->file_count; i++)
+    {
+        if (shardInfo->files[i].status != e_success)
+        {
+            fprintf(stderr, "ERROR: %s is not a shard image, or its header is corrupted\n", shardInfo->files[i].fname);
+            return e_failure;
+        }
+    }
+    qsort(shardInfo->files, shardInfo->file_count, sizeof(ShardFile), compare_shard_files);
+
+    const ShardFile *first = &shardInfo->files[0];
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < shardInfo->file_count; i++)
+    {
+        const ShardFile *file = &shardInfo->files[i];
+        if (file->record.payload_id != first->record.payload_id || file->record.count != first->record.count ||
+            file->record.total_size != first->record.total_size || strcmp(file->header.extn, first->header.extn) != 0)
+        {
+            fprintf(stderr, "ERROR: %s is a shard of another secret than %s\n", file->fname, first->fname);
+            return e_failure;
+        }
+        if (i > 0 && file->record.index == shardInfo->files[i - 1].record.index)
+        {
+            fprintf(stderr, "ERROR: Shard %u is given twice (%s)\n", file->record.index + 1, file->fname);
+            return e_failure;
+        }
+        if (file->record.index != i)
+        {
+            fprintf(stderr, "ERROR: Shard %u of %u is missing\n", i + 1, first->record.count);
+            return e_failure;
+        }
+        if (file->record.offset != offset)
+        {
+            fprintf(stderr, "ERROR: Shard %u does not continue where shard %u ends\n", i + 1, i);
+            return e_failure;
+        }
+        offset += file->record.size;
+    }
+    if (shardInfo->file_count != first->record.count || offset != first->record.total_size)
+    {
+        fprintf(stderr, "ERROR: Shard %u of %u is missing\n", shardInfo->file_count + 1, first->record.count);
+        return e_failure;
+    }
+    shardInfo->total_size = offset;
+    return e_success;
+}
+
+/*
+ * Decode shards [begin, end): each job reopens its image and writes its
+ * slice through its own handle at the slice offset
+ */
+static void shard_decode_task(void *ctx, size_t begin, size_t end)
+{
+    ShardInfo *shardInfo = ctx;
+    for (size_t i = begin; i < end; i++)
+    {
+        ShardFile *file = &shardInfo->files[i];
+        DecodeInfo dec_info = {0};
+        double start = stats_now();
+
+        file->status = e_failure;
+        if (shard_open(&dec_info, file) == e_success && dec_info.shard.payload_id == file->record.payload_id &&
+            dec_info.shard.index == file->record.index)
+        {
+            dec_info.fptr_secret = fopen(shardInfo->output_fname, "r+b");
+            if (dec_info.fptr_secret == NULL)
+            {
+                perror("fopen");
+                fprintf(stderr, "ERROR: Unable to open file %s\n", shardInfo->output_fname);
+            }
+            else
+            {
+                if (fseeko(dec_info.fptr_secret, file->record.offset, SEEK_SET) == 0 &&
+                    decode_secret_file_shard(&dec_info) == e_success && verify_payload_crc(&dec_info) == e_success)
+                    file->status = e_success;
+                if (fclose(dec_info.fptr_secret) != 0)
+                    file->status = e_failure;
+            }
+        }
+        close_decoded_files(&dec_info);
+        file->seconds = stats_now() - start;
+    }
+}
+
+/*
+ * Reassemble a secret from its shards, given in any order: every header
+ * is read and the set checked before anything is written, then the
+ * slices are decoded on the pool straight to their offsets
+ */
+Status do_shard_decoding(ShardInfo *shardInfo)
+{
+    int workers;
+    ThreadPool *pool = shard_pool(shardInfo, &workers);
+
+    // Step 1: Headers and shard records of every image
+    double start = stats_now();
+    pool_for(pool, shardInfo->file_count, 1, shard_read_task, shardInfo);
+    if (shard_check_set(shardInfo) != e_success)
+    {
+        pool_destroy(pool);
+        return e_failure;
+    }
+    printf("-> Step 1: %u shards of a %llu-byte secret (extension %s) checked successfully.\n",
+           shardInfo->file_count, (unsigned long long)shardInfo->total_size, shardInfo->files[0].header.extn);
+
+    // Step 2: Output file at its final size
+    const char *extn = shardInfo->files[0].header.extn;
+    FILE *fptr = NULL;
+    if (strchr(extn, '/') != NULL ||
+        snprintf(shardInfo->output_fname, sizeof(shardInfo->output_fname), "%s%s", shardInfo->name, extn) >=
+            (int)sizeof(shardInfo->output_fname) ||
+        (fptr = fopen(shardInfo->output_fname, "w")) == NULL || ftruncate(fileno(fptr), shardInfo->total_size) != 0)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to create file %s\n", shardInfo->output_fname);
+        if (fptr != NULL)
+            fclose(fptr);
+        pool_destroy(pool);
+        return e_failure;
+    }
+    fclose(fptr);
+
+    // Step 3: Decode the slices in parallel
+    printf("-> Step 2: Decoding %u shards on %d workers.\n\n", shardInfo->file_count, workers);
+    pool_for(pool, shardInfo->file_count, 1, shard_decode_task, shardInfo);
+    double elapsed = stats_now() - start;
+    pool_destroy(pool);
+
+    return report_shards(shardInfo, elapsed);
+}
@@ -0,0 +1,87 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"  // Contains user defined types
+#include "header.h" // Versioned stego header
+
+/*
+ * Sharded payloads (--shard)
+ * --------------------------
+ * A secret too large for one cover is cut into one contiguous slice per
+ * cover, sized in proportion to each cover's capacity. Every shard is a
+ * normal stego image whose header carries STEG_FLAG_SHARD; its payload
+ * is a shard record followed by the slice (payload_size and payload_crc
+ * cover both). The record, little-endian:
+ *
+ *   offset size field
+ *   0      8    payload_id   (random, the same in every shard of a secret)
+ *   8      4    shard_index  (0-based)
+ *   12     4    shard_count
+ *   16     8    total_size   (size of the whole secret)
+ *   24     8    offset       (first secret byte of this slice)
+ *   32     4    record_crc   (CRC-32C of bytes 0..31)
+ *
+ * The slice size is payload_size minus the record. The shards are
+ * independent images, so they are encoded and decoded on the thread
+ * pool, and the decoder puts the slices back by their offsets whatever
+ * order the files are given in.
+ */
+
+/* Bytes of the shard record (a multiple of every LSB depth, so the
+   slice starts on a fresh k-LSB group) */
+#define SHARD_RECORD_SIZE 36
+
+typedef struct _ShardRecord
+{
+    uint64_t payload_id;   // Identifies the secret the shard belongs to
+    uint32_t index;        // Position of the shard (0-based)
+    uint32_t count;        // Number of shards of the secret
+    uint64_t total_size;   // Size of the whole secret
+    uint64_t offset;       // First secret byte of the slice
+    uint64_t size;         // Slice size (not stored: payload_size - SHARD_RECORD_SIZE)
+} ShardRecord;
+
+typedef struct _ShardFile
+{
+    char *fname;           // Cover (encode) or shard image (decode)
+    char output[256];      // Shard image written (encode)
+    ShardRecord record;    // Slice of the secret
+    StegHeader header;     // Stego header read back (decode)
+    Status status;         // Result of the shard job
+    double seconds;        // Wall time of the shard job
+} ShardFile;
+
+typedef struct _ShardInfo
+{
+    OperationType op;      // e_encode or e_decode
+    char *secret_fname;    // Secret to split (encode)
+    char *name;            // Output prefix (encode) or output name (decode)
+    char output_fname[256]; // Reassembled secret with its extension (decode)
+    ShardFile *files;      // One per cover or shard image
+    uint32_t file_count;   // Number of files
+    uint64_t total_size;   // Size of the secret
+    int lsb_bits;          // --lsb for every shard (0 = 1)
+    int threads;           // Worker threads (0 = one per online CPU)
+} ShardInfo;
+
+/* Collect the covers (encode) or shard images (decode) from argv */
+Status read_shard_args(char *argv[], int argc, ShardInfo *shardInfo);
+
+/* Split the secret over the covers and encode every shard in parallel */
+Status do_shard_encoding(ShardInfo *shardInfo);
+
+/* Check the shard set and reassemble the secret, decoding in parallel */
+Status do_shard_decoding(ShardInfo *shardInfo);
+
+/* Serialize a shard record (computes record_crc) */
+void shard_record_pack(const ShardRecord *record, unsigned char out[SHARD_RECORD_SIZE]);
+
+/* Parse a shard record, checking record_crc and its fields */
+Status shard_record_unpack(const unsigned char in[SHARD_RECORD_SIZE], uint64_t payload_size, ShardRecord *record);
+
+/* Release the file list */
+void free_shard(ShardInfo *shardInfo);
+
+#endif
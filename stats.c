@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "stats.h"
+
+/*
+ * Returns the current monotonic time in seconds
+ */
+double stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Read wall time and the process I/O counters.
+ * /proc/self/io covers every thread, so pool workers are included.
+ */
+static int stats_snapshot(IoSnapshot *snap)
+{
+    char buffer[512];
+    ssize_t len = -1;
+
+    int fd = open("/proc/self/io", O_RDONLY);
+    if (fd >= 0)
+    {
+        len = read(fd, buffer, sizeof(buffer) - 1);
+        close(fd);
+    }
+    snap->time = stats_now();
+    if (len <= 0)
+        return 0;
+
+    buffer[len] = '\0';
+    snap->probe_bytes = len;
+    char *rchar = strstr(buffer, "rchar:"), *wchar = strstr(buffer, "wchar:");
+    char *syscr = strstr(buffer, "syscr:"), *syscw = strstr(buffer, "syscw:");
+    if (rchar == NULL || wchar == NULL || syscr == NULL || syscw == NULL)
+        return 0;
+    snap->rchar = strtoull(rchar + 6, NULL, 10);
+    snap->wchar = strtoull(wchar + 6, NULL, 10);
+    snap->syscr = strtoull(syscr + 6, NULL, 10);
+    snap->syscw = strtoull(syscw + 6, NULL, 10);
+    return 1;
+}
+
+/*
+ * Take the snapshot a stage is measured from
+ */
+void stats_begin(StegStats *stats)
+{
+    if (stats == NULL)
+        return;
+
+    // Pending console output belongs to the previous step, not this stage
+    fflush(stdout);
+    stats->io_available = stats_snapshot(&stats->start);
+    stats->start.ring_read = stats->async.ring_read;
+    stats->start.ring_written = stats->async.ring_written;
+    stats->start.ring_reads = stats->async.ring_reads;
+    stats->start.ring_writes = stats->async.ring_writes;
+}
+
+/*
+ * Record the stage started by stats_begin and pass its status through
+ */
+Status stats_end(StegStats *stats, const char *name, Status status)
+{
+    IoSnapshot end;
+    if (stats == NULL || stats->count >= STATS_MAX_STAGES)
+        return status;
+
+    int io = stats_snapshot(&end) && stats->io_available;
+    StageStats *stage = &stats->stages[stats->count++];
+    memset(stage, 0, sizeof(*stage));
+    stage->name = name;
+    stage->status = status;
+    stage->seconds = end.time - stats->start.time;
+    if (io)
+    {
+        // The read() of the starting snapshot is counted in the end snapshot
+        stage->bytes_read = end.rchar - stats->start.rchar - stats->start.probe_bytes;
+        stage->bytes_written = end.wchar - stats->start.wchar;
+        stage->read_calls = end.syscr - stats->start.syscr - 1;
+        stage->write_calls = end.syscw - stats->start.syscw;
+
+        // io_uring requests bypass the read/write paths /proc/self/io counts
+        const AsyncStats *async = &stats->async;
+        stage->bytes_read += async->ring_read - stats->start.ring_read;
+        stage->bytes_written += async->ring_written - stats->start.ring_written;
+        stage->read_calls += async->ring_reads - stats->start.ring_reads;
+        stage->write_calls += async->ring_writes - stats->start.ring_writes;
+    }
+    else
+    {
+        stats->io_available = 0;
+    }
+    return status;
+}
+
+/*
+ * Share of the asynchronous I/O time the encoder did not wait for
+ */
+static double stats_overlap(const AsyncStats *async)
+{
+    if (async->io_seconds <= 0 || async->wait_seconds >= async->io_seconds)
+        return 0;
+    return 1 - async->wait_seconds / async->io_seconds;
+}
+
+/*
+ * Print a table of the recorded stages
+ */
+void stats_print(const StegStats *stats, const char *operation, FILE *fptr)
+{
+    double seconds = 0;
+    uint64_t read = 0, written = 0, calls = 0;
+
+    fprintf(fptr, "\n📊 %s stage statistics\n", operation);
+    fprintf(fptr, "   %-14s %12s %14s %14s %10s %10s\n", "stage", "wall ms", "bytes read",
+            "bytes written", "reads", "writes");
+    for (int i = 0; i < stats->count; i++)
+    {
+        const StageStats *s = &stats->stages[i];
+        fprintf(fptr, "   %-14s %12.3f %14llu %14llu %10llu %10llu%s\n", s->name, s->seconds * 1000,
+                (unsigned long long)s->bytes_read, (unsigned long long)s->bytes_written,
+                (unsigned long long)s->read_calls, (unsigned long long)s->write_calls,
+                s->status == e_success ? "" : "  (failed)");
+        seconds += s->seconds;
+        read += s->bytes_read;
+        written += s->bytes_written;
+        calls += s->read_calls + s->write_calls;
+    }
+    fprintf(fptr, "   %-14s %12.3f %14llu %14llu %21llu\n", "total", seconds * 1000,
+            (unsigned long long)read, (unsigned long long)written, (unsigned long long)calls);
+    if (!stats->io_available)
+        fprintf(fptr, "   (I/O counters unavailable: /proc/self/io could not be read)\n");
+
+    // I/O that ran while blocks were embedded was hidden from the wall time
+    const AsyncStats *a = &stats->async;
+    if (a->engine != NULL)
+    {
+        fprintf(fptr, "   async I/O (%s): %llu reads, %llu writes, %.3f ms in flight, %.3f ms waited, %.1f%% overlapped\n",
+                a->engine, (unsigned long long)a->reads, (unsigned long long)a->writes, a->io_seconds * 1000,
+                a->wait_seconds * 1000, stats_overlap(a) * 100);
+    }
+}
+
+/*
+ * Write the recorded stages as one JSON object
+ */
+void stats_print_json(const StegStats *stats, const char *operation, FILE *fptr)
+{
+    fprintf(fptr, "{\"operation\":\"%s\",\"io_counters\":%s,\"stages\":[", operation,
+            stats->io_available ? "true" : "false");
+    for (int i = 0; i < stats->count; i++)
+    {
+        const StageStats *s = &stats->stages[i];
+        fprintf(fptr, "%s{\"stage\":\"%s\",\"ok\":%s,\"wall_ms\":%.6f,\"bytes_read\":%llu,"
+                      "\"bytes_written\":%llu,\"read_calls\":%llu,\"write_calls\":%llu}",
+                i ? "," : "", s->name, s->status == e_success ? "true" : "false", s->seconds * 1000,
+                (unsigned long long)s->bytes_read, (unsigned long long)s->bytes_written,
+                (unsigned long long)s->read_calls, (unsigned long long)s->write_calls);
+    }
+    fprintf(fptr, "]");
+    if (stats->async.engine != NULL)
+        fprintf(fptr, ",\"async_io\":{\"engine\":\"%s\",\"reads\":%llu,\"writes\":%llu,\"io_ms\":%.6f,"
+                      "\"wait_ms\":%.6f,\"overlap\":%.4f}",
+                stats->async.engine, (unsigned long long)stats->async.reads,
+                (unsigned long long)stats->async.writes, stats->async.io_seconds * 1000,
+                stats->async.wait_seconds * 1000, stats_overlap(&stats->async));
+    fprintf(fptr, "}\n");
+}
@@ -0,0 +1,79 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "types.h" // Contains user defined types
+
+/* Largest number of stages one operation can record */
+#define STATS_MAX_STAGES 12
+
+/* Counters of one pipeline stage */
+typedef struct _StageStats
+{
+    const char *name;       // Stage name ("header_copy", "data", ...)
+    Status status;          // Result of the stage
+    double seconds;         // Wall time
+    uint64_t bytes_read;    // Bytes moved by read-type system calls
+    uint64_t bytes_written; // Bytes moved by write-type system calls
+    uint64_t read_calls;    // read/pread/copy_file_range/sendfile calls
+    uint64_t write_calls;   // write/pwrite/copy_file_range/sendfile calls
+} StageStats;
+
+/* Process I/O counters at one point in time (from /proc/self/io) */
+typedef struct _IoSnapshot
+{
+    double time;
+    uint64_t rchar, wchar;
+    uint64_t syscr, syscw;
+    uint64_t probe_bytes; // Bytes the snapshot itself read from /proc
+    uint64_t ring_read, ring_written; // AsyncStats counters of the same name
+    uint64_t ring_reads, ring_writes;
+} IoSnapshot;
+
+/* Requests of the asynchronous block pipeline (iopipe.h) */
+typedef struct _AsyncStats
+{
+    const char *engine;   // "io_uring" or "I/O thread", NULL when not used
+    uint64_t reads;       // Cover blocks read ahead
+    uint64_t writes;      // Stego blocks written behind
+    double io_seconds;    // Submission to completion, all requests
+    double wait_seconds;  // Time the encoder was blocked on them
+    uint64_t ring_read;   // Bytes read through io_uring, and written:
+    uint64_t ring_written; // /proc/self/io misses them, stats_end adds them
+    uint64_t ring_reads;  // io_uring requests behind those bytes
+    uint64_t ring_writes;
+} AsyncStats;
+
+/* Stage timings of one encode or decode */
+typedef struct _StegStats
+{
+    StageStats stages[STATS_MAX_STAGES];
+    int count;
+    int io_available;     // 0 when /proc/self/io cannot be read
+    IoSnapshot start;     // Snapshot taken by stats_begin
+    AsyncStats async;     // Overlap of the asynchronous pipeline
+} StegStats;
+
+/*
+ * Time a stage: STATS_STAGE(stats, "magic", encode_magic_string(...))
+ * evaluates to the Status of the call. stats may be NULL.
+ */
+#define STATS_STAGE(stats, name, call) (stats_begin(stats), stats_end((stats), (name), (call)))
+
+/* Current monotonic time in seconds */
+double stats_now(void);
+
+/* Take the snapshot a stage is measured from */
+void stats_begin(StegStats *stats);
+
+/* Record the stage started by stats_begin and pass its status through */
+Status stats_end(StegStats *stats, const char *name, Status status);
+
+/* Print a table of the recorded stages */
+void stats_print(const StegStats *stats, const char *operation, FILE *fptr);
+
+/* Write the recorded stages as one JSON object */
+void stats_print_json(const StegStats *stats, const char *operation, FILE *fptr);
+
+#endif
@@ -0,0 +1,332 @@
+#include <stdlib.h>
+#include <string.h>
+#include "steg.h"
+#include "common.h"
+#include "bmp.h"
+#include "lsb.h"
+#include "stream.h"
+#include "lz.h"
+#include "checksum.h"
+
+/* Payload bytes handled per gather/scatter pass on padded images */
+#define STEG_MEM_SLICE 4096
+
+/*
+ * Embed n payload bytes starting at carrier byte carrier, bits per carrier
+ */
+static void steg_embed_at(const BmpInfo *bmp, unsigned char *image, uint64_t carrier,
+                          const unsigned char *data, size_t n, int bits)
+{
+    char *pixels = (char *)image + bmp->data_offset;
+    if (bmp_is_contiguous(bmp))
+    {
+        lsb_embed_bits(pixels + carrier, (const char *)data, n, bits);
+        return;
+    }
+
+    // Row padding: work on a gathered copy of the carriers, whole groups at a time
+    char carriers[STEG_MEM_SLICE * 8];
+    while (n > 0)
+    {
+        size_t len = n < (size_t)STEG_MEM_SLICE * bits ? n : (size_t)STEG_MEM_SLICE * bits;
+        size_t count = lsb_carriers(len, bits);
+        bmp_gather(bmp, pixels, 0, carrier, count, carriers);
+        lsb_embed_bits(carriers, (const char *)data, len, bits);
+        bmp_scatter(bmp, pixels, 0, carrier, count, carriers);
+        carrier += count;
+        data += len;
+        n -= len;
+    }
+}
+
+/*
+ * Extract n payload bytes starting at carrier byte carrier, bits per carrier
+ */
+static void steg_extract_at(const BmpInfo *bmp, const unsigned char *image, uint64_t carrier,
+                            unsigned char *data, size_t n, int bits)
+{
+    const char *pixels = (const char *)image + bmp->data_offset;
+    if (bmp_is_contiguous(bmp))
+    {
+        lsb_extract_bits((char *)data, pixels + carrier, n, bits);
+        return;
+    }
+
+    char carriers[STEG_MEM_SLICE * 8];
+    while (n > 0)
+    {
+        size_t len = n < (size_t)STEG_MEM_SLICE * bits ? n : (size_t)STEG_MEM_SLICE * bits;
+        size_t count = lsb_carriers(len, bits);
+        bmp_gather(bmp, pixels, 0, carrier, count, carriers);
+        lsb_extract_bits((char *)data, carriers, len, bits);
+        carrier += count;
+        data += len;
+        n -= len;
+    }
+}
+
+/*
+ * Payload bytes a BMP cover can carry
+ */
+uint64_t steg_capacity_mem(const void *cover, size_t cover_len)
+{
+    return steg_capacity_mem_bits(cover, cover_len, 1);
+}
+
+uint64_t steg_capacity_mem_bits(const void *cover, size_t cover_len, int lsb_bits)
+{
+    BmpInfo bmp;
+    uint64_t overhead = (strlen(MAGIC_STRING_V2) + STEG_HEADER_SIZE) * 8;
+
+    if (lsb_bits < 1 || lsb_bits > LSB_MAX_BITS ||
+        bmp_parse_header(cover, cover_len, cover_len, &bmp) != e_success || bmp.capacity < overhead)
+        return 0;
+    return (bmp.capacity - overhead) * lsb_bits / 8;
+}
+
+/*
+ * Hide secret inside cover, writing the stego image to out
+ */
+Status steg_encode_mem(const void *cover, size_t cover_len, const void *secret, size_t secret_len,
+                       void *out, const char *extn)
+{
+    return steg_encode_mem_bits(cover, cover_len, secret, secret_len, out, extn, 1);
+}
+
+Status steg_encode_mem_bits(const void *cover, size_t cover_len, const void *secret, size_t secret_len,
+                            void *out, const char *extn, int lsb_bits)
+{
+    BmpInfo bmp;
+    StegHeader header = {0};
+    unsigned char packed[STEG_HEADER_SIZE];
+    size_t magic_len = strlen(MAGIC_STRING_V2);
+
+    // Step 1: Validate the cover and the extension
+    if (cover == NULL || out == NULL || (secret == NULL && secret_len > 0) ||
+        bmp_parse_header(cover, cover_len, cover_len, &bmp) != e_success)
+        return e_failure;
+    if (extn != NULL && strlen(extn) > STEG_MAX_EXTN)
+        return e_failure;
+
+    // Step 2: Check capacity
+    if ((uint64_t)secret_len > steg_capacity_mem_bits(cover, cover_len, lsb_bits))
+        return e_failure;
+
+    // Step 3: Start from an exact copy (header, padding and tail included)
+    if (out != cover)
+        memcpy(out, cover, cover_len);
+
+    // Step 4: Magic string, stego header and secret data
+    header.version = STEG_VERSION;
+    header.flags = STEG_FLAG_CRC;
+    header.lsb_bits = lsb_bits;
+    if (extn != NULL)
+    {
+        header.extn_len = strlen(extn);
+        memcpy(header.extn, extn, header.extn_len);
+    }
+    header.payload_size = secret_len;
+    header.payload_crc = crc32c(0, secret, secret_len);
+    steg_header_pack(&header, packed);
+
+    steg_embed_at(&bmp, out, 0, (const unsigned char *)MAGIC_STRING_V2, magic_len, 1);
+    steg_embed_at(&bmp, out, magic_len * 8, packed, STEG_HEADER_SIZE, 1);
+    steg_embed_at(&bmp, out, (magic_len + STEG_HEADER_SIZE) * 8, secret, secret_len, lsb_bits);
+    return e_success;
+}
+
+/*
+ * Read the original header layout: 32-bit extension size, extension
+ * characters and 32-bit secret size
+ */
+static Status steg_decode_legacy_header(const BmpInfo *bmp, const unsigned char *image, uint64_t *carrier,
+                                        StegHeader *header)
+{
+    unsigned char value[4];
+
+    if (*carrier + 32 > bmp->capacity)
+        return e_failure;
+    steg_extract_at(bmp, image, *carrier, value, 4, 1);
+    *carrier += 32;
+    uint32_t extn_len = value[0] | value[1] << 8 | value[2] << 16 | (uint32_t)value[3] << 24;
+    if (extn_len > 4 || *carrier + (extn_len + 4) * 8 > bmp->capacity)
+        return e_failure;
+
+    header->extn_len = extn_len;
+    steg_extract_at(bmp, image, *carrier, (unsigned char *)header->extn, extn_len, 1);
+    header->extn[extn_len] = '\0';
+    *carrier += extn_len * 8;
+
+    steg_extract_at(bmp, image, *carrier, value, 4, 1);
+    *carrier += 32;
+    int32_t size = value[0] | value[1] << 8 | value[2] << 16 | (uint32_t)value[3] << 24;
+    if (size < 0)
+        return e_failure;
+    header->payload_size = size;
+    return e_success;
+}
+
+/*
+ * Walk the length-prefixed frames of a --stream or --compress payload,
+ * adding up their (decompressed) sizes and copying the data to out when
+ * it is not NULL (out holds cap bytes). *next is moved past the end
+ * marker.
+ */
+static Status steg_decode_frames(const BmpInfo *bmp, const unsigned char *image, uint64_t *next,
+                                 int bits, int compressed, unsigned char *out, uint64_t cap, uint64_t *size)
+{
+    uint64_t carrier = *next;
+    unsigned char value[STREAM_FRAME_LEN_SIZE];
+    uint64_t total = 0;
+    size_t field = lsb_carriers(STREAM_FRAME_LEN_SIZE, bits);
+    Status ret = e_success;
+
+    // LZ frames are extracted and expanded in a scratch block
+    unsigned char *packed = compressed ? malloc(2 * LZ_BLOCK_SIZE) : NULL;
+    unsigned char *block = packed != NULL ? packed + LZ_BLOCK_SIZE : NULL;
+    if (compressed && packed == NULL)
+        return e_failure;
+
+    while (ret == e_success)
+    {
+        if (carrier + field > bmp->capacity)
+        {
+            ret = e_failure;
+            break;
+        }
+        steg_extract_at(bmp, image, carrier, value, STREAM_FRAME_LEN_SIZE, bits);
+        carrier += field;
+        uint32_t len = value[0] | value[1] << 8 | value[2] << 16 | (uint32_t)value[3] << 24;
+        if (len == 0)
+            break;
+
+        size_t stored = compressed ? len & ~LZ_FRAME_STORED : len;
+        if ((compressed && stored > LZ_BLOCK_SIZE) || lsb_carriers(stored, bits) > bmp->capacity - carrier)
+        {
+            ret = e_failure;
+            break;
+        }
+        if (!compressed)
+        {
+            if (out != NULL && total + len <= cap)
+                steg_extract_at(bmp, image, carrier, out + total, len, bits);
+            else if (out != NULL)
+                ret = e_failure;
+            total += len;
+        }
+        else
+        {
+            size_t n = stored;
+            steg_extract_at(bmp, image, carrier, packed, stored, bits);
+            const unsigned char *data = packed;
+            if (!(len & LZ_FRAME_STORED))
+            {
+                ret = lz_decompress(packed, stored, block, LZ_BLOCK_SIZE, &n);
+                data = block;
+            }
+            if (out != NULL && total + n <= cap)
+                memcpy(out + total, data, n);
+            else if (out != NULL)
+                ret = e_failure;
+            total += n;
+        }
+        carrier += lsb_carriers(stored, bits);
+    }
+
+    free(packed);
+    *size = total;
+    *next = carrier;
+    return ret;
+}
+
+/*
+ * Recover the secret from a stego image
+ */
+Status steg_decode_mem(const void *stego, size_t stego_len, void *secret, size_t secret_cap,
+                       size_t *secret_len, char extn[STEG_MAX_EXTN + 1])
+{
+    BmpInfo bmp;
+    StegHeader header = {0};
+    unsigned char magic[2], packed[STEG_HEADER_SIZE];
+    uint64_t carrier = sizeof(magic) * 8;
+
+    // Step 1: Parse the BMP header and read the magic string
+    if (stego == NULL || secret_len == NULL ||
+        bmp_parse_header(stego, stego_len, stego_len, &bmp) != e_success || bmp.capacity < carrier)
+        return e_failure;
+    steg_extract_at(&bmp, stego, 0, magic, sizeof(magic), 1);
+
+    // Step 2: Decode the header fields (layout depends on the magic string)
+    if (memcmp(magic, MAGIC_STRING_V2, sizeof(magic)) == 0)
+    {
+        if (carrier + STEG_HEADER_SIZE * 8 > bmp.capacity)
+            return e_failure;
+        steg_extract_at(&bmp, stego, carrier, packed, STEG_HEADER_SIZE, 1);
+        carrier += STEG_HEADER_SIZE * 8;
+        if (steg_header_unpack(packed, &header) != e_success || header.lsb_bits < 1 ||
+            header.lsb_bits > LSB_MAX_BITS)
+            return e_failure;
+    }
+    else
+    {
+        // Original images treat everything after bfOffBits as carriers
+        bmp_set_raw(&bmp);
+        if (memcmp(magic, MAGIC_STRING, sizeof(magic)) != 0 ||
+            steg_decode_legacy_header(&bmp, stego, &carrier, &header) != e_success)
+            return e_failure;
+    }
+
+    // Streamed payloads only record their size in the frames; compressed
+    // ones may expand beyond the capacity, so their frames are checked
+    int bits = header.lsb_bits ? header.lsb_bits : 1;
+    int compressed = (header.flags & STEG_FLAG_LZ) != 0;
+    int framed = (header.flags & (STEG_FLAG_STREAM | STEG_FLAG_LZ)) != 0;
+    uint64_t payload_size = header.payload_size;
+    // Scattered and encrypted payloads need the key or password, which
+    // this API does not take
+    if (header.flags & (~STEG_FLAGS_KNOWN | STEG_FLAG_SCATTER | STEG_FLAG_CIPHER))
+        return e_failure;
+    uint64_t end = carrier;
+    if (framed && steg_decode_frames(&bmp, stego, &end, bits, compressed, NULL, 0, &header.payload_size) != e_success)
+        return e_failure;
+    if ((header.flags & STEG_FLAG_STREAM) == 0 && header.payload_size != payload_size)
+        return e_failure;
+    if (header.payload_size > SIZE_MAX ||
+        (!framed && (header.payload_size > (bmp.capacity - carrier) / 8 * bits ||
+                     lsb_carriers(header.payload_size, bits) > bmp.capacity - carrier)))
+        return e_failure;
+
+    *secret_len = header.payload_size;
+    if (extn != NULL)
+        memcpy(extn, header.extn, STEG_MAX_EXTN + 1);
+
+    // Step 3: Extract the secret into the caller's buffer
+    if (header.payload_size > secret_cap || (secret == NULL && header.payload_size > 0))
+        return e_failure;
+    if (framed)
+    {
+        if (steg_decode_frames(&bmp, stego, &carrier, bits, compressed, secret, secret_cap,
+                               &header.payload_size) != e_success)
+            return e_failure;
+    }
+    else
+    {
+        steg_extract_at(&bmp, stego, carrier, secret, header.payload_size, bits);
+    }
+
+    // Step 4: Verify the payload CRC (after the end marker in --stream images)
+    if (header.flags & STEG_FLAG_CRC)
+    {
+        if (header.flags & STEG_FLAG_STREAM)
+        {
+            unsigned char value[STREAM_FRAME_LEN_SIZE];
+            if (carrier + lsb_carriers(STREAM_FRAME_LEN_SIZE, bits) > bmp.capacity)
+                return e_failure;
+            steg_extract_at(&bmp, stego, carrier, value, STREAM_FRAME_LEN_SIZE, bits);
+            header.payload_crc = value[0] | value[1] << 8 | value[2] << 16 | (uint32_t)value[3] << 24;
+        }
+        if (crc32c(0, secret, header.payload_size) != header.payload_crc)
+            return e_failure;
+    }
+    return e_success;
+}
@@ -0,0 +1,55 @@
+#ifndef STEG_H
+#define STEG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"  // Contains user defined types
+#include "header.h" // Versioned stego header
+
+/*
+ * libsteg
+ * -------
+ * In-memory encode/decode for programs that embed the engine instead of
+ * running the CLI. Every function works only on the buffers it is given:
+ * no files, no globals and no console output, so calls are reentrant and
+ * may run concurrently from any number of threads.
+ *
+ * The image layout is the same as the CLI's, so a cover encoded here
+ * decodes with "-d" and vice versa.
+ */
+
+/* Payload bytes a BMP cover can carry (0 if the cover is not a usable BMP) */
+uint64_t steg_capacity_mem(const void *cover, size_t cover_len);
+
+/* Same at lsb_bits (1..4) payload bits per pixel byte */
+uint64_t steg_capacity_mem_bits(const void *cover, size_t cover_len, int lsb_bits);
+
+/*
+ * Hide secret inside cover. out must hold cover_len bytes (it may be the
+ * cover itself); extn is the extension recorded for the secret (".txt",
+ * or NULL for none).
+ */
+Status steg_encode_mem(const void *cover, size_t cover_len, const void *secret, size_t secret_len,
+                       void *out, const char *extn);
+
+/* Same with lsb_bits (1..4) payload bits per pixel byte (k-LSB) */
+Status steg_encode_mem_bits(const void *cover, size_t cover_len, const void *secret, size_t secret_len,
+                            void *out, const char *extn, int lsb_bits);
+
+/*
+ * Recover the secret from a stego image into secret (secret_cap bytes).
+ * *secret_len is always set to the payload size, so a call with a NULL
+ * buffer and secret_cap 0 returns the size to allocate. extn (optional)
+ * receives the recorded extension. Framed (--stream) and compressed
+ * (--compress) payloads are decoded too; an --archive image comes back
+ * as its whole payload (index then files, see archive.h) with an empty
+ * extension, and a --shard image as its shard record then its slice.
+ * Images written with --key or --password are refused (neither is an
+ * argument).
+ * A payload whose CRC-32C does not match the recorded one fails (the
+ * buffer then holds the damaged data).
+ */
+Status steg_decode_mem(const void *stego, size_t stego_len, void *secret, size_t secret_cap,
+                       size_t *secret_len, char extn[STEG_MAX_EXTN + 1]);
+
+#endif
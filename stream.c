@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "stream.h"
+
+/* Descriptor of the real stdout once console messages are redirected */
+static int stream_stdout_fd = STDOUT_FILENO;
+
+/*
+ * Keep a copy of the real stdout for data and point file descriptor 1
+ * at stderr, so every printf of the CLI goes to the console instead of
+ * the output stream
+ */
+void stream_redirect_console(void)
+{
+    fflush(stdout);
+    int fd = dup(STDOUT_FILENO);
+    if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+    {
+        perror("dup");
+        return;
+    }
+    stream_stdout_fd = fd;
+}
+
+/*
+ * fopen that maps "-" to stdin or to the data stdout
+ */
+FILE *stream_open(const char *fname, const char *mode)
+{
+    if (strcmp(fname, "-") != 0)
+        return fopen(fname, mode);
+    if (mode[0] == 'r')
+        return fdopen(dup(STDIN_FILENO), mode);
+    return fdopen(dup(stream_stdout_fd), mode);
+}
+
+/*
+ * Read the BMP headers without seeking
+ */
+Status stream_copy_bmp_header(FILE *src, FILE *dest, BmpInfo *bmp)
+{
+    unsigned char buffer[4096];
+
+    // Step 1: Parse the fixed part; the file size is unknown on a pipe
+    if (fread(buffer, 1, BMP_HEADER_PARSE_SIZE, src) != BMP_HEADER_PARSE_SIZE ||
+        bmp_parse_header(buffer, BMP_HEADER_PARSE_SIZE, 0, bmp) != e_success)
+        return e_failure;
+    if (dest != NULL && fwrite(buffer, 1, BMP_HEADER_PARSE_SIZE, dest) != BMP_HEADER_PARSE_SIZE)
+        return e_failure;
+
+    // Step 2: Pass the rest of the headers (bit masks, palette) through
+    for (uint32_t done = BMP_HEADER_PARSE_SIZE; done < bmp->data_offset;)
+    {
+        size_t len = bmp->data_offset - done < sizeof(buffer) ? bmp->data_offset - done : sizeof(buffer);
+        if (fread(buffer, 1, len, src) != len || (dest != NULL && fwrite(buffer, 1, len, dest) != len))
+            return e_failure;
+        done += len;
+    }
+    return e_success;
+}
+
+/*
+ * Skip n bytes of a stream by reading them
+ */
+Status stream_skip(FILE *fptr, size_t n)
+{
+    char buffer[256];
+    while (n > 0)
+    {
+        size_t len = n < sizeof(buffer) ? n : sizeof(buffer);
+        if (fread(buffer, 1, len, fptr) != len)
+            return e_failure;
+        n -= len;
+    }
+    return e_success;
+}
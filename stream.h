@@ -0,0 +1,34 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdio.h>
+#include "types.h" // Contains user defined types
+#include "bmp.h"   // BMP header parser
+
+/*
+ * Streaming mode (--stream)
+ * -------------------------
+ * Every input and output is read or written front to back exactly once,
+ * so stdin/stdout ("-"), pipes and FIFOs work. Because the secret size
+ * is not known when the stego header is written, the payload is a
+ * sequence of frames, each a 32-bit little-endian length followed by
+ * that many bytes; a zero length ends the payload. The stego header
+ * carries STEG_FLAG_STREAM and a payload_size of 0.
+ */
+
+/* Size of the length field in front of every frame */
+#define STREAM_FRAME_LEN_SIZE 4
+
+/* Send console messages to stderr so stdout can carry data */
+void stream_redirect_console(void);
+
+/* fopen that maps "-" to stdin ("r" modes) or the data stdout ("w" modes) */
+FILE *stream_open(const char *fname, const char *mode);
+
+/* Read the BMP headers up to bfOffBits without seeking, copying them to dest (may be NULL) */
+Status stream_copy_bmp_header(FILE *src, FILE *dest, BmpInfo *bmp);
+
+/* Skip n bytes of a stream by reading them */
+Status stream_skip(FILE *fptr, size_t n);
+
+#endif
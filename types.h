@@ -15,6 +15,10 @@ typedef enum
 {
     e_encode,
     e_decode,
+    e_bench,
+    e_batch,
+    e_probe,
+    e_serve,
     e_unsupported
 } OperationType;
 